@@ -0,0 +1,599 @@
+// Copyright 2021, Trail of Bits, Inc. All rights reserved.
+
+// Generates synthetic workloads for the databases that Dr. Lojekyll generates
+// from a Datalog module. A workload is a stream of additions and removals of
+// tuples to the module's received `#message`s, split into batches, which can
+// be replayed into a generated C++ database with `hyde::rt::WorkloadReplayer`
+// (see `drlojekyll/Runtime/Workload.h`).
+
+#include <drlojekyll/Display/DisplayConfiguration.h>
+#include <drlojekyll/Display/DisplayManager.h>
+#include <drlojekyll/Parse/ErrorLog.h>
+#include <drlojekyll/Parse/ModuleIterator.h>
+#include <drlojekyll/Parse/Parse.h>
+#include <drlojekyll/Parse/Parser.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hyde {
+namespace {
+
+static uint64_t gNumFacts = 1000000u;
+static uint64_t gBatchSize = 10000u;
+static uint64_t gNumKeys = 65536u;
+static double gSkew = 0.0;
+static double gRemoveRatio = 0.0;
+static uint64_t gSeed = 0u;
+static const char *gOutPath = nullptr;
+
+// Samples ranks in `[1, n]` from a Zipf distribution with exponent `s > 0`,
+// using the rejection-inversion method of Hörmann and Derflinger. This takes
+// constant time and space per sample, no matter how big `n` is.
+class ZipfDistribution {
+ public:
+  ZipfDistribution(uint64_t n_, double s_)
+      : n(static_cast<double>(n_)),
+        s(s_),
+        h_integral_x1(HIntegral(1.5) - 1.0),
+        h_integral_n(HIntegral(n + 0.5)),
+        threshold(2.0 - HIntegralInverse(HIntegral(2.5) - H(2.0))) {}
+
+  template <typename RNG>
+  uint64_t operator()(RNG &rng) const {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    for (;;) {
+      const auto u =
+          h_integral_n + uniform(rng) * (h_integral_x1 - h_integral_n);
+      const auto x = HIntegralInverse(u);
+      const auto k = std::min(n, std::max(1.0, std::floor(x + 0.5)));
+      if (k - x <= threshold || u >= HIntegral(k + 0.5) - H(k)) {
+        return static_cast<uint64_t>(k);
+      }
+    }
+  }
+
+ private:
+  // The unnormalized probability of rank `x`, i.e. `x^-s`.
+  double H(double x) const {
+    return std::exp(-s * std::log(x));
+  }
+
+  // An integral of `H`, i.e. `(x^(1-s) - 1) / (1-s)`, or `log(x)` if `s` is
+  // one.
+  double HIntegral(double x) const {
+    const auto log_x = std::log(x);
+    return Helper2((1.0 - s) * log_x) * log_x;
+  }
+
+  double HIntegralInverse(double x) const {
+    const auto t = std::max(-1.0, x * (1.0 - s));
+    return std::exp(Helper1(t) * x);
+  }
+
+  // `log1p(x) / x`, which tends to one as `x` tends to zero.
+  static double Helper1(double x) {
+    if (std::abs(x) > 1e-8) {
+      return std::log1p(x) / x;
+    } else {
+      return 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+    }
+  }
+
+  // `expm1(x) / x`, which tends to one as `x` tends to zero.
+  static double Helper2(double x) {
+    if (std::abs(x) > 1e-8) {
+      return std::expm1(x) / x;
+    } else {
+      return 1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x));
+    }
+  }
+
+  const double n;
+  const double s;
+  const double h_integral_x1;
+  const double h_integral_n;
+  const double threshold;
+};
+
+// Samples keys in `[0, num_keys)`. Small keys are the hottest ones when the
+// distribution is skewed, and so every column agrees on which keys are hot.
+class KeyDistribution {
+ public:
+  KeyDistribution(uint64_t num_keys, double skew)
+      : uniform(0u, num_keys - 1u) {
+    if (skew > 0.0) {
+      zipf.emplace(num_keys, skew);
+    }
+  }
+
+  template <typename RNG>
+  uint64_t operator()(RNG &rng) {
+    if (zipf) {
+      return (*zipf)(rng) - 1u;
+    } else {
+      return uniform(rng);
+    }
+  }
+
+ private:
+  std::uniform_int_distribution<uint64_t> uniform;
+  std::optional<ZipfDistribution> zipf;
+};
+
+// How to turn keys into the values of a column of a message.
+struct Column {
+
+  // If non-zero, then values are taken modulo this, so that they fit in the
+  // column's type.
+  uint64_t num_values{0};
+
+  // If non-empty, then keys pick one of these values.
+  std::vector<int64_t> enumerators;
+
+  int64_t ValueOf(uint64_t key) const {
+    if (!enumerators.empty()) {
+      return enumerators[key % enumerators.size()];
+    } else if (num_values) {
+      return static_cast<int64_t>(key % num_values);
+    } else {
+      return static_cast<int64_t>(key);
+    }
+  }
+};
+
+// A received message, and the tuples of it that can be removed.
+struct Message {
+  std::string name;
+  bool is_differential{false};
+  std::vector<Column> columns;
+
+  // Flattened tuples that have been added and not yet removed. Only tracked
+  // for differential messages.
+  std::vector<int64_t> live_tuples;
+};
+
+// Figure out how to generate values of type `type`. Workloads spell every
+// value as a number, so there's no way to generate `bytes`, or values of
+// foreign types that are interned rather than passed by value.
+static std::optional<Column> ColumnFor(ParsedModule module, TypeLoc type) {
+  Column col;
+  switch (type.UnderlyingKind()) {
+    case TypeKind::kBoolean: col.num_values = 2u; return col;
+    case TypeKind::kSigned8: col.num_values = 1ull << 7u; return col;
+    case TypeKind::kSigned16: col.num_values = 1ull << 15u; return col;
+    case TypeKind::kSigned32: col.num_values = 1ull << 31u; return col;
+    case TypeKind::kSigned64: return col;
+    case TypeKind::kUnsigned8: col.num_values = 1ull << 8u; return col;
+    case TypeKind::kUnsigned16: col.num_values = 1ull << 16u; return col;
+    case TypeKind::kUnsigned32: col.num_values = 1ull << 32u; return col;
+    case TypeKind::kUnsigned64: return col;
+
+    // Keep the values exactly representable.
+    case TypeKind::kFloat: col.num_values = 1ull << 24u; return col;
+    case TypeKind::kDouble: col.num_values = 1ull << 53u; return col;
+
+    case TypeKind::kForeignType: break;
+    default: return std::nullopt;
+  }
+
+  const auto foreign_type = module.ForeignType(type);
+  if (!foreign_type) {
+    return std::nullopt;
+  }
+
+  // Enumerators without an explicit value follow on from the previous one,
+  // as in C++.
+  if (auto enum_type = ParsedEnumType::From(*foreign_type)) {
+    int64_t next_val = 0;
+    for (ParsedForeignConstant enumerator : enum_type->Enumerators()) {
+      const std::string code(enumerator.Constructor());
+      char *end = nullptr;
+      const auto val = std::strtoll(code.c_str(), &end, 0);
+      if (!code.empty() && !*end) {
+        next_val = val;
+      }
+      col.enumerators.push_back(next_val++);
+    }
+    if (col.enumerators.empty()) {
+      return std::nullopt;
+    }
+    return col;
+
+  // NOTE(pag): We assume that transparent foreign types are integral, e.g.
+  //            type aliases for IDs.
+  } else if (foreign_type->IsReferentiallyTransparent(Language::kCxx)) {
+    return col;
+
+  } else {
+    return std::nullopt;
+  }
+}
+
+// Collect the received messages of `module` and of everything it imports.
+static std::vector<Message> ReceivedMessages(ParsedModule module) {
+  std::vector<Message> messages;
+  for (ParsedModule sub_module : ParsedModuleIterator(module)) {
+    for (ParsedMessage message : sub_module.Messages()) {
+      ParsedDeclaration decl(message);
+      if (!decl.IsFirstDeclaration() || !message.IsReceived()) {
+        continue;
+      }
+
+      Message info;
+      info.name = std::string(message.NameAsString()) + "_" +
+                  std::to_string(message.Arity());
+      info.is_differential = message.IsDifferential();
+
+      for (auto i = 0u; i < message.Arity(); ++i) {
+        const auto param = message.NthParameter(i);
+        if (auto col = ColumnFor(module, param.Type())) {
+          info.columns.emplace_back(std::move(*col));
+        } else {
+          std::cerr << "Skipping message '" << info.name
+                    << "': can't generate values for parameter '"
+                    << param.NameAsString() << "'\n";
+          break;
+        }
+      }
+
+      if (info.columns.size() == message.Arity()) {
+        messages.emplace_back(std::move(info));
+      }
+    }
+  }
+  return messages;
+}
+
+// Writes out a workload. The output is buffered, so that writing out tens of
+// millions of tuples isn't dominated by the cost of the writes.
+class WorkloadWriter {
+ public:
+  explicit WorkloadWriter(std::FILE *fp_)
+      : fp(fp_) {
+    buffer.reserve(kBufferSize + 4096u);
+  }
+
+  void Write(std::string_view str) {
+    buffer.append(str);
+  }
+
+  void WriteTuple(bool added, const Message &message, const int64_t *vals) {
+    buffer.push_back(added ? '+' : '-');
+    buffer.push_back('\t');
+    buffer.append(message.name);
+    for (auto i = 0u; i < message.columns.size(); ++i) {
+      char val_buf[24];
+      const auto res =
+          std::to_chars(val_buf, &(val_buf[sizeof(val_buf)]), vals[i]);
+      buffer.push_back('\t');
+      buffer.append(val_buf, res.ptr);
+    }
+    buffer.push_back('\n');
+    if (buffer.size() >= kBufferSize) {
+      Flush();
+    }
+  }
+
+  void EndBatch(void) {
+    buffer.append(".\n");
+  }
+
+  // Returns `false` if any write failed.
+  bool Flush(void) {
+    if (!buffer.empty()) {
+      std::fwrite(buffer.data(), 1u, buffer.size(), fp);
+      buffer.clear();
+    }
+    return !std::ferror(fp);
+  }
+
+ private:
+  static constexpr size_t kBufferSize = 1u << 20u;
+
+  std::FILE *const fp;
+  std::string buffer;
+};
+
+// Generate the workload into `writer`.
+static void GenerateWorkload(std::vector<Message> &messages,
+                             WorkloadWriter &writer) {
+  std::mt19937_64 rng(gSeed);
+  KeyDistribution keys(gNumKeys, gSkew);
+  std::uniform_int_distribution<size_t> pick_message(0u, messages.size() - 1u);
+  std::uniform_real_distribution<double> pick_op(0.0, 1.0);
+  std::vector<int64_t> vals;
+
+  for (uint64_t i = 0u; i < gNumFacts; ++i) {
+    if (i && !(i % gBatchSize)) {
+      writer.EndBatch();
+    }
+
+    auto &message = messages[pick_message(rng)];
+    auto &live = message.live_tuples;
+    const auto arity = message.columns.size();
+    const auto track_live = message.is_differential && gRemoveRatio > 0.0;
+
+    // Remove a random tuple that was previously added, and then forget about
+    // it by moving the last live tuple into its place.
+    if (track_live && !live.empty() && pick_op(rng) < gRemoveRatio) {
+      const auto num_live = live.size() / arity;
+      const auto index =
+          std::uniform_int_distribution<size_t>(0u, num_live - 1u)(rng);
+      const auto tuple = live.begin() + static_cast<ptrdiff_t>(index * arity);
+      writer.WriteTuple(false, message, &*tuple);
+      std::copy(live.end() - static_cast<ptrdiff_t>(arity), live.end(),
+                tuple);
+      live.resize(live.size() - arity);
+      continue;
+    }
+
+    vals.clear();
+    for (const auto &col : message.columns) {
+      vals.push_back(col.ValueOf(keys(rng)));
+    }
+    writer.WriteTuple(true, message, vals.data());
+    if (track_live) {
+      live.insert(live.end(), vals.begin(), vals.end());
+    }
+  }
+
+  writer.EndBatch();
+}
+
+static int WriteWorkload(ErrorLog error_log, ParsedModule module) {
+  auto messages = ReceivedMessages(module);
+  if (messages.empty()) {
+    error_log.Append(module.SpellingRange())
+        << "Module has no received messages for which values can be "
+        << "generated";
+    return EXIT_FAILURE;
+  }
+
+  auto fp = stdout;
+  if (gOutPath) {
+    fp = std::fopen(gOutPath, "w");
+    if (!fp) {
+      error_log.Append() << "Unable to open '" << gOutPath
+                         << "' for writing: " << std::strerror(errno);
+      return EXIT_FAILURE;
+    }
+  }
+
+  WorkloadWriter writer(fp);
+  writer.Write("# drlojekyll-workload facts=" + std::to_string(gNumFacts) +
+               " batch-size=" + std::to_string(gBatchSize) +
+               " keys=" + std::to_string(gNumKeys) +
+               " skew=" + std::to_string(gSkew) +
+               " remove-ratio=" + std::to_string(gRemoveRatio) +
+               " seed=" + std::to_string(gSeed) + "\n");
+  for (const auto &message : messages) {
+    writer.Write("# message " + message.name +
+                 (message.is_differential ? " @differential\n" : "\n"));
+  }
+
+  GenerateWorkload(messages, writer);
+
+  auto ok = writer.Flush();
+  if (gOutPath) {
+    ok = !std::fclose(fp) && ok;
+  } else {
+    ok = !std::fflush(fp) && ok;
+  }
+
+  if (!ok) {
+    error_log.Append() << "Unable to write out the workload";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+static bool ParseUnsigned(const char *str, uint64_t &val) {
+  char *end = nullptr;
+  errno = 0;
+  val = std::strtoull(str, &end, 10);
+  return str[0] && str[0] != '-' && !*end && !errno;
+}
+
+static bool ParseDouble(const char *str, double &val) {
+  char *end = nullptr;
+  errno = 0;
+  val = std::strtod(str, &end);
+  return str[0] && !*end && !errno && std::isfinite(val);
+}
+
+// clang-format off
+static int HelpMessage(const char *argv[]) {
+  std::cout
+      << "OVERVIEW: Dr. Lojekyll synthetic workload generator" << std::endl
+      << std::endl
+      << "USAGE: " << argv[0] << " [options] <DATALOG_PATH>" << std::endl
+      << std::endl
+      << "Generates a stream of additions and removals of tuples to the received messages" << std::endl
+      << "of a Datalog module, which can be replayed into the generated C++ database with" << std::endl
+      << "hyde::rt::WorkloadReplayer. Every column value is drawn from a shared domain of keys." << std::endl
+      << std::endl
+      << "OUTPUT OPTIONS:" << std::endl
+      << "  -o <PATH>                 Write the workload to PATH instead of to stdout." << std::endl
+      << std::endl
+      << "WORKLOAD OPTIONS:" << std::endl
+      << "  -facts <N>                Number of additions and removals to generate (default 1000000)." << std::endl
+      << "  -batch-size <N>           Number of additions and removals per batch (default 10000)." << std::endl
+      << "  -keys <N>                 Number of distinct keys (default 65536)." << std::endl
+      << "  -selectivity <P>          Probability that two uniformly distributed keys join; an" << std::endl
+      << "                            alternative to -keys, using 1/P keys." << std::endl
+      << "  -skew <S>                 Zipf exponent of the key distribution; 0 is uniform (default 0)." << std::endl
+      << "  -remove-ratio <R>         Fraction of the changes to @differential messages that remove a" << std::endl
+      << "                            previously added tuple (default 0)." << std::endl
+      << "  -seed <N>                 Seed of the random number generator (default 0)." << std::endl
+      << std::endl
+      << "PARSING OPTIONS:" << std::endl
+      << "  -M <PATH>                 Directory where import statements can find needed Datalog modules." << std::endl
+      << std::endl
+      << "OTHER OPTIONS:" << std::endl
+      << "  -help, -h                 Show help and exit." << std::endl
+      << std::endl;
+
+  return EXIT_SUCCESS;
+}
+// clang-format on
+
+}  // namespace
+}  // namespace hyde
+
+extern "C" int main(int argc, const char *argv[]) {
+  hyde::DisplayManager display_manager;
+  hyde::ErrorLog error_log(display_manager);
+  hyde::Parser parser(display_manager, error_log);
+
+  std::string input_path;
+  int num_input_paths = 0;
+
+  // Checks that option `argv[i]` is followed by a value, and parses it.
+  auto parse_arg = [&](int &i, const char *what, auto parse, auto &val) {
+    ++i;
+    if (i >= argc) {
+      error_log.Append() << "Command-line argument '" << argv[i - 1]
+                         << "' must be followed by " << what;
+      return false;
+    } else if (!parse(argv[i], val)) {
+      error_log.Append() << "Command-line argument '" << argv[i - 1]
+                         << "' must be followed by " << what << ", not '"
+                         << argv[i] << "'";
+      return false;
+    } else {
+      return true;
+    }
+  };
+
+  // Parse the command-line arguments.
+  for (int i = 1; i < argc; ++i) {
+
+    // Workload output file.
+    if (!strcmp(argv[i], "-o")) {
+      ++i;
+      if (i >= argc) {
+        error_log.Append()
+            << "Command-line argument '-o' must be followed by a file path "
+            << "for workload output";
+      } else {
+        hyde::gOutPath = argv[i];
+      }
+
+    } else if (!strcmp(argv[i], "-facts") || !strcmp(argv[i], "--facts")) {
+      parse_arg(i, "an integer", hyde::ParseUnsigned, hyde::gNumFacts);
+
+    } else if (!strcmp(argv[i], "-batch-size") ||
+               !strcmp(argv[i], "--batch-size")) {
+      if (parse_arg(i, "a positive integer", hyde::ParseUnsigned,
+                    hyde::gBatchSize) &&
+          !hyde::gBatchSize) {
+        error_log.Append() << "Batch size must be positive";
+      }
+
+    } else if (!strcmp(argv[i], "-keys") || !strcmp(argv[i], "--keys")) {
+      if (parse_arg(i, "a positive integer", hyde::ParseUnsigned,
+                    hyde::gNumKeys) &&
+          !hyde::gNumKeys) {
+        error_log.Append() << "Number of keys must be positive";
+      }
+
+    // Join selectivity, in terms of the number of keys. Under a uniform
+    // distribution, any two keys are equal with probability `1 / num_keys`.
+    } else if (!strcmp(argv[i], "-selectivity") ||
+               !strcmp(argv[i], "--selectivity")) {
+      double selectivity = 0.0;
+      if (!parse_arg(i, "a probability", hyde::ParseDouble, selectivity)) {
+
+      } else if (selectivity <= 0.0 || selectivity > 1.0) {
+        error_log.Append() << "Selectivity must be in the range (0, 1]";
+      } else {
+        hyde::gNumKeys = static_cast<uint64_t>(std::llround(1.0 / selectivity));
+      }
+
+    } else if (!strcmp(argv[i], "-skew") || !strcmp(argv[i], "--skew")) {
+      if (parse_arg(i, "a number", hyde::ParseDouble, hyde::gSkew) &&
+          hyde::gSkew < 0.0) {
+        error_log.Append() << "Skew must not be negative";
+      }
+
+    } else if (!strcmp(argv[i], "-remove-ratio") ||
+               !strcmp(argv[i], "--remove-ratio")) {
+      if (parse_arg(i, "a ratio", hyde::ParseDouble, hyde::gRemoveRatio) &&
+          (hyde::gRemoveRatio < 0.0 || hyde::gRemoveRatio >= 1.0)) {
+        error_log.Append() << "Remove ratio must be in the range [0, 1)";
+      }
+
+    } else if (!strcmp(argv[i], "-seed") || !strcmp(argv[i], "--seed")) {
+      parse_arg(i, "an integer", hyde::ParseUnsigned, hyde::gSeed);
+
+    // Datalog module file search path.
+    } else if (!strcmp(argv[i], "-M")) {
+      ++i;
+      if (i >= argc) {
+        error_log.Append()
+            << "Command-line argument '-M' must be followed by a directory path";
+
+      } else {
+        std::filesystem::path path(argv[i]);
+        parser.AddModuleSearchPath(std::move(path));
+      }
+
+    // Help message :-)
+    } else if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-help") ||
+               !strcmp(argv[i], "-h")) {
+      return hyde::HelpMessage(argv);
+
+    // Does this look like a command-line option?
+    } else if (strchr(argv[i], '-') == argv[i]) {
+      error_log.Append() << "Unrecognized command-line argument '" << argv[i]
+                         << "'";
+
+    // Input datalog file.
+    } else {
+      input_path = argv[i];
+      ++num_input_paths;
+    }
+  }
+
+  int code = EXIT_FAILURE;
+
+  // Exit early if command-line option parsing failed.
+  if (!error_log.IsEmpty()) {
+
+  } else if (num_input_paths != 1) {
+    error_log.Append() << "Expected exactly one input file to parse";
+
+  } else {
+    hyde::DisplayConfiguration config = {
+        input_path,  // `name`.
+        2,  // `num_spaces_in_tab`.
+        true  // `use_tab_stops`.
+    };
+
+    if (auto module_opt = parser.ParsePath(input_path, config)) {
+      code = hyde::WriteWorkload(error_log, *module_opt);
+    }
+  }
+
+  if (code) {
+    error_log.Render(std::cerr);
+  }
+
+  return code;
+}
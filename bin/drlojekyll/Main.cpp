@@ -53,6 +53,8 @@ struct FileStream {
 namespace {
 
 static unsigned gFirstId = 0u;
+static bool gUseRecords = false;
+static bool gProfile = false;
 static std::string gDatabaseName = "datalog";
 static bool gHasDatabaseName = false;
 static const char *gCxxOutDir = nullptr;
@@ -173,7 +175,7 @@ static int CompileModule(const Parser &parser, DisplayManager display_manager,
   try {
     std::string fb_schema;
 
-    auto program_opt = Program::Build(*query_opt, gFirstId);
+    auto program_opt = Program::Build(*query_opt, gFirstId, gUseRecords);
     if (!program_opt) {
       return EXIT_FAILURE;
     }
@@ -205,7 +207,7 @@ static int CompileModule(const Parser &parser, DisplayManager display_manager,
       hyde::FileStream db_fs(
           display_manager,
           (dir / (gDatabaseName + ".db.h")).generic_string());
-      hyde::cxx::GenerateDatabaseCode(*program_opt, db_fs.os);
+      hyde::cxx::GenerateDatabaseCode(*program_opt, db_fs.os, gProfile);
 
       hyde::FileStream interface_fs(
           display_manager,
@@ -345,6 +347,8 @@ static int HelpMessage(const char *argv[]) {
       << std::endl
       << "COMPILATION OPTIONS:" << std::endl
       << "  -M <PATH>                 Directory where import statements can find needed Datalog modules." << std::endl
+      << "  -use-records              Convert state checks and changes on tables into record checks and changes where possible." << std::endl
+      << "  -profile                  Instrument the generated C++ procedures and induction loops with cycle counters." << std::endl
       << std::endl
       << "OTHER OPTIONS:" << std::endl
       << "  -help, -h                 Show help and exit." << std::endl
@@ -497,6 +501,16 @@ extern "C" int main(int argc, const char *argv[]) {
         hyde::gFirstId = static_cast<unsigned>(strtoul(argv[i], nullptr, 10));
       }
 
+    // Analyze the control-flow IR, and convert state checks and changes on
+    // tables into record checks and changes where possible.
+    } else if (!strcmp(argv[i], "-use-records") ||
+               !strcmp(argv[i], "--use-records")) {
+      hyde::gUseRecords = true;
+
+    // Instrument the generated C++ database code with cycle counters.
+    } else if (!strcmp(argv[i], "-profile") || !strcmp(argv[i], "--profile")) {
+      hyde::gProfile = true;
+
     // Datalog module file search path.
     } else if (!strcmp(argv[i], "-M")) {
       ++i;
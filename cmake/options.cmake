@@ -5,6 +5,7 @@ option(DRLOJEKYLL_ENABLE_INSTALL "Set to true to enable the install targets" OFF
 option(DRLOJEKYLL_ENABLE_TESTS "Set to true to enable tests" OFF)
 option(DRLOJEKYLL_ENABLE_LIBFUZZER "Set to true to enable fuzzing" OFF)
 option(DRLOJEKYLL_ENABLE_SANITIZERS "Set to true to enable sanitizers" OFF)
+option(DRLOJEKYLL_ENABLE_COMPACT_RECORD_LINKS "Set to true to link records in generated tables through 32-bit ordinals instead of pointers" OFF)
 
 if(DRLOJEKYLL_ENABLE_SANITIZERS AND DRLOJEKYLL_ENABLE_LIBFUZZER)
   message(FATAL_ERROR "Only enable one of the following two options: DRLOJEKYLL_ENABLE_SANITIZERS, DRLOJEKYLL_ENABLE_LIBFUZZER")
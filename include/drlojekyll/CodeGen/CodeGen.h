@@ -24,8 +24,11 @@ void GenerateServerCode(const Program &module, OutputStream &os);
 void GenerateClientCode(const Program &module, OutputStream &header_os,
                         OutputStream &impl_os);
 
-// Emits C++ code for the given program to `os`.
-void GenerateDatabaseCode(const Program &module, OutputStream &os);
+// Emits C++ code for the given program to `os`. If `profile` is `true` then
+// the generated procedures and induction loops are instrumented with cycle
+// counters, which are reported by the database's `DumpProfile` method.
+void GenerateDatabaseCode(const Program &module, OutputStream &os,
+                          bool profile = false);
 
 // Emits C++ code to build up and collect messages to send to a database,
 // or to collect messages published by the database and aggregate them into
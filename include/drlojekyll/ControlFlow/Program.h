@@ -321,6 +321,11 @@ class DataTable : public Node<DataTable, DataTableImpl> {
   // Return the list of views associated with this table.
   const std::vector<QueryView> Views(void) const noexcept;
 
+  // Does this table count the derivations of its tuples? Removals from a
+  // counted table remove one derivation of a tuple, and the tuple is only
+  // removed once it has no remaining derivations.
+  bool IsCounted(void) const noexcept;
+
  private:
   using Node<DataTable, DataTableImpl>::Node;
 };
@@ -603,6 +608,22 @@ enum class TupleState : unsigned {
   kAbsentOrUnknown
 };
 
+// Describes a table scan, one of the table scans inside of a table join, or a
+// record check or record change, that produced a record whose columns are
+// used, in full and in order, by a later state check or state change on the
+// same table. The backend can then operate on the provided record directly,
+// rather than re-hashing the tuple in order to find the record again.
+struct ProgramRecordProvider {
+ public:
+  // One of a `ProgramTableScanRegion`, `ProgramTableJoinRegion`,
+  // `ProgramChangeRecordRegion`, or `ProgramCheckRecordRegion`.
+  ProgramRegion region;
+
+  // Index of the table providing the record within the join's tables. This is
+  // always `0` for table scans.
+  unsigned table_index;
+};
+
 // Set the state of a tuple in a view. In the simplest case, this behaves like
 // a SQL `INSERT` statement: it says that some data exists in a relation. There
 // are two other states that can be set: absent, which is like a `DELETE`, and
@@ -635,6 +656,9 @@ class ProgramChangeTupleRegion
   // to `ToState()`.
   TupleState ToState(void) const noexcept;
 
+  // Returns the region whose record supplies `TupleVariables()`, if any.
+  std::optional<ProgramRecordProvider> RecordProvider(void) const noexcept;
+
  private:
   friend class ProgramRegion;
 
@@ -677,6 +701,9 @@ class ProgramChangeRecordRegion
   // to `ToState()`.
   TupleState ToState(void) const noexcept;
 
+  // Returns the region whose record supplies `TupleVariables()`, if any.
+  std::optional<ProgramRecordProvider> RecordProvider(void) const noexcept;
+
  private:
   friend class ProgramRegion;
 
@@ -705,6 +732,9 @@ class ProgramCheckTupleRegion
 
   DataTable Table(void) const;
 
+  // Returns the region whose record supplies `TupleVariables()`, if any.
+  std::optional<ProgramRecordProvider> RecordProvider(void) const noexcept;
+
  private:
   friend class ProgramRegion;
 
@@ -734,6 +764,9 @@ class ProgramCheckRecordRegion
 
   DataTable Table(void) const;
 
+  // Returns the region whose record supplies `TupleVariables()`, if any.
+  std::optional<ProgramRecordProvider> RecordProvider(void) const noexcept;
+
  private:
   friend class ProgramRegion;
 
@@ -1143,8 +1176,13 @@ class ProgramQuery {
 // A program in its entirety.
 class Program {
  public:
-  // Build a program from a query.
-  static std::optional<Program> Build(const Query &query, unsigned first_id=0);
+  // Build a program from a query. If `use_records` is `true`, then the
+  // program is analyzed after being built, and state checks and changes on
+  // tables whose tuples only ever flow through a single other record (e.g. an
+  // induction table, or the record of a scan) are converted to operate on
+  // records.
+  static std::optional<Program> Build(const Query &query, unsigned first_id=0,
+                                      bool use_records=false);
 
   // All persistent tables needed to store data.
   DefinedNodeRange<DataTable> Tables(void) const;
@@ -337,6 +337,28 @@ enum class Lexeme : uint8_t {
   // and the compiler is free the aggressively inline or ignore the hint.
   kPragmaPerfInline,
 
+  // Used to mark a functor as worth memoizing. The generated code will keep a
+  // bounded cache of recent results of the functor, keyed by the values of its
+  // `bound`-attributed parameters. This is useful for expensive functors that
+  // are repeatedly called with the same inputs, e.g. when the same tuples are
+  // re-proven by differential updates.
+  //
+  //      #functor demangle(bound bytes Name, free bytes Demangled) @range(.)
+  //               @memoize.
+  //
+  // Only non-aggregating functors can be memoized.
+  kPragmaPerfMemoize,
+
+  // Used to mark a functor as having a batched implementation. When the
+  // generated code loops over a vector of inputs to the functor, it first
+  // gathers all of the inputs and passes them to the functor's batch method
+  // in a single call, then hands out the results one at a time.
+  //
+  //      #functor decode(bound bytes Insn, free u32 Opcode) @range(.) @batch.
+  //
+  // Only non-aggregating, non-inline functors can be batched.
+  kPragmaPerfBatch,
+
   // Used to mark a foreign type as having a referentially transparent
   // implementation, such that equality implies identity. For example:
   //
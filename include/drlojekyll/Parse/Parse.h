@@ -696,6 +696,16 @@ class ParsedFunctor : public Node<ParsedFunctor, ParsedFunctorImpl> {
   // `FunctorRange::kZeroOrOne`.
   bool IsFilter(void) const noexcept;
 
+  // Should the results of this functor be memoized? This is `true` if any
+  // declaration of this functor with the same binding pattern is marked with
+  // the `@memoize` pragma.
+  bool IsMemoized(void) const noexcept;
+
+  // Does this functor have a batched implementation? This is `true` if any
+  // declaration of this functor with the same binding pattern is marked with
+  // the `@batch` pragma.
+  bool IsBatched(void) const noexcept;
+
   // Is this an inline functor? This means that is will have a direct definition
   // provided in some file or in the auto-generated code (via a `#prologue` or
   // `#epilogue`). This is really a symbol visibility thing.
@@ -0,0 +1,88 @@
+// Copyright 2021, Trail of Bits, Inc. All rights reserved.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace hyde {
+namespace rt {
+
+class UntypedBlockingInputQueueImpl;
+
+// A lock-protected multi-producer queue of opaque pointers. Items are dequeued
+// in the order in which they were enqueued, no matter which threads enqueued
+// them. Consumers can block on the queue and drain many items at once.
+class UntypedBlockingInputQueue {
+ private:
+  std::unique_ptr<UntypedBlockingInputQueueImpl> impl;
+
+ public:
+  UntypedBlockingInputQueue(void);
+  ~UntypedBlockingInputQueue(void);
+
+  // Add `item` to the queue, and wake up a waiting consumer.
+  void Enqueue(void *item);
+
+  // Wait until there is at least one item in the queue, then dequeue up to
+  // `max` items into `items`. Returns the number of dequeued items.
+  size_t WaitDequeueBulk(void **items, size_t max);
+
+  // Dequeue up to `max` items into `items` without waiting. Returns the number
+  // of dequeued items.
+  size_t TryDequeueBulk(void **items, size_t max);
+
+  // Returns an approximation of the number of items in the queue.
+  size_t SizeApprox(void) const;
+};
+
+// A strictly FIFO multi-producer queue that owns its elements. This is used to
+// hand off inputs from many threads (e.g. gRPC handlers) to a single consumer
+// thread, which blocks until there are inputs, and then drains them in bulk,
+// taking the lock once per batch.
+template <typename T>
+class BlockingInputQueue {
+ private:
+  UntypedBlockingInputQueue queue;
+  std::vector<void *> dequeued;
+
+  BlockingInputQueue(const BlockingInputQueue<T> &) = delete;
+  BlockingInputQueue(BlockingInputQueue<T> &&) noexcept = delete;
+
+ public:
+  BlockingInputQueue(void) = default;
+
+  ~BlockingInputQueue(void) {
+    dequeued.resize(128u);
+    while (auto num = queue.TryDequeueBulk(dequeued.data(), dequeued.size())) {
+      for (auto i = 0u; i < num; ++i) {
+        delete static_cast<T *>(dequeued[i]);
+      }
+    }
+  }
+
+  // Add `item` to the queue. Safe to call from any number of threads.
+  void Enqueue(std::unique_ptr<T> item) {
+    queue.Enqueue(item.release());
+  }
+
+  // Wait for at least one item, then move up to `max` items onto the end of
+  // `items`. Returns the number of dequeued items. Only one thread should
+  // consume from the queue at a time.
+  size_t WaitDequeueBulk(std::vector<std::unique_ptr<T>> &items, size_t max) {
+    dequeued.resize(max);
+    const auto num = queue.WaitDequeueBulk(dequeued.data(), max);
+    for (auto i = 0u; i < num; ++i) {
+      items.emplace_back(static_cast<T *>(dequeued[i]));
+    }
+    return num;
+  }
+
+  size_t SizeApprox(void) const {
+    return queue.SizeApprox();
+  }
+};
+
+}  // namespace rt
+}  // namespace hyde
@@ -3,7 +3,12 @@
 #pragma once
 
 #include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <future>
 #include <memory>
+#include <string>
 #include <grpcpp/grpcpp.h>
 #include <flatbuffers/flatbuffers.h>
 
@@ -11,6 +16,7 @@ namespace hyde {
 namespace rt {
 
 class ClientResultStreamImpl;
+class AsyncPublisherImpl;
 
 namespace internal {
 
@@ -35,10 +41,70 @@ void Kill(ClientResultStreamImpl *stream);
 
 }  // namespace internal
 
+// Create an insecure channel to the backend at `address`, e.g.
+// `localhost:50051`. Messages sent over the channel are compressed with
+// `compression`. By default, they aren't compressed, as gzip is expensive at
+// high message rates, and rarely pays off on a loopback or fast network.
+std::shared_ptr<grpc::Channel> CreateChannel(
+    const std::string &address,
+    grpc_compression_algorithm compression = GRPC_COMPRESS_NONE);
+
 // Send data to the backend.
 bool Publish(grpc::Channel *channel, const grpc::internal::RpcMethod &method,
              const grpc::Slice &data);
 
+// Configures how an `AsyncPublisher` batches and sends messages.
+struct AsyncPublisherOptions {
+
+  // Maximum number of batches that can be waiting to be sent, or that are
+  // being sent. Publishing more than this blocks the producer until a batch
+  // has been sent.
+  unsigned max_in_flight{8u};
+
+  // Send a batch once its encoded size reaches this many bytes.
+  size_t max_batch_bytes{1u << 20u};
+
+  // Send a batch once its oldest message has waited for this long.
+  std::chrono::milliseconds max_batch_delay{10};
+};
+
+// Sends messages to the backend on a background thread, so that producers
+// can keep building the next batch of messages while the previous batches
+// are in flight. Batches are sent one at a time, and in the order in which
+// they were given to `Send`, because the backend applies published messages
+// in the order in which it receives them.
+class AsyncPublisher {
+ public:
+  ~AsyncPublisher(void);
+
+  // `on_tick` is periodically called, every `options.max_batch_delay`, from a
+  // background thread. It lets the owner of this publisher send a batch that
+  // has been waiting for too long.
+  AsyncPublisher(std::shared_ptr<grpc::Channel> channel_,
+                 const grpc::internal::RpcMethod &method,
+                 const AsyncPublisherOptions &options_,
+                 std::function<void(void)> on_tick);
+
+  // Enqueue `data` to be sent, blocking if `max_in_flight` batches are already
+  // waiting. `done` is resolved once the backend has accepted or rejected
+  // `data`.
+  void Send(const grpc::Slice &data, std::promise<bool> done);
+
+  // Wait until every enqueued batch has been sent.
+  void Drain(void);
+
+  inline const AsyncPublisherOptions &Options(void) const noexcept {
+    return options;
+  }
+
+ private:
+  AsyncPublisher(const AsyncPublisher &) = delete;
+  AsyncPublisher &operator=(const AsyncPublisher &) = delete;
+
+  const AsyncPublisherOptions options;
+  std::unique_ptr<AsyncPublisherImpl> impl;
+};
+
 template <typename T>
 inline std::shared_ptr<T> Query(
     grpc::Channel *channel, const grpc::internal::RpcMethod &method,
@@ -143,5 +209,109 @@ class ClientResultStream {
   }
 };
 
+// Forward iterator over the results of a stream of chunks, where each chunk
+// holds a vector of results in its `results` field. Each result shares
+// ownership of the chunk that contains it.
+template <typename Chunk, typename Response>
+class ClientChunkedResultStreamIterator {
+ private:
+  std::shared_ptr<ClientResultStreamImpl> impl;
+  std::shared_ptr<Chunk> chunk;
+  std::shared_ptr<Response> message;
+  flatbuffers::uoffset_t index{0u};
+
+  ClientChunkedResultStreamIterator(
+      const ClientChunkedResultStreamIterator<Chunk, Response> &) = delete;
+  ClientChunkedResultStreamIterator<Chunk, Response> &operator=(
+      const ClientChunkedResultStreamIterator<Chunk, Response> &) = delete;
+
+  // Advance to the next result, pulling in a new chunk from the stream if
+  // the current one is exhausted. Returns `false` at the end of the stream.
+  bool Advance(void) {
+    for (;;) {
+      if (chunk) {
+        if (auto results = chunk->results(); results &&
+            index < results->size()) {
+          std::shared_ptr<Response> ret(
+              chunk, results->GetMutableObject(index++));
+          ret.swap(message);
+          return true;
+        }
+      }
+
+      std::shared_ptr<uint8_t> data;
+      if (!internal::NextOpaque(*impl, data, alignof(Chunk), sizeof(Chunk))) {
+        return false;
+      }
+
+      const auto chunk_ptr = flatbuffers::GetMutableRoot<Chunk>(data.get());
+      std::shared_ptr<Chunk> next_chunk(data, chunk_ptr);
+      next_chunk.swap(chunk);
+      index = 0u;
+    }
+  }
+
+ public:
+
+  // Implicit construction from an opaque stream.
+  ClientChunkedResultStreamIterator(
+      const std::shared_ptr<ClientResultStreamImpl> &impl_)
+      : impl(impl_) {
+    if (!Advance()) {
+      impl.reset();
+    }
+  }
+
+  inline const std::shared_ptr<Response> &operator*(void) const noexcept {
+    return message;
+  }
+
+  inline ClientChunkedResultStreamIterator<Chunk, Response> &
+  operator++(void) noexcept {
+    if (!Advance()) {
+      impl.reset();
+      chunk.reset();
+      message.reset();
+    }
+    return *this;
+  }
+
+  inline bool operator==(ClientResultStreamEndIterator that) const noexcept {
+    return !impl;
+  }
+
+  inline bool operator!=(ClientResultStreamEndIterator that) const noexcept {
+    return !!impl;
+  }
+};
+
+// A typed interface to an asynchronous gRPC stream of chunks of results. This
+// iterates over the individual results, and not over the chunks.
+template <typename Chunk, typename Response>
+class ClientChunkedResultStream {
+ private:
+  std::shared_ptr<ClientResultStreamImpl> impl;
+
+ public:
+  inline explicit ClientChunkedResultStream(
+      std::shared_ptr<grpc::Channel> channel_,
+      const grpc::internal::RpcMethod &method,
+      const grpc::Slice &request)
+      : impl(internal::RequestStream(std::move(channel_), method, request)) {}
+
+  inline ClientChunkedResultStreamIterator<Chunk, Response>
+  begin(void) const noexcept {
+    return impl;
+  }
+
+  inline ClientResultStreamEndIterator end(void) const noexcept {
+    return {};
+  }
+
+  inline void Kill(void) const {
+    internal::Kill(impl.get());
+  }
+};
+
 }  // namespace rt
 }  // namespace hyde
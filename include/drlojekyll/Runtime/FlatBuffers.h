@@ -505,5 +505,38 @@ class FBCast<hyde::rt::Bytes> {
   }
 };
 
+// The element type of a flatbuffer vector of `T`s. Vectors of enumerations and
+// of booleans are stored as vectors of their underlying integral types.
+template <typename T, bool kIsEnum = std::is_enum_v<T>>
+struct FBVectorElem {
+  using Type = T;
+};
+
+template <typename T>
+struct FBVectorElem<T, true> {
+  using Type = std::underlying_type_t<T>;
+};
+
+template <>
+struct FBVectorElem<bool, false> {
+  using Type = uint8_t;
+};
+
+// Create a flatbuffer vector from a `std::vector` of scalars, e.g. the values
+// used to filter the column of a published message.
+template <typename T>
+inline flatbuffers::Offset<
+    flatbuffers::Vector<typename FBVectorElem<T>::Type>>
+CreateFBVector(flatbuffers::FlatBufferBuilder &_fbb,
+               const std::vector<T> &vals) {
+  using ET = typename FBVectorElem<T>::Type;
+  std::vector<ET> elems;
+  elems.reserve(vals.size());
+  for (const T &val : vals) {
+    elems.push_back(static_cast<ET>(val));
+  }
+  return _fbb.CreateVector(elems);
+}
+
 }  // namespace rt
 }  // namespace hyde
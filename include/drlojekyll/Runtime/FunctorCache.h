@@ -0,0 +1,88 @@
+// Copyright 2021, Trail of Bits, Inc. All rights reserved.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <utility>
+
+#include "Serializer.h"
+#include "Util.h"
+
+// The number of results remembered by each memoized functor. This must be a
+// power of two.
+#ifndef HYDE_RT_FUNCTOR_CACHE_SIZE
+#  define HYDE_RT_FUNCTOR_CACHE_SIZE 4096u
+#endif
+
+namespace hyde {
+namespace rt {
+
+// A bounded cache of the results of a `@memoize`-attributed functor, keyed by
+// the values of its `bound`-attributed parameters. The cache is direct-mapped:
+// each key hashes to exactly one slot, and a miss evicts whatever result was
+// previously in that slot. Keys are compared in full, so a hash collision can
+// only cost a miss, and never produce the wrong result.
+//
+// NOTE(pag): This is only correct because functors are pure, i.e. they always
+//            produce the same outputs given the same inputs.
+template <typename ReturnType, typename... KeyTypes>
+class FunctorCache {
+ public:
+  static constexpr unsigned kNumSlots = HYDE_RT_FUNCTOR_CACHE_SIZE;
+
+  static_assert(0u < kNumSlots && !(kNumSlots & (kNumSlots - 1u)),
+                "HYDE_RT_FUNCTOR_CACHE_SIZE must be a power of two");
+
+  // Return the cached result of the functor for `keys`, or call `func` to
+  // compute it if it isn't cached.
+  template <typename Func>
+  HYDE_RT_ALWAYS_INLINE ReturnType Call(Func &&func, const KeyTypes &...keys) {
+    const uint64_t hash = HashKey(keys...);
+    if (HYDE_RT_UNLIKELY(!slots)) {
+      slots.reset(new Slot[kNumSlots]);
+    }
+
+    Slot &slot = slots[hash & (kNumSlots - 1u)];
+    if (slot.entry && slot.hash == hash &&
+        slot.entry->first == std::tie(keys...)) {
+      ++num_hits;
+      return slot.entry->second;
+    }
+
+    ++num_misses;
+    slot.entry.emplace(std::tuple<KeyTypes...>(keys...), func());
+    slot.hash = hash;
+    return slot.entry->second;
+  }
+
+  // The number of calls that were answered from the cache.
+  HYDE_RT_ALWAYS_INLINE uint64_t NumHits(void) const noexcept {
+    return num_hits;
+  }
+
+  // The number of calls that invoked the functor.
+  HYDE_RT_ALWAYS_INLINE uint64_t NumMisses(void) const noexcept {
+    return num_misses;
+  }
+
+  // Forget all cached results, e.g. to release memory.
+  void Clear(void) noexcept {
+    slots.reset();
+  }
+
+ private:
+  struct Slot {
+    uint64_t hash{0};
+    std::optional<std::pair<std::tuple<KeyTypes...>, ReturnType>> entry;
+  };
+
+  std::unique_ptr<Slot[]> slots;
+  uint64_t num_hits{0};
+  uint64_t num_misses{0};
+};
+
+}  // namespace rt
+}  // namespace hyde
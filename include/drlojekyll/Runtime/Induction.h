@@ -0,0 +1,179 @@
+// Copyright 2021, Trail of Bits, Inc. All rights reserved.
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#include "Profile.h"
+#include "Stats.h"
+#include "Util.h"
+
+namespace hyde {
+namespace rt {
+
+// Describes one iteration of an induction's fixpoint loop.
+struct InductionIteration {
+
+  // ID of the induction region in the control-flow IR.
+  unsigned induction_id;
+
+  // Index of this iteration within the current run of the fixpoint loop,
+  // starting at zero.
+  uint64_t iteration;
+
+  // IDs and sizes of the vectors tested by the fixpoint loop, as of the start
+  // of the iteration. These are the tuples processed by the iteration.
+  const unsigned *vector_ids;
+  const uint64_t *vector_sizes;
+  unsigned num_vectors;
+
+  // Number of tuples queued up by this iteration for the next iteration.
+  uint64_t num_new_tuples;
+
+  // Time spent in this iteration.
+  uint64_t num_nanoseconds;
+};
+
+// Receives the details of every iteration of every induction's fixpoint loop.
+// Tracing is opt-in; see the generated database's `SetInductionTracer`.
+//
+// NOTE(pag): Inductions only run when the database is being written to, so
+//            a tracer is never called concurrently by the same database.
+class InductionTracer {
+ public:
+  virtual ~InductionTracer(void) = default;
+
+  // Called at the end of every iteration of a fixpoint loop.
+  virtual void OnIteration(const InductionIteration &iteration) = 0;
+
+  // Called when a fixpoint loop has converged.
+  virtual void OnFixpoint(unsigned induction_id, uint64_t num_iterations,
+                          uint64_t num_nanoseconds) = 0;
+};
+
+// Writes a trace of fixpoint loops to a stream, as one JSON object per line.
+class JSONInductionTracer final : public InductionTracer {
+ public:
+  explicit JSONInductionTracer(std::ostream &os_)
+      : os(os_) {}
+
+  void OnIteration(const InductionIteration &iteration) override {
+    os << "{\"event\":\"iteration\",\"induction\":" << iteration.induction_id
+       << ",\"iteration\":" << iteration.iteration << ",\"vectors\":[";
+    auto sep = "";
+    for (auto i = 0u; i < iteration.num_vectors; ++i) {
+      os << sep << "{\"id\":" << iteration.vector_ids[i]
+         << ",\"size\":" << iteration.vector_sizes[i] << '}';
+      sep = ",";
+    }
+    os << "],\"new_tuples\":" << iteration.num_new_tuples
+       << ",\"nanoseconds\":" << iteration.num_nanoseconds << "}\n";
+  }
+
+  void OnFixpoint(unsigned induction_id, uint64_t num_iterations,
+                  uint64_t num_nanoseconds) override {
+    os << "{\"event\":\"fixpoint\",\"induction\":" << induction_id
+       << ",\"iterations\":" << num_iterations
+       << ",\"nanoseconds\":" << num_nanoseconds << "}\n";
+  }
+
+ private:
+  std::ostream &os;
+};
+
+// Tracks one run of an induction's fixpoint loop. The induction's stats are
+// always updated, but the clock is only read, and the tracer only called, if
+// there is a tracer. Similarly, each iteration is only added to the region
+// profile of the fixpoint loop if the database was compiled with `--profile`.
+template <unsigned kNumVectors>
+class InductionTrace {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  HYDE_RT_ALWAYS_INLINE
+  InductionTrace(InductionStats &stats_, InductionTracer *tracer_,
+                 RegionProfile *profile_, unsigned induction_id_,
+                 const std::array<unsigned, kNumVectors> &vector_ids_)
+      : stats(stats_),
+        tracer(tracer_),
+        profile(profile_),
+        induction_id(induction_id_),
+        vector_ids(vector_ids_) {
+    if (HYDE_RT_UNLIKELY(tracer != nullptr)) {
+      run_start = Clock::now();
+    }
+  }
+
+  HYDE_RT_ALWAYS_INLINE void
+  BeginIteration(const std::array<uint64_t, kNumVectors> &vector_sizes_) {
+    if (profile) {
+      ++profile->num_entries;
+      for (auto size : vector_sizes_) {
+        profile->num_tuples += size;
+      }
+      iteration_start_cycles = ReadCycleCounter();
+    }
+    if (HYDE_RT_UNLIKELY(tracer != nullptr)) {
+      vector_sizes = vector_sizes_;
+      iteration_start = Clock::now();
+    }
+  }
+
+  HYDE_RT_ALWAYS_INLINE void EndIteration(uint64_t num_new_tuples) {
+    if (profile) {
+      profile->num_cycles += ReadCycleCounter() - iteration_start_cycles;
+    }
+    stats.num_new_tuples += num_new_tuples;
+    if (HYDE_RT_UNLIKELY(tracer != nullptr)) {
+      InductionIteration iteration;
+      iteration.induction_id = induction_id;
+      iteration.iteration = num_iterations;
+      iteration.vector_ids = vector_ids.data();
+      iteration.vector_sizes = vector_sizes.data();
+      iteration.num_vectors = kNumVectors;
+      iteration.num_new_tuples = num_new_tuples;
+      iteration.num_nanoseconds = Nanoseconds(iteration_start);
+      tracer->OnIteration(iteration);
+    }
+    ++num_iterations;
+  }
+
+  HYDE_RT_ALWAYS_INLINE void EndFixpoint(void) {
+    ++stats.num_runs;
+    stats.num_iterations += num_iterations;
+    if (num_iterations > stats.max_iterations) {
+      stats.max_iterations = num_iterations;
+    }
+    if (HYDE_RT_UNLIKELY(tracer != nullptr)) {
+      tracer->OnFixpoint(induction_id, num_iterations, Nanoseconds(run_start));
+    }
+  }
+
+ private:
+  InductionTrace(const InductionTrace &) = delete;
+  InductionTrace &operator=(const InductionTrace &) = delete;
+
+  static uint64_t Nanoseconds(Clock::time_point start) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::now() - start)
+            .count());
+  }
+
+  InductionStats &stats;
+  InductionTracer *const tracer;
+  RegionProfile *const profile;
+  const unsigned induction_id;
+  const std::array<unsigned, kNumVectors> vector_ids;
+  std::array<uint64_t, kNumVectors> vector_sizes{};
+  Clock::time_point run_start;
+  Clock::time_point iteration_start;
+  uint64_t iteration_start_cycles{0};
+  uint64_t num_iterations{0};
+};
+
+}  // namespace rt
+}  // namespace hyde
@@ -0,0 +1,84 @@
+// Copyright 2021, Trail of Bits, Inc. All rights reserved.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <x86intrin.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#  include <intrin.h>
+#endif
+
+#include "Stats.h"
+#include "Util.h"
+
+namespace hyde {
+namespace rt {
+
+// Read a cheap, monotonically increasing cycle counter. On x86 this is the
+// time stamp counter, and on AArch64 this is the virtual counter. Elsewhere,
+// it falls back on the steady clock, and so counts nanoseconds.
+//
+// NOTE(pag): The counter is not serializing, so a few instructions on either
+//            side of a measured region may be misattributed. That's fine for
+//            regions that run for more than a few hundred cycles.
+HYDE_RT_ALWAYS_INLINE static uint64_t ReadCycleCounter(void) noexcept {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+    defined(_M_IX86)
+  return static_cast<uint64_t>(__rdtsc());
+#elif defined(__aarch64__)
+  uint64_t val = 0;
+  __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(val));
+  return val;
+#else
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+#endif
+}
+
+// Counters describing one profiled region of a database compiled with
+// `--profile`. A region is either a procedure, or an iteration of an induction
+// fixpoint loop.
+struct RegionProfile {
+
+  // Number of times the region was entered.
+  StatCounter num_entries;
+
+  // Total cycles spent in the region, including in any procedures that it
+  // called. Nested regions are counted in full by each enclosing region.
+  StatCounter num_cycles;
+
+  // Number of tuples that flowed into the region, i.e. the sizes of the
+  // vectors passed into a procedure, or of the vectors processed by an
+  // iteration of an induction.
+  StatCounter num_tuples;
+};
+
+// Adds one entry, and the cycles spent between its construction and
+// destruction, to a region's profile.
+class RegionTimer {
+ public:
+  HYDE_RT_ALWAYS_INLINE explicit RegionTimer(RegionProfile &profile_)
+      : profile(profile_),
+        start(ReadCycleCounter()) {
+    ++profile.num_entries;
+  }
+
+  HYDE_RT_ALWAYS_INLINE ~RegionTimer(void) {
+    profile.num_cycles += ReadCycleCounter() - start;
+  }
+
+ private:
+  RegionTimer(const RegionTimer &) = delete;
+  RegionTimer &operator=(const RegionTimer &) = delete;
+
+  RegionProfile &profile;
+  const uint64_t start;
+};
+
+}  // namespace rt
+}  // namespace hyde
@@ -2,54 +2,88 @@
 
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <utility>
 
 #include "Util.h"
 
 namespace hyde {
 namespace rt {
 
+// Storage for an interned value. The hash of the value is computed once, at
+// the time of interning, so that hashing an `InternRef` doesn't need to
+// re-serialize the referenced value.
+template <typename T>
+struct InternedData {
+ public:
+  template <typename... Args>
+  HYDE_RT_ALWAYS_INLINE InternedData(uint64_t hash_, uint64_t id_,
+                                     Args &&...args)
+      : hash(hash_),
+        id(id_),
+        value(std::forward<Args>(args)...) {}
+
+  // Hash of the serialized value.
+  const uint64_t hash;
+
+  // Unique ID of this value within its storage.
+  const uint64_t id;
+
+  const T value;
+};
+
 template <typename T>
 struct InternRef {
  public:
-  HYDE_RT_ALWAYS_INLINE InternRef(const T &ref_) noexcept
-      : ref(const_cast<T *>(&ref_)) {}
+  HYDE_RT_ALWAYS_INLINE InternRef(const InternedData<T> &data_) noexcept
+      : data(&data_) {}
 
-  HYDE_RT_ALWAYS_INLINE InternRef(const T *ref_) noexcept
-      : ref(const_cast<T *>(ref_)) {}
+  HYDE_RT_ALWAYS_INLINE InternRef(const InternedData<T> *data_) noexcept
+      : data(data_) {}
 
-  T *ref;
+  const InternedData<T> *data;
 
   const T &operator*(void) const noexcept {
-    return *ref;
+    return data->value;
   }
 
   const T *operator->(void) const noexcept {
-    return ref;
+    return &(data->value);
+  }
+
+  // Returns the hash of the referenced value.
+  HYDE_RT_ALWAYS_INLINE uint64_t Hash(void) const noexcept {
+    return data->hash;
+  }
+
+  // Returns the unique ID of the referenced value.
+  HYDE_RT_ALWAYS_INLINE uint64_t Id(void) const noexcept {
+    return data->id;
   }
 
   HYDE_RT_ALWAYS_INLINE bool operator<(InternRef<T> that) const noexcept {
-    return ref < that.ref;
+    return data < that.data;
   }
 
   HYDE_RT_ALWAYS_INLINE bool operator<(const T &that) const noexcept {
-    return std::less<T>{}(*ref, that);
+    return std::less<T>{}(data->value, that);
   }
 
   HYDE_RT_ALWAYS_INLINE bool operator==(InternRef<T> that) const noexcept {
-    return ref == that.ref;
+    return data == that.data;
   }
 
   HYDE_RT_ALWAYS_INLINE bool operator==(const T &that) const noexcept {
-    return std::equal_to<T>{}(*ref, that);
+    return std::equal_to<T>{}(data->value, that);
   }
 
   HYDE_RT_ALWAYS_INLINE bool operator!=(InternRef<T> that) const noexcept {
-    return ref != that.ref;
+    return data != that.data;
   }
 
   HYDE_RT_ALWAYS_INLINE bool operator!=(const T &that) const noexcept {
-    return !std::equal_to<T>{}(*ref, that);
+    return !std::equal_to<T>{}(data->value, that);
   }
 
 
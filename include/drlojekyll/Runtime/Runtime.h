@@ -16,9 +16,13 @@
 #include "Column.h"
 #include "Bytes.h"
 #include "Endian.h"
+#include "FunctorCache.h"
 #include "Index.h"
+#include "Induction.h"
 #include "Int.h"
+#include "Profile.h"
 #include "Reference.h"
+#include "Stats.h"
 #include "Table.h"
 #include "Util.h"
 
@@ -45,6 +49,27 @@ struct IndexTag {};
 template <unsigned kTableId>
 struct TableTag {};
 
+// Like `IndexTag` and `TableTag`, but scans tagged with these only visit
+// records whose state is one of `kStates`.
+template <unsigned kIndexId, TupleState... kStates>
+struct FilteredIndexTag {};
+
+template <unsigned kTableId, TupleState... kStates>
+struct FilteredTableTag {};
+
+// The kind of a range scan, i.e. whether we want the records whose column
+// value is less than, or greater than, some bound.
+enum class RangeKind : uint8_t {
+  kLessThan,
+  kGreaterThan,
+};
+
+// Scans tagged with this visit the records of the table `kTableId` whose
+// `kColumnOffset`th column satisfies the range given by `kKind` and a bound
+// value, in order of that column's values.
+template <unsigned kTableId, unsigned kColumnOffset, RangeKind kKind>
+struct RangeTag {};
+
 template <typename StorageT, const unsigned  kTableId>
 class Table;
 
@@ -2,8 +2,10 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
+#include <cstring>
 #include <string>
 #include <tuple>
 #include <type_traits>
@@ -66,6 +68,9 @@ struct NullReader {
   HYDE_RT_ALWAYS_INLINE int8_t ReadI8(void) {
     return {};
   }
+  HYDE_RT_ALWAYS_INLINE void ReadBytes(uint8_t *data, uint32_t num_bytes) {
+    memset(data, 0, num_bytes);
+  }
   HYDE_RT_ALWAYS_INLINE void Skip(uint32_t num_bytes) {
     assert(0u < num_bytes);
   }
@@ -94,6 +99,10 @@ struct NullWriter {
   HYDE_RT_ALWAYS_INLINE uint8_t *WriteI32(int32_t) noexcept { return nullptr; }
   HYDE_RT_ALWAYS_INLINE uint8_t *WriteI16(int16_t) noexcept { return nullptr; }
   HYDE_RT_ALWAYS_INLINE uint8_t *WriteI8(int8_t) noexcept { return nullptr; }
+  HYDE_RT_ALWAYS_INLINE uint8_t *WriteBytes(const uint8_t *,
+                                            uint32_t) noexcept {
+    return nullptr;
+  }
   HYDE_RT_ALWAYS_INLINE uint8_t *Skip(uint32_t num_bytes) noexcept {
     assert(0u < num_bytes);
     return nullptr;
@@ -215,6 +224,14 @@ class ByteWriter {
     return WriteU32(d);
   }
 
+  [[gnu::hot]] HYDE_RT_ALWAYS_INLINE
+  uint8_t *WriteBytes(const uint8_t *data, uint32_t num_bytes) noexcept {
+    const auto ptr = write_ptr;
+    memcpy(write_ptr, data, num_bytes);
+    write_ptr += num_bytes;
+    return ptr;
+  }
+
   [[gnu::hot]] HYDE_RT_ALWAYS_INLINE
   uint8_t *Skip(uint32_t num_bytes) noexcept {
     assert(0u < num_bytes);
@@ -336,6 +353,12 @@ class ByteReader {
     return ReadU32();
   }
 
+  [[gnu::hot]] HYDE_RT_ALWAYS_INLINE void
+  ReadBytes(uint8_t *data, uint32_t num_bytes) noexcept {
+    memcpy(data, read_ptr, num_bytes);
+    read_ptr += num_bytes;
+  }
+
   [[gnu::hot]] HYDE_RT_ALWAYS_INLINE void Skip(uint32_t num_bytes) noexcept {
     read_ptr += num_bytes;
   }
@@ -457,6 +480,16 @@ class ByteRangeReader : public UnsafeByteReader {
     return !!ReadU8();
   }
 
+  [[gnu::hot]] HYDE_RT_ALWAYS_INLINE void
+  ReadBytes(uint8_t *data, uint32_t num_bytes) noexcept {
+    if (&(read_ptr[num_bytes]) > max_read_ptr) {
+      error = true;
+      memset(data, 0, num_bytes);
+    } else {
+      UnsafeByteReader::ReadBytes(data, num_bytes);
+    }
+  }
+
   [[gnu::hot]] void Skip(uint32_t num_bytes) noexcept {
     read_ptr = &(read_ptr[num_bytes]);
     if (read_ptr > max_read_ptr) {
@@ -581,6 +614,13 @@ struct HashingWriter : public HashingBase {
     return nullptr;
   }
 
+  // NOTE(pag): Unlike the other methods, this doesn't pad each byte out to
+  //            eight bytes, so that hashing long strings is fast.
+  HYDE_RT_ALWAYS_INLINE uint8_t *WriteBytes(const uint8_t *data, uint32_t n) {
+    XXH64_update(&state, data, n);
+    return nullptr;
+  }
+
   HYDE_RT_ALWAYS_INLINE uint8_t *Skip(uint32_t n) {
     assert(0u < n);
     u.u64 = n;
@@ -699,6 +739,11 @@ struct HashingReader : public SubReader, HashingBase {
     return ret;
   }
 
+  HYDE_RT_ALWAYS_INLINE void ReadBytes(uint8_t *data, uint32_t n) {
+    SubReader::ReadBytes(data, n);
+    XXH64_update(&state, data, n);
+  }
+
   HYDE_RT_ALWAYS_INLINE void Skip(uint32_t n) {
     assert(0u < n);
     SubReader::Skip(n);
@@ -779,6 +824,11 @@ struct ByteCountingWriterProxy : public SubWriter {
     return SubWriter::WriteI8(v);
   }
 
+  HYDE_RT_ALWAYS_INLINE uint8_t *WriteBytes(const uint8_t *v, uint32_t n) {
+    num_bytes += n;
+    return SubWriter::WriteBytes(v, n);
+  }
+
   HYDE_RT_ALWAYS_INLINE uint8_t *Skip(uint32_t n) {
     assert(0u < n);
     num_bytes += n;
@@ -899,6 +949,16 @@ struct ByteEqualityComparingWriter : public Reader {
     return nullptr;
   }
 
+  HYDE_RT_ALWAYS_INLINE uint8_t *WriteBytes(const uint8_t *rhs, uint32_t n) {
+    uint8_t lhs[64u];
+    for (uint32_t i = 0u; equal && i < n; i += sizeof(lhs)) {
+      const auto chunk_size = std::min<uint32_t>(n - i, sizeof(lhs));
+      Reader::ReadBytes(lhs, chunk_size);
+      equal = !memcmp(lhs, &(rhs[i]), chunk_size);
+    }
+    return nullptr;
+  }
+
   HYDE_RT_ALWAYS_INLINE uint8_t *Skip(uint32_t n) {
     assert(0u < n);
     if (equal) {
@@ -1218,6 +1278,11 @@ struct ByteCountingReader : public SubReader {
     return {};
   }
 
+  HYDE_RT_ALWAYS_INLINE void ReadBytes(uint8_t *, uint32_t n) {
+    num_bytes += n;
+    SubReader::Skip(n);
+  }
+
   HYDE_RT_ALWAYS_INLINE void Skip(uint32_t n) {
     assert(0u < n);
     num_bytes += n;
@@ -1451,7 +1516,25 @@ struct Serializer<Reader, Writer, InternRef<DataT>> {
 
   HYDE_RT_INLINE
   static uint8_t *Write(Writer &writer, RefT ref) {
-    return Serializer<Reader, Writer, DataT>::Write(writer, *(ref.ref));
+    return Serializer<Reader, Writer, DataT>::Write(writer, *ref);
+  }
+
+  HYDE_RT_INLINE
+  static void Read(Reader &reader, RefT) {
+    abort();
+  }
+};
+
+// Interned values have their hashes precomputed, so hashing a reference is
+// constant time, regardless of the size of the referenced value.
+template <typename Reader, typename DataT>
+struct Serializer<Reader, HashingWriter, InternRef<DataT>> {
+ public:
+  using RefT = InternRef<DataT>;
+
+  HYDE_RT_ALWAYS_INLINE
+  static uint8_t *Write(HashingWriter &writer, RefT ref) {
+    return writer.WriteU64(ref.Hash());
   }
 
   HYDE_RT_INLINE
@@ -1467,6 +1550,31 @@ struct Serializer<Reader, Writer, const InternRef<DataT> &>
 template <typename T>
 static constexpr bool kCanReadWriteUnsafely<T *> = true;
 
+// Whether or not the serialized form of a `T` is identical to its in-memory
+// form, and thus whether or not a contiguous array of `T`s can be read or
+// written as a single span of bytes.
+template <typename T>
+static constexpr bool kCanReadWriteBytesUnsafely =
+    HYDE_RT_LITTLE_ENDIAN && std::is_integral_v<T> &&
+    !std::is_same_v<T, bool> && kCanReadWriteUnsafely<T> &&
+    sizeof(T) == kFixedSerializationSize<T>;
+
+// Whether or not a writer or reader supports bulk writing or reading of spans
+// of bytes.
+template <typename Writer, typename = void>
+static constexpr bool kHasWriteBytes = false;
+
+template <typename Writer>
+static constexpr bool kHasWriteBytes<
+    Writer, std::void_t<decltype(&Writer::WriteBytes)>> = true;
+
+template <typename Reader, typename = void>
+static constexpr bool kHasReadBytes = false;
+
+template <typename Reader>
+static constexpr bool kHasReadBytes<
+    Reader, std::void_t<decltype(&Reader::ReadBytes)>> = true;
+
 #undef HYDE_RT_DEFINE_UNSAFE_SERIALIZER_PRIV
 #define HYDE_RT_DEFINE_UNSAFE_SERIALIZER_PRIV(type)
 
@@ -1482,8 +1590,14 @@ struct LinearContainerReader {
     ret.resize(size);
     if (size) {
       ElementType *const begin = &(ret[0]);
-      for (uint32_t i = 0; i < size; ++i) {
-        Serializer<Reader, NullWriter, ElementType>::Read(reader, begin[i]);
+      if constexpr (kCanReadWriteBytesUnsafely<ElementType> &&
+                    kHasReadBytes<Reader>) {
+        reader.ReadBytes(reinterpret_cast<uint8_t *>(begin),
+                         static_cast<uint32_t>(size * sizeof(ElementType)));
+      } else {
+        for (uint32_t i = 0; i < size; ++i) {
+          Serializer<Reader, NullWriter, ElementType>::Read(reader, begin[i]);
+        }
       }
     }
   }
@@ -1529,8 +1643,14 @@ struct LinearContainerWriter {
     //            writer can elide the `for` loop entirely and count `size`.
     if (size) {
       const ElementType *const begin = &(data[0]);
-      for (uint32_t i = 0; i < size; ++i) {
-        Serializer<NullReader, Writer, ElementType>::Write(writer, begin[i]);
+      if constexpr (kCanReadWriteBytesUnsafely<ElementType> &&
+                    kHasWriteBytes<Writer>) {
+        writer.WriteBytes(reinterpret_cast<const uint8_t *>(begin),
+                          static_cast<uint32_t>(size * sizeof(ElementType)));
+      } else {
+        for (uint32_t i = 0; i < size; ++i) {
+          Serializer<NullReader, Writer, ElementType>::Write(writer, begin[i]);
+        }
       }
     }
 
@@ -1707,6 +1827,41 @@ struct Serializer<Reader, Writer, std::array<ElemT, kSize>>
   }
 };
 
+// Whether or not a key of type `T` can be hashed by value.
+template <typename T>
+static constexpr bool kIsIntegralKey =
+    (std::is_integral_v<T> || std::is_enum_v<T>) && sizeof(T) <= 8u;
+
+// Hash the values of the key columns of an index, or of a whole tuple. A
+// single integral or enumeration key is hashed with a multiplicative
+// (Fibonacci) hash, which is much cheaper than streaming its serialized form
+// through xxHash. The high bits of the product are folded into the low bits,
+// which are used by the bloom filters. Every other key is serialized into
+// xxHash.
+//
+// NOTE(pag): The key path is selected only by the types of the key columns,
+//            so every place that hashes keys of the same columns must agree
+//            on those types.
+template <typename T>
+HYDE_RT_ALWAYS_INLINE static uint64_t HashIntegralKey(T key) noexcept {
+  const uint64_t hash = static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ull;
+  return hash ^ (hash >> 29u);
+}
+
+template <typename... KeyTypes>
+HYDE_RT_ALWAYS_INLINE static uint64_t HashKey(
+    const KeyTypes &...keys) noexcept {
+  if constexpr (sizeof...(KeyTypes) == 1u &&
+                (kIsIntegralKey<KeyTypes> && ...)) {
+    return HashIntegralKey(keys...);
+
+  } else {
+    HashingWriter writer;
+    (Serializer<NullReader, HashingWriter, KeyTypes>::Write(writer, keys), ...);
+    return writer.Digest();
+  }
+}
+
 }  // namespace rt
 }  // namespace hyde
 
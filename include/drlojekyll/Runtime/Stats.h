@@ -0,0 +1,182 @@
+// Copyright 2021, Trail of Bits, Inc. All rights reserved.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "Util.h"
+
+namespace hyde {
+namespace rt {
+
+// A statistics counter. Counters are maintained unconditionally, so they need
+// to be as cheap as a plain integer increment.
+//
+// NOTE(pag): The counter is atomic so that a reader of the stats isn't racing
+//            with the writer, but increments are not atomic read-modify-writes,
+//            so concurrent increments can be lost. Counters that many threads
+//            bump at once should be `ShardedStatCounter`s.
+class StatCounter {
+ public:
+  StatCounter(void) = default;
+
+  HYDE_RT_ALWAYS_INLINE StatCounter(uint64_t value_) noexcept
+      : value(value_) {}
+
+  HYDE_RT_ALWAYS_INLINE StatCounter(const StatCounter &that) noexcept
+      : value(that.Load()) {}
+
+  HYDE_RT_ALWAYS_INLINE StatCounter &operator=(
+      const StatCounter &that) noexcept {
+    value.store(that.Load(), std::memory_order_relaxed);
+    return *this;
+  }
+
+  HYDE_RT_ALWAYS_INLINE StatCounter &operator+=(uint64_t amount) noexcept {
+    value.store(Load() + amount, std::memory_order_relaxed);
+    return *this;
+  }
+
+  HYDE_RT_ALWAYS_INLINE StatCounter &operator++(void) noexcept {
+    return *this += 1u;
+  }
+
+  HYDE_RT_ALWAYS_INLINE uint64_t Load(void) const noexcept {
+    return value.load(std::memory_order_relaxed);
+  }
+
+  HYDE_RT_ALWAYS_INLINE operator uint64_t(void) const noexcept {
+    return Load();
+  }
+
+ private:
+  std::atomic<uint64_t> value{0};
+};
+
+// A statistics counter that is bumped by many threads at once, e.g. by queries
+// holding a shared lock on the database. Each thread increments a counter in
+// its own cache line, so that the threads don't contend with each other, and
+// the per-thread counters are summed when the counter is read.
+//
+// NOTE(pag): Threads are assigned to shards round-robin. If there are more
+//            threads than shards then some threads share a shard, and can
+//            lose each other's increments, as with `StatCounter`.
+class ShardedStatCounter {
+ public:
+  static constexpr unsigned kNumShards = 16u;
+
+  HYDE_RT_ALWAYS_INLINE ShardedStatCounter &operator+=(
+      uint64_t amount) noexcept {
+    shards[ShardIndex()].value += amount;
+    return *this;
+  }
+
+  HYDE_RT_ALWAYS_INLINE ShardedStatCounter &operator++(void) noexcept {
+    return *this += 1u;
+  }
+
+  uint64_t Load(void) const noexcept {
+    uint64_t sum = 0u;
+    for (const auto &shard : shards) {
+      sum += shard.value.Load();
+    }
+    return sum;
+  }
+
+  HYDE_RT_ALWAYS_INLINE operator uint64_t(void) const noexcept {
+    return Load();
+  }
+
+ private:
+  struct alignas(64) Shard {
+    StatCounter value;
+  };
+
+  // The shard of the calling thread.
+  HYDE_RT_ALWAYS_INLINE static unsigned ShardIndex(void) noexcept {
+    static std::atomic<unsigned> next_shard{0u};
+    static thread_local const unsigned shard =
+        next_shard.fetch_add(1u, std::memory_order_relaxed) % kNumShards;
+    return shard;
+  }
+
+  std::array<Shard, kNumShards> shards;
+};
+
+// Counters describing how a table has been used.
+struct TableStats {
+
+  // Number of records in the table, in any state.
+  StatCounter num_records;
+
+  // Number of times a tuple changed into the present state.
+  StatCounter num_inserts;
+
+  // Number of times a tuple changed state, in any direction.
+  StatCounter num_state_changes;
+
+  // Number of times a tuple's record was looked up by its column values, and
+  // how many of those lookups were answered by the bloom filter alone. Queries
+  // do lookups concurrently, so these are sharded by thread.
+  ShardedStatCounter num_lookups;
+  ShardedStatCounter num_bloom_filter_hits;
+
+  // Number of range scans that found their ordered view of the table up to
+  // date, versus needing to sort and merge in newly added records.
+  StatCounter num_view_cache_hits;
+  StatCounter num_view_cache_misses;
+};
+
+// Counters describing how often a generated procedure was called, and how
+// long it spent running.
+struct ProcedureStats {
+  StatCounter num_calls;
+
+  // Total time spent in the procedure. This is only measured for procedures
+  // that are the entrypoints into the database, and so it includes the time
+  // spent in any procedures that they call.
+  StatCounter num_nanoseconds;
+};
+
+// Counters describing the fixpoint loop of an induction.
+struct InductionStats {
+
+  // Number of times the fixpoint loop ran to completion.
+  StatCounter num_runs;
+
+  // Total and largest number of iterations needed to reach a fixpoint.
+  StatCounter num_iterations;
+  StatCounter max_iterations;
+
+  // Number of tuples queued up by iterations for processing by the next
+  // iteration.
+  StatCounter num_new_tuples;
+};
+
+// Adds the time between its construction and destruction to a procedure's
+// stats.
+class ProcedureTimer {
+ public:
+  HYDE_RT_ALWAYS_INLINE explicit ProcedureTimer(ProcedureStats &stats_)
+      : stats(stats_),
+        start(std::chrono::steady_clock::now()) {}
+
+  HYDE_RT_ALWAYS_INLINE ~ProcedureTimer(void) {
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    stats.num_nanoseconds += static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  }
+
+ private:
+  ProcedureTimer(const ProcedureTimer &) = delete;
+  ProcedureTimer &operator=(const ProcedureTimer &) = delete;
+
+  ProcedureStats &stats;
+  const std::chrono::steady_clock::time_point start;
+};
+
+}  // namespace rt
+}  // namespace hyde
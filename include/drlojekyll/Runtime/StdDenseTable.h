@@ -0,0 +1,530 @@
+// Copyright 2021, Trail of Bits, Inc. All rights reserved.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "StdTable.h"
+
+namespace hyde {
+namespace rt {
+
+// Describes how a value of type `T` is packed into a bit field of a dense
+// tuple ordinal. Values are packed so that the order of the packed bits
+// matches the order of the values, i.e. signed values are biased.
+template <typename T, typename = void>
+struct StdDenseField;
+
+template <>
+struct StdDenseField<bool> {
+  static constexpr unsigned kNumBits = 1u;
+
+  HYDE_RT_ALWAYS_INLINE static uint32_t Pack(bool val) noexcept {
+    return val ? 1u : 0u;
+  }
+
+  HYDE_RT_ALWAYS_INLINE static bool Unpack(uint32_t bits) noexcept {
+    return bits != 0u;
+  }
+};
+
+template <typename T>
+struct StdDenseField<T, std::enable_if_t<std::is_enum_v<T> ||
+                                         std::is_integral_v<T>>> {
+ private:
+  using IntType = typename std::conditional_t<
+      std::is_enum_v<T>, std::underlying_type<T>,
+      std::enable_if<true, T>>::type;
+  using UIntType = std::make_unsigned_t<IntType>;
+
+  static constexpr UIntType kBias =
+      std::is_signed_v<IntType> ? (static_cast<UIntType>(1u) <<
+                                   ((sizeof(UIntType) * 8u) - 1u))
+                                : 0u;
+
+ public:
+  static constexpr unsigned kNumBits = sizeof(T) * 8u;
+
+  HYDE_RT_ALWAYS_INLINE static uint32_t Pack(T val) noexcept {
+    return static_cast<uint32_t>(
+        static_cast<UIntType>(static_cast<UIntType>(val) ^ kBias));
+  }
+
+  HYDE_RT_ALWAYS_INLINE static T Unpack(uint32_t bits) noexcept {
+    return static_cast<T>(static_cast<IntType>(
+        static_cast<UIntType>(static_cast<UIntType>(bits) ^ kBias)));
+  }
+};
+
+template <unsigned, typename>
+class StdDenseTableScan;
+
+template <unsigned, typename>
+class StdDenseIndexScan;
+
+template <unsigned, unsigned, RangeKind, typename>
+class StdDenseRangeScan;
+
+template <typename, typename>
+class StdDenseScanIterator;
+
+// A table whose columns all have tiny, statically known domains, e.g. enums
+// and booleans. Every possible tuple has a fixed ordinal, formed by packing
+// the column values together, so the state of a tuple is found by directly
+// indexing an array, and scans iterate over a bitmap of the tuples that have
+// ever been added.
+//
+// The code generator arranges for `TableDescriptor<kTableId>::kIsDense` to
+// be `true` for such tables.
+template <unsigned kTableId>
+class StdDenseTable {
+ public:
+  using TableDesc = TableDescriptor<kTableId>;
+  using TableHelper = StdTableHelper<TableDesc>;
+  using TupleType = typename TableHelper::TupleType;
+  using ColumnIdList = typename TableDesc::ColumnIds;
+
+  // A record is just the state of a tuple. Records never move, so pointers to
+  // them can be handed back to the `*Record*` methods, just like with
+  // `StdTable`.
+  using RecordType = TupleState;
+
+  static constexpr unsigned kNumColumns = TableHelper::kNumColumns;
+
+ private:
+  template <unsigned... kColumnIds>
+  static constexpr unsigned NumBits(IdList<kColumnIds...>) noexcept {
+    return (StdDenseField<typename ColumnDescriptor<kColumnIds>::Type>::kNumBits
+            + ... + 0u);
+  }
+
+ public:
+  static constexpr unsigned kNumBits = NumBits(ColumnIdList{});
+  static_assert(kNumBits <= 16u, "Domain of dense table is too big");
+
+  static constexpr uint32_t kNumTuples = 1u << kNumBits;
+  static constexpr uint32_t kNumWords = (kNumTuples + 63u) / 64u;
+
+  // Return the number of bits below the packed bits of the `kColumnOffset`th
+  // column in a tuple ordinal.
+  template <unsigned kColumnOffset>
+  static constexpr unsigned Shift(void) noexcept {
+    unsigned shift = 0u;
+    ShiftImpl<kColumnOffset>(shift, std::make_index_sequence<kNumColumns>{});
+    return shift;
+  }
+
+  // Return the number of bits used by the `kColumnOffset`th column.
+  template <unsigned kColumnOffset>
+  static constexpr unsigned Width(void) noexcept {
+    return StdDenseField<
+        std::tuple_element_t<kColumnOffset, TupleType>>::kNumBits;
+  }
+
+  // Return the ordinal of a tuple.
+  HYDE_RT_ALWAYS_INLINE static uint32_t Ordinal(
+      const TupleType &tuple) noexcept {
+    return OrdinalImpl(tuple, std::make_index_sequence<kNumColumns>{});
+  }
+
+  // Return the tuple with a given ordinal.
+  HYDE_RT_ALWAYS_INLINE static TupleType Tuple(uint32_t ordinal) noexcept {
+    return TupleImpl(ordinal, std::make_index_sequence<kNumColumns>{});
+  }
+
+  template <typename... Ts>
+  HYDE_RT_ALWAYS_INLINE TupleState GetState(Ts... cols) const noexcept {
+    return states[Ordinal(TupleType(std::move(cols)...))];
+  }
+
+  template <typename... Ts>
+  HYDE_RT_ALWAYS_INLINE
+  bool TryChangeTupleFromPresentToUnknown(Ts... cols) noexcept {
+    return CountStateChange(
+        ChangeState(&(states[Ordinal(TupleType(std::move(cols)...))]),
+                    TupleState::kPresent, TupleState::kUnknown));
+  }
+
+  template <typename... Ts>
+  HYDE_RT_ALWAYS_INLINE
+  bool TryChangeTupleFromPresentToAbsent(Ts... cols) noexcept {
+    return CountStateChange(
+        ChangeState(&(states[Ordinal(TupleType(std::move(cols)...))]),
+                    TupleState::kPresent, TupleState::kAbsent));
+  }
+
+  template <typename... Ts>
+  HYDE_RT_ALWAYS_INLINE
+  bool TryChangeTupleFromUnknownToAbsent(Ts... cols) noexcept {
+    return CountStateChange(
+        ChangeState(&(states[Ordinal(TupleType(std::move(cols)...))]),
+                    TupleState::kUnknown, TupleState::kAbsent));
+  }
+
+  // NOTE(pag): Tuples that have never been added are in the absent state, so
+  //            adding a tuple is the same as changing it from absent.
+  template <typename... Ts>
+  HYDE_RT_ALWAYS_INLINE
+  bool TryChangeTupleFromAbsentToPresent(Ts... cols) noexcept {
+    return CountInsert(TryChangeTupleToPresent(
+        AddRecord(Ordinal(TupleType(std::move(cols)...))),
+        TupleState::kAbsent, TupleState::kAbsent));
+  }
+
+  template <typename... Ts>
+  HYDE_RT_ALWAYS_INLINE
+  bool TryChangeTupleFromAbsentOrUnknownToPresent(Ts... cols) noexcept {
+    return CountInsert(TryChangeTupleToPresent(
+        AddRecord(Ordinal(TupleType(std::move(cols)...))),
+        TupleState::kAbsent, TupleState::kUnknown));
+  }
+
+  // Find the record associated with a tuple, returning `nullptr` if the tuple
+  // has never been added to this table.
+  template <typename... Ts>
+  HYDE_RT_ALWAYS_INLINE
+  RecordType *GetRecord(Ts... cols) const noexcept {
+    const auto ordinal = Ordinal(TupleType(std::move(cols)...));
+    if (HasRecord(ordinal)) {
+      return const_cast<RecordType *>(&(states[ordinal]));
+    } else {
+      return nullptr;
+    }
+  }
+
+  // Find the record associated with a tuple, or add a new record in the
+  // absent state if the tuple has never been added to this table.
+  template <typename... Ts>
+  HYDE_RT_ALWAYS_INLINE
+  RecordType *GetOrAddRecord(Ts... cols) noexcept {
+    return AddRecord(Ordinal(TupleType(std::move(cols)...)));
+  }
+
+  HYDE_RT_ALWAYS_INLINE
+  static TupleState GetRecordState(const RecordType *record) noexcept {
+    return *record;
+  }
+
+  HYDE_RT_ALWAYS_INLINE
+  bool TryChangeRecordFromPresentToUnknown(RecordType *record) noexcept {
+    return CountStateChange(
+        ChangeState(record, TupleState::kPresent, TupleState::kUnknown));
+  }
+
+  HYDE_RT_ALWAYS_INLINE
+  bool TryChangeRecordFromPresentToAbsent(RecordType *record) noexcept {
+    return CountStateChange(
+        ChangeState(record, TupleState::kPresent, TupleState::kAbsent));
+  }
+
+  HYDE_RT_ALWAYS_INLINE
+  bool TryChangeRecordFromUnknownToAbsent(RecordType *record) noexcept {
+    return CountStateChange(
+        ChangeState(record, TupleState::kUnknown, TupleState::kAbsent));
+  }
+
+  HYDE_RT_ALWAYS_INLINE
+  bool TryChangeRecordFromAbsentToPresent(RecordType *record) noexcept {
+    return CountInsert(TryChangeTupleToPresent(record, TupleState::kAbsent,
+                                               TupleState::kAbsent));
+  }
+
+  HYDE_RT_ALWAYS_INLINE
+  bool TryChangeRecordFromAbsentOrUnknownToPresent(
+      RecordType *record) noexcept {
+    return CountInsert(TryChangeTupleToPresent(record, TupleState::kAbsent,
+                                               TupleState::kUnknown));
+  }
+
+  // Return the number of records in the table.
+  uint64_t Size(void) const noexcept {
+    return num_records;
+  }
+
+  // Return the usage counters of this table. Dense tables are indexed
+  // directly, so they never perform lookups.
+  TableStats Stats(void) const noexcept {
+    TableStats ret = stats;
+    ret.num_records = num_records;
+    return ret;
+  }
+
+ private:
+  template <typename, typename>
+  friend class StdDenseScanIterator;
+
+  template <unsigned kColumnOffset, size_t... kIndices>
+  static constexpr void ShiftImpl(unsigned &shift,
+                                  std::index_sequence<kIndices...>) noexcept {
+    ((shift += (kIndices < kColumnOffset ? Width<kIndices>() : 0u)), ...);
+  }
+
+  template <size_t... kIndices>
+  HYDE_RT_ALWAYS_INLINE static uint32_t OrdinalImpl(
+      const TupleType &tuple, std::index_sequence<kIndices...>) noexcept {
+    return ((StdDenseField<std::tuple_element_t<kIndices, TupleType>>::Pack(
+                 std::get<kIndices>(tuple)) << Shift<kIndices>()) | ... | 0u);
+  }
+
+  template <size_t... kIndices>
+  HYDE_RT_ALWAYS_INLINE static TupleType TupleImpl(
+      uint32_t ordinal, std::index_sequence<kIndices...>) noexcept {
+    return TupleType(
+        StdDenseField<std::tuple_element_t<kIndices, TupleType>>::Unpack(
+            (ordinal >> Shift<kIndices>()) &
+            ((1u << Width<kIndices>()) - 1u))...);
+  }
+
+  HYDE_RT_ALWAYS_INLINE bool CountStateChange(bool changed) noexcept {
+    stats.num_state_changes += changed;
+    return changed;
+  }
+
+  HYDE_RT_ALWAYS_INLINE bool CountInsert(bool changed) noexcept {
+    stats.num_state_changes += changed;
+    stats.num_inserts += changed;
+    return changed;
+  }
+
+  HYDE_RT_ALWAYS_INLINE bool HasRecord(uint32_t ordinal) const noexcept {
+    return (has_record[ordinal / 64u] >> (ordinal % 64u)) & 1u;
+  }
+
+  HYDE_RT_ALWAYS_INLINE RecordType *AddRecord(uint32_t ordinal) noexcept {
+    auto &word = has_record[ordinal / 64u];
+    const auto bit = static_cast<uint64_t>(1u) << (ordinal % 64u);
+    if (!(word & bit)) {
+      word |= bit;
+      ++num_records;
+    }
+    return &(states[ordinal]);
+  }
+
+  // The state of every possible tuple, indexed by ordinal.
+  std::array<TupleState, kNumTuples> states{};
+
+  // Bitmap of the tuples that have ever been added to this table.
+  std::array<uint64_t, kNumWords> has_record{};
+
+  uint64_t num_records{0};
+
+  TableStats stats;
+};
+
+// An iterator over the records of a dense table. This visits the ordinals of
+// the records in increasing order. Only those ordinals whose bits under `mask`
+// equal `bits`, and whose bit field at `[shift, shift + width)` is in the
+// range `[low, high]`, are visited. This lets us implement table, index, and
+// range scans with one iterator.
+template <typename Table, typename StateFilter>
+class StdDenseScanIterator {
+ private:
+  const Table *table{nullptr};
+  uint32_t ordinal{Table::kNumTuples};
+  uint32_t mask{0u};
+  uint32_t bits{0u};
+  uint32_t field_shift{0u};
+  uint32_t field_mask{0u};
+  uint32_t low{0u};
+  uint32_t high{0u};
+
+ public:
+  using Self = StdDenseScanIterator<Table, StateFilter>;
+  using RecordType = typename Table::RecordType;
+
+  HYDE_RT_ALWAYS_INLINE StdDenseScanIterator(void) = default;
+
+  HYDE_RT_ALWAYS_INLINE StdDenseScanIterator(
+      const Table &table_, uint32_t mask_, uint32_t bits_,
+      uint32_t field_shift_, uint32_t field_mask_, uint32_t low_,
+      uint32_t high_) noexcept
+      : table(&table_),
+        ordinal(0u),
+        mask(mask_),
+        bits(bits_),
+        field_shift(field_shift_),
+        field_mask(field_mask_),
+        low(low_),
+        high(high_) {
+    SkipRejected();
+  }
+
+  HYDE_RT_ALWAYS_INLINE bool operator==(const Self &that) const noexcept {
+    return ordinal == that.ordinal;
+  }
+
+  HYDE_RT_ALWAYS_INLINE bool operator!=(const Self &that) const noexcept {
+    return ordinal != that.ordinal;
+  }
+
+  // Return the tuple of the current record. Dense tables don't store their
+  // tuples, so this is unpacked from the ordinal.
+  HYDE_RT_ALWAYS_INLINE typename Table::TupleType operator*(
+      void) const noexcept {
+    return Table::Tuple(ordinal);
+  }
+
+  // Return the current record.
+  HYDE_RT_ALWAYS_INLINE RecordType *Record(void) const noexcept {
+    return const_cast<RecordType *>(&(table->states[ordinal]));
+  }
+
+  // Return the state of the current record.
+  HYDE_RT_ALWAYS_INLINE TupleState State(void) const noexcept {
+    return table->states[ordinal];
+  }
+
+  HYDE_RT_ALWAYS_INLINE void operator++(void) noexcept {
+    ++ordinal;
+    SkipRejected();
+  }
+
+ private:
+
+  // Move forward until we find a record that is accepted by the filters, or
+  // until we reach the end of the table.
+  HYDE_RT_ALWAYS_INLINE void SkipRejected(void) noexcept {
+    for (; ordinal < Table::kNumTuples; ++ordinal) {
+
+      // Skip quickly over the ordinals of tuples that were never added.
+      uint64_t word = table->has_record[ordinal / 64u] >> (ordinal % 64u);
+      if (!word) {
+        ordinal = ((ordinal / 64u) * 64u) + 63u;
+        continue;
+      }
+      ordinal += static_cast<uint32_t>(__builtin_ctzll(word));
+
+      const auto field = (ordinal >> field_shift) & field_mask;
+      if ((ordinal & mask) == bits && low <= field && field <= high &&
+          StateFilter::Accepts(table->states[ordinal])) {
+        return;
+      }
+    }
+    ordinal = Table::kNumTuples;
+  }
+};
+
+// A scanner for iterating through all records in a dense table whose states
+// are accepted by `StateFilter`.
+template <unsigned kTableId, typename StateFilter>
+class StdDenseTableScan {
+ private:
+  using Table = StdDenseTable<kTableId>;
+
+  const Table &table;
+
+ public:
+  using Iterator = StdDenseScanIterator<Table, StateFilter>;
+
+  HYDE_RT_ALWAYS_INLINE StdDenseTableScan(StdStorage &, Table &table_) noexcept
+      : table(table_) {}
+
+  HYDE_RT_ALWAYS_INLINE Iterator begin(void) const noexcept {
+    return Iterator(table, 0u, 0u, 0u, 0u, 0u, 0u);
+  }
+
+  HYDE_RT_ALWAYS_INLINE Iterator end(void) const noexcept {
+    return Iterator();
+  }
+};
+
+// A scanner for iterating through the records in a dense table whose key
+// columns match some values. Unlike a `StdIndexScan`, this visits exactly the
+// matching records, because the key columns are compared by their packed bits.
+template <unsigned kIndexId, typename StateFilter>
+class StdDenseIndexScan {
+ private:
+  using IndexDesc = IndexDescriptor<kIndexId>;
+  using Table = StdDenseTable<IndexDesc::kTableId>;
+  using TupleType = typename Table::TupleType;
+
+  const Table &table;
+  uint32_t mask{0u};
+  uint32_t bits{0u};
+
+  template <unsigned... kKeyColumnOffsets, typename... Ts>
+  HYDE_RT_ALWAYS_INLINE void PackKeys(IdList<kKeyColumnOffsets...>,
+                                      const Ts &...cols) noexcept {
+    static_assert(sizeof...(kKeyColumnOffsets) == sizeof...(Ts));
+    ((mask |= ((1u << Table::template Width<kKeyColumnOffsets>()) - 1u)
+              << Table::template Shift<kKeyColumnOffsets>(),
+      bits |= StdDenseField<std::tuple_element_t<kKeyColumnOffsets,
+                                                 TupleType>>::Pack(cols)
+              << Table::template Shift<kKeyColumnOffsets>()), ...);
+  }
+
+ public:
+  using Iterator = StdDenseScanIterator<Table, StateFilter>;
+
+  template <typename... Ts>
+  HYDE_RT_ALWAYS_INLINE StdDenseIndexScan(StdStorage &, Table &table_,
+                                          Ts &&...cols) noexcept
+      : table(table_) {
+    PackKeys(typename IndexDesc::KeyColumnOffsets{}, cols...);
+  }
+
+  HYDE_RT_ALWAYS_INLINE Iterator begin(void) const noexcept {
+    return Iterator(table, mask, bits, 0u, 0u, 0u, 0u);
+  }
+
+  HYDE_RT_ALWAYS_INLINE Iterator end(void) const noexcept {
+    return Iterator();
+  }
+};
+
+// A scanner for iterating through the records in a dense table whose
+// `kColumnOffset`th column is less than (or greater than, depending on
+// `kKind`) a bound value. Packed column values have the same order as the
+// values themselves, so this compares packed bits.
+template <unsigned kTableId, unsigned kColumnOffset, RangeKind kKind,
+          typename StateFilter>
+class StdDenseRangeScan {
+ private:
+  using Table = StdDenseTable<kTableId>;
+  using ColumnType = std::tuple_element_t<kColumnOffset,
+                                          typename Table::TupleType>;
+
+  static constexpr uint32_t kFieldMask =
+      (1u << Table::template Width<kColumnOffset>()) - 1u;
+
+  const Table &table;
+  uint32_t low{0u};
+  uint32_t high{kFieldMask};
+  bool is_empty{false};
+
+ public:
+  using Iterator = StdDenseScanIterator<Table, StateFilter>;
+
+  HYDE_RT_ALWAYS_INLINE StdDenseRangeScan(StdStorage &, Table &table_,
+                                          const ColumnType &bound) noexcept
+      : table(table_) {
+    const auto packed_bound = StdDenseField<ColumnType>::Pack(bound);
+    if constexpr (kKind == RangeKind::kLessThan) {
+      is_empty = !packed_bound;
+      high = packed_bound - 1u;
+    } else {
+      is_empty = packed_bound == kFieldMask;
+      low = packed_bound + 1u;
+    }
+  }
+
+  HYDE_RT_ALWAYS_INLINE Iterator begin(void) const noexcept {
+    if (is_empty) {
+      return Iterator();
+    } else {
+      return Iterator(table, 0u, 0u, Table::template Shift<kColumnOffset>(),
+                      kFieldMask, low, high);
+    }
+  }
+
+  HYDE_RT_ALWAYS_INLINE Iterator end(void) const noexcept {
+    return Iterator();
+  }
+};
+
+}  // namespace rt
+}  // namespace hyde
@@ -8,6 +8,7 @@
 #include <vector>
 
 #include "Runtime.h"
+#include "StdDenseTable.h"
 #include "StdScan.h"
 #include "StdTable.h"
 #include "StdVector.h"
@@ -2,25 +2,56 @@
 
 #pragma once
 
+#include <algorithm>
 #include <memory>
 
+#include "StdDenseTable.h"
 #include "StdTable.h"
 
 namespace hyde {
 namespace rt {
 
-// An iterator that scans through a linked list of records, where the next
-// pointer of the record is stored at `std::get<2>(record)[kBackLink]`.
-// A `kBackLink` value of `0` means we're traversing through the table,
-// and of `N + 1` means we're traversing through the table's `N`th index.
-template <typename RecordType, unsigned kBackLink, bool kIsTableScan>
+// A state filter that accepts every record, regardless of its state.
+struct StdAnyStateFilter {
+  static constexpr bool kFiltersStates = false;
+
+  HYDE_RT_ALWAYS_INLINE static bool Accepts(TupleState) noexcept {
+    return true;
+  }
+};
+
+// A state filter that accepts only those records whose state is one of
+// `kStates`.
+template <TupleState... kStates>
+struct StdStateFilter {
+  static_assert(0u < sizeof...(kStates));
+
+  static constexpr bool kFiltersStates = true;
+
+  HYDE_RT_ALWAYS_INLINE static bool Accepts(TupleState state) noexcept {
+    return ((state == kStates) || ...);
+  }
+};
+
+// An iterator that scans through a linked list of records, where the link to
+// the next record is stored at `std::get<2>(record)[kBackLink]`. Links are
+// resolved to records using the table's record arena.
+//
+// Records whose state isn't accepted by `StateFilter` are skipped over by
+// the iterator, so that generated code doesn't need to go and re-hash the
+// tuple just to ask the table for its state.
+template <typename RecordType, unsigned kBackLink, bool kIsTableScan,
+          typename StateFilter = StdAnyStateFilter>
 class StdScanIterator {
  private:
+  using ArenaType = StdRecordArena<RecordType>;
+
+  const ArenaType *arena{nullptr};
   RecordType *ptr{nullptr};
-  std::atomic<RecordType *> *scanned_ptr{nullptr};
 
  public:
-  using Self = StdScanIterator<RecordType, kBackLink, kIsTableScan>;
+  using Self = StdScanIterator<RecordType, kBackLink, kIsTableScan,
+                               StateFilter>;
 
   static constexpr size_t kStateIndex = 0u;
   static constexpr size_t kTupleIndex = 1u;
@@ -28,27 +59,31 @@ class StdScanIterator {
 
   HYDE_RT_ALWAYS_INLINE StdScanIterator(void) = default;
 
-  HYDE_RT_ALWAYS_INLINE explicit StdScanIterator(
-      RecordType *ptr_, std::atomic<RecordType *> *scanned_ptr_) noexcept
-      : ptr(ptr_),
-        scanned_ptr(scanned_ptr_) {}
+  HYDE_RT_ALWAYS_INLINE StdScanIterator(const ArenaType &arena_,
+                                        StdRecordLink first) noexcept
+      : arena(&arena_),
+        ptr(arena_.Resolve(first)) {
+    if constexpr (StateFilter::kFiltersStates) {
+      SkipRejected();
+    }
+  }
 
   HYDE_RT_ALWAYS_INLINE StdScanIterator(const Self &that) noexcept
-      : ptr(that.ptr),
-        scanned_ptr(that.scanned_ptr) {}
+      : arena(that.arena),
+        ptr(that.ptr) {}
 
   HYDE_RT_ALWAYS_INLINE StdScanIterator(Self &&that) noexcept
-      : ptr(that.ptr),
-        scanned_ptr(that.scanned_ptr) {}
+      : arena(that.arena),
+        ptr(that.ptr) {}
 
   HYDE_RT_ALWAYS_INLINE void operator=(const Self &that) noexcept {
+    arena = that.arena;
     ptr = that.ptr;
-    scanned_ptr = that.scanned_ptr;
   }
 
   HYDE_RT_ALWAYS_INLINE void operator=(Self &&that) noexcept {
+    arena = that.arena;
     ptr = that.ptr;
-    scanned_ptr = that.scanned_ptr;
   }
 
   HYDE_RT_ALWAYS_INLINE bool operator==(Self that) const noexcept {
@@ -59,63 +94,88 @@ class StdScanIterator {
     return ptr != that.ptr;
   }
 
-  // Return the tuple pointed to by the scan's pointer, and store it back into
-  // the table as our most recently scanned tuple.
+  // Return the tuple pointed to by the scan's pointer.
   HYDE_RT_ALWAYS_INLINE auto operator*(void) const noexcept
       -> decltype(std::get<kTupleIndex>(*this->ptr)) {
-    scanned_ptr->store(ptr, std::memory_order_release);
     return std::get<kTupleIndex>(*ptr);
   }
 
+  // Return the record pointed to by the scan's pointer. Records never move,
+  // so this can be handed to the table's `*Record*` methods in order to check
+  // or change the state of the record without re-hashing its tuple.
+  HYDE_RT_ALWAYS_INLINE RecordType *Record(void) const noexcept {
+    return ptr;
+  }
+
+  // Return the state of the record pointed to by the scan's pointer. This
+  // doesn't require hashing the tuple.
+  HYDE_RT_ALWAYS_INLINE TupleState State(void) const noexcept {
+    return std::get<kStateIndex>(*ptr);
+  }
+
   // The full table records are of the form:
   //
-  //    pair<pair<TupleState, TupleType>, std::array<void *, kNumIndices + 1u>>
+  //    tuple<TupleState, TupleType, std::array<StdRecordLink, kNumIndices>>
   //
-  // The first pointer connects together every tuple in the table. The remaining
-  // pointers connect together tuples with identical hashes in the indices.
+  // The links connect together tuples with identical hashes in the indices,
+  // and the last link for each hash connects to tuples with other hashes.
   HYDE_RT_ALWAYS_INLINE void operator++(void) noexcept {
-    const auto addr = reinterpret_cast<uintptr_t>(
-        std::get<kBackLink>(std::get<kBackLinksIndex>(*ptr)));
+    Advance();
+    if constexpr (StateFilter::kFiltersStates) {
+      SkipRejected();
+    }
+  }
+
+ private:
+  HYDE_RT_ALWAYS_INLINE void Advance(void) noexcept {
+    const StdRecordLink link =
+        std::get<kBackLink>(std::get<kBackLinksIndex>(*ptr));
 
-    // If it's an index scan, then we want to treat a pointer to tuple with
-    // a different hash as a null pointer.
+    // If it's an index scan, then we want to treat a link to tuple with
+    // a different hash as a null link.
     if constexpr (!kIsTableScan) {
-      static constexpr auto kShift = (sizeof(void *) * 8u) - 1u;
-      auto mask = (~static_cast<uintptr_t>(
-          static_cast<intptr_t>(addr << kShift) >> kShift)) << 1u;
-      ptr = reinterpret_cast<RecordType *>(addr & mask);
+      ptr = (link & 1u) ? nullptr : arena->Resolve(link);
 
-    // If it's a table scan, then we want to follow all pointers, even if they
+    // If it's a table scan, then we want to follow all links, even if they
     // cross to a different hash.
     } else {
-      ptr = reinterpret_cast<RecordType *>((addr >> 1u) << 1u);
+      ptr = arena->Resolve(link);
+    }
+  }
+
+  // Move forward until we find a record whose state is accepted by the
+  // filter, or until we reach the end of the list.
+  HYDE_RT_ALWAYS_INLINE void SkipRejected(void) noexcept {
+    while (ptr && !StateFilter::Accepts(std::get<kStateIndex>(*ptr))) {
+      Advance();
     }
   }
 };
 
-// A scanner for iterating through all records in a table.
-template <unsigned kTableId>
+// A scanner for iterating through all records in a table whose states are
+// accepted by `StateFilter`.
+template <unsigned kTableId, typename StateFilter>
 class StdTableScan {
  private:
   using TableDesc = TableDescriptor<kTableId>;
   using Table = StdTable<kTableId>;
   using RecordType = typename Table::RecordType;
 
-  std::atomic<RecordType *> * const last_scanned_record;
-  RecordType ** const first{nullptr};
+  const typename Table::ArenaType &arena;
+  const StdRecordLink * const first{nullptr};
 
  public:
 
   // The iterator for a full table scan uses the offset `0` in the embedded
   // `std::array` of a table, representing
-  using Iterator = StdScanIterator<RecordType, 0u, true>;
+  using Iterator = StdScanIterator<RecordType, 0u, true, StateFilter>;
 
   HYDE_RT_ALWAYS_INLINE StdTableScan(StdStorage &, Table &table) noexcept
-      : last_scanned_record(&(table.last_scanned_record)),
-        first(&(reinterpret_cast<RecordType *&>(table.last_record))) {}
+      : arena(table.records),
+        first(&(table.last_record)) {}
 
   HYDE_RT_ALWAYS_INLINE Iterator begin(void) const noexcept {
-    return Iterator(*first, last_scanned_record);
+    return Iterator(arena, *first);
   }
 
   HYDE_RT_ALWAYS_INLINE Iterator end(void) const noexcept {
@@ -125,8 +185,9 @@ class StdTableScan {
 
 // A scanner for iterating through all records in a particular index. This will
 // actually scan through a superset of what's in the index -- it scans through
-// everything that has the same hash.
-template <unsigned kIndexId>
+// everything that has the same hash. Records whose states aren't accepted by
+// `StateFilter` are skipped.
+template <unsigned kIndexId, typename StateFilter>
 class StdIndexScan {
  private:
   using IndexDesc = IndexDescriptor<kIndexId>;
@@ -136,23 +197,32 @@ class StdIndexScan {
   using Table = StdTable<kTableId>;
   using RecordType = typename Table::RecordType;
 
-  std::atomic<RecordType *> * const last_scanned_record;
-  RecordType *dummy_first{nullptr};
-  RecordType **first{nullptr};
+  const typename Table::ArenaType &arena;
+  StdRecordLink dummy_first{0u};
+  const StdRecordLink *first{nullptr};
+
+  // Hash the values of the key columns using the same key types as the table,
+  // so that we select the same hashing path as `StdTable::AddToIndexes`.
+  template <unsigned... kKeyColumnOffsets, typename... Ts>
+  HYDE_RT_ALWAYS_INLINE static uint64_t HashKeyColumns(
+      IdList<kKeyColumnOffsets...>, const Ts &...cols) noexcept {
+    static_assert(sizeof...(kKeyColumnOffsets) == sizeof...(Ts));
+    return HashKey<std::tuple_element_t<kKeyColumnOffsets,
+                                        typename Table::TupleType>...>(
+        cols...);
+  }
 
  public:
 
-  using Iterator = StdScanIterator<RecordType, kOffset, false>;
+  using Iterator = StdScanIterator<RecordType, kOffset, false, StateFilter>;
 
   template <typename... Ts>
   StdIndexScan(StdStorage &, Table &table, Ts&&... cols) noexcept
-      : last_scanned_record(&(table.last_scanned_record)), first(&dummy_first) {
+      : arena(table.records),
+        first(&dummy_first) {
 
-    using TupleType = std::tuple<Ts...>;
-    TupleType tuple(std::forward<Ts>(cols)...);
-    HashingWriter writer;
-    Serializer<NullReader, HashingWriter, TupleType>::Write(writer, tuple);
-    auto hash = writer.Digest();
+    const auto hash = HashKeyColumns(
+        typename IndexDesc::KeyColumnOffsets{}, cols...);
 
     // NOTE(pag): This mutates the index, creating a null record if it's
     //            absent, but gives us visibility to future updates if
@@ -165,7 +235,7 @@ class StdIndexScan {
   }
 
   HYDE_RT_ALWAYS_INLINE Iterator begin(void) const noexcept {
-    return Iterator(*first, last_scanned_record);
+    return Iterator(arena, *first);
   }
 
   HYDE_RT_ALWAYS_INLINE Iterator end(void) const noexcept {
@@ -173,16 +243,202 @@ class StdIndexScan {
   }
 };
 
+// An iterator over a sorted range of record pointers, skipping any records
+// whose state isn't accepted by `StateFilter`.
+template <typename RecordType, typename StateFilter = StdAnyStateFilter>
+class StdRangeScanIterator {
+ private:
+  RecordType * const *ptr{nullptr};
+  RecordType * const *end_ptr{nullptr};
+
+ public:
+  using Self = StdRangeScanIterator<RecordType, StateFilter>;
+
+  static constexpr size_t kStateIndex = 0u;
+  static constexpr size_t kTupleIndex = 1u;
+
+  HYDE_RT_ALWAYS_INLINE StdRangeScanIterator(void) = default;
+
+  HYDE_RT_ALWAYS_INLINE StdRangeScanIterator(
+      RecordType * const *ptr_, RecordType * const *end_ptr_) noexcept
+      : ptr(ptr_),
+        end_ptr(end_ptr_) {
+    if constexpr (StateFilter::kFiltersStates) {
+      SkipRejected();
+    }
+  }
+
+  HYDE_RT_ALWAYS_INLINE bool operator==(const Self &that) const noexcept {
+    return ptr == that.ptr;
+  }
+
+  HYDE_RT_ALWAYS_INLINE bool operator!=(const Self &that) const noexcept {
+    return ptr != that.ptr;
+  }
+
+  // Return the tuple pointed to by the scan's pointer.
+  HYDE_RT_ALWAYS_INLINE auto operator*(void) const noexcept
+      -> decltype(std::get<kTupleIndex>(**this->ptr)) {
+    return std::get<kTupleIndex>(**ptr);
+  }
+
+  // Return the record pointed to by the scan's pointer.
+  HYDE_RT_ALWAYS_INLINE RecordType *Record(void) const noexcept {
+    return *ptr;
+  }
+
+  // Return the state of the record pointed to by the scan's pointer.
+  HYDE_RT_ALWAYS_INLINE TupleState State(void) const noexcept {
+    return std::get<kStateIndex>(**ptr);
+  }
+
+  HYDE_RT_ALWAYS_INLINE void operator++(void) noexcept {
+    ++ptr;
+    if constexpr (StateFilter::kFiltersStates) {
+      SkipRejected();
+    }
+  }
+
+ private:
+  HYDE_RT_ALWAYS_INLINE void SkipRejected(void) noexcept {
+    while (ptr != end_ptr &&
+           !StateFilter::Accepts(std::get<kStateIndex>(**ptr))) {
+      ++ptr;
+    }
+  }
+};
+
+// A scanner for iterating through the records of a table whose
+// `kColumnOffset`th column is less than (or greater than, depending on
+// `kKind`) a bound value, in order of that column. This uses an ordered view
+// of the table, so only the records within the range are visited, instead of
+// having to scan the whole table and filter.
+//
+// The scan holds a reference to the ordered view as it was when the scan was
+// created, so records added to the table during the scan aren't visited.
+template <unsigned kTableId, unsigned kColumnOffset, RangeKind kKind,
+          typename StateFilter>
+class StdRangeScan {
+ private:
+  using Table = StdTable<kTableId>;
+  using RecordType = typename Table::RecordType;
+  using OrderedRecords = typename Table::OrderedRecords;
+  using ColumnType = std::tuple_element_t<kColumnOffset,
+                                          typename Table::TupleType>;
+
+  static constexpr size_t kTupleIndex = 1u;
+
+  const std::shared_ptr<const OrderedRecords> ordered;
+  RecordType * const *first{nullptr};
+  RecordType * const *last{nullptr};
+
+ public:
+  using Iterator = StdRangeScanIterator<RecordType, StateFilter>;
+
+  StdRangeScan(StdStorage &, Table &table, const ColumnType &bound) noexcept
+      : ordered(table.template GetOrderedRecords<kColumnOffset>()) {
+
+    const auto begin = ordered->begin();
+    const auto end = ordered->end();
+
+    // Records whose column is strictly less than `bound`.
+    if constexpr (kKind == RangeKind::kLessThan) {
+      const auto it = std::lower_bound(
+          begin, end, bound,
+          [] (const RecordType *record, const ColumnType &val) {
+            return std::get<kColumnOffset>(std::get<kTupleIndex>(*record)) <
+                   val;
+          });
+      first = ordered->data();
+      last = first + (it - begin);
+
+    // Records whose column is strictly greater than `bound`.
+    } else {
+      const auto it = std::upper_bound(
+          begin, end, bound,
+          [] (const ColumnType &val, const RecordType *record) {
+            return val <
+                   std::get<kColumnOffset>(std::get<kTupleIndex>(*record));
+          });
+      first = ordered->data() + (it - begin);
+      last = ordered->data() + ordered->size();
+    }
+  }
+
+  HYDE_RT_ALWAYS_INLINE Iterator begin(void) const noexcept {
+    return Iterator(first, last);
+  }
+
+  HYDE_RT_ALWAYS_INLINE Iterator end(void) const noexcept {
+    return Iterator(last, last);
+  }
+};
+
+// Select the scanners for dense or hashed tables.
+template <unsigned kTableId, typename StateFilter>
+using StdTableScanFor =
+    std::conditional_t<TableDescriptor<kTableId>::kIsDense,
+                       StdDenseTableScan<kTableId, StateFilter>,
+                       StdTableScan<kTableId, StateFilter>>;
+
+template <unsigned kIndexId, typename StateFilter>
+using StdIndexScanFor = std::conditional_t<
+    TableDescriptor<IndexDescriptor<kIndexId>::kTableId>::kIsDense,
+    StdDenseIndexScan<kIndexId, StateFilter>,
+    StdIndexScan<kIndexId, StateFilter>>;
+
+template <unsigned kTableId, unsigned kColumnOffset, RangeKind kKind,
+          typename StateFilter>
+using StdRangeScanFor = std::conditional_t<
+    TableDescriptor<kTableId>::kIsDense,
+    StdDenseRangeScan<kTableId, kColumnOffset, kKind, StateFilter>,
+    StdRangeScan<kTableId, kColumnOffset, kKind, StateFilter>>;
+
 template <unsigned kTableId>
-class Scan<StdStorage, TableTag<kTableId>> : public StdTableScan<kTableId> {
+class Scan<StdStorage, TableTag<kTableId>>
+    : public StdTableScanFor<kTableId, StdAnyStateFilter> {
+  using Base = StdTableScanFor<kTableId, StdAnyStateFilter>;
+
  public:
-  using StdTableScan<kTableId>::StdTableScan;
+  using Base::Base;
 };
 
 template <unsigned kIndexId>
-class Scan<StdStorage, IndexTag<kIndexId>> : public StdIndexScan<kIndexId> {
+class Scan<StdStorage, IndexTag<kIndexId>>
+    : public StdIndexScanFor<kIndexId, StdAnyStateFilter> {
+  using Base = StdIndexScanFor<kIndexId, StdAnyStateFilter>;
+
+ public:
+  using Base::Base;
+};
+
+template <unsigned kTableId, TupleState... kStates>
+class Scan<StdStorage, FilteredTableTag<kTableId, kStates...>>
+    : public StdTableScanFor<kTableId, StdStateFilter<kStates...>> {
+  using Base = StdTableScanFor<kTableId, StdStateFilter<kStates...>>;
+
+ public:
+  using Base::Base;
+};
+
+template <unsigned kIndexId, TupleState... kStates>
+class Scan<StdStorage, FilteredIndexTag<kIndexId, kStates...>>
+    : public StdIndexScanFor<kIndexId, StdStateFilter<kStates...>> {
+  using Base = StdIndexScanFor<kIndexId, StdStateFilter<kStates...>>;
+
+ public:
+  using Base::Base;
+};
+
+template <unsigned kTableId, unsigned kColumnOffset, RangeKind kKind>
+class Scan<StdStorage, RangeTag<kTableId, kColumnOffset, kKind>>
+    : public StdRangeScanFor<kTableId, kColumnOffset, kKind,
+                             StdAnyStateFilter> {
+  using Base = StdRangeScanFor<kTableId, kColumnOffset, kKind,
+                               StdAnyStateFilter>;
+
  public:
-  using StdIndexScan<kIndexId>::StdIndexScan;
+  using Base::Base;
 };
 
 }  // namespace rt
@@ -14,7 +14,7 @@ struct InternedValue {
  public:
 
   template <typename T>
-  static bool CompareValues(void *a_opaque, void *b_opaque) {
+  static bool CompareValues(const void *a_opaque, const void *b_opaque) {
     const T &a = *reinterpret_cast<const T *>(a_opaque);
     const T &b = *reinterpret_cast<const T *>(b_opaque);
     return a == b;
@@ -24,23 +24,27 @@ struct InternedValue {
 
   template <typename T>
   static void DestroyPersistent(void *opaque) {
-    delete reinterpret_cast<T *>(opaque);
+    delete reinterpret_cast<InternedData<T> *>(opaque);
   }
 
-  mutable void *data{nullptr};
+  // Pointer to the value, used for comparisons.
+  mutable const void *data{nullptr};
+
+  // Pointer to the `InternedData<T>` holding the value, if any.
+  mutable void *interned_data{nullptr};
   mutable void (*destroy_data)(void *);
   uint64_t hash{0};
-  bool (*compare_values)(void *, void *);
+  bool (*compare_values)(const void *, const void *);
   unsigned serialized_length{0};
 
   ~InternedValue(void) {
-    destroy_data(data);
+    destroy_data(interned_data);
   }
 };
 
 struct HashInternedValue {
  public:
-  inline bool operator()(const InternedValue &a) const noexcept {
+  inline size_t operator()(const InternedValue &a) const noexcept {
     return a.hash;
   }
 };
@@ -68,7 +72,7 @@ class StdStorage {
 
   // Intern a value.
   template <typename T>
-  const T &Intern(T &&val) {
+  InternRef<T> Intern(T &&val) {
     using Writer = ByteCountingWriterProxy<HashingWriter>;
     Writer writer;
     Serializer<NullReader, Writer, T>::Write(writer, val);
@@ -83,19 +87,24 @@ class StdStorage {
     auto [it, added] = interned_data.emplace(std::move(dummy_val));
     if (added) {
       const InternedValue &persist_val = *it;
-      persist_val.data = new T(std::forward<T>(val));
+      auto data = new InternedData<T>(persist_val.hash, next_id++,
+                                      std::forward<T>(val));
+      persist_val.data = &(data->value);
+      persist_val.interned_data = data;
       persist_val.destroy_data = &InternedValue::DestroyPersistent<T>;
     }
 
-    return *reinterpret_cast<const T *>(it->data);
+    return reinterpret_cast<const InternedData<T> *>(it->interned_data);
   }
 
   template <typename T, typename ParamT>
-  inline const T &Intern(ParamT val) {
+  inline InternRef<T> Intern(ParamT val) {
     return Intern(T(val));
   }
 
  private:
+  uint64_t next_id{0};
+
   std::unordered_set<InternedValue, HashInternedValue,
                      CompareInternedValues> interned_data;
 };
@@ -2,27 +2,156 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
-#include <atomic>
 #include <bitset>
 #include <cassert>
 #include <memory>
-#include <deque>
+#include <new>
 #include <tuple>
+#include <type_traits>
 #include <utility>
 #include <unordered_map>
+#include <vector>
 
+#include "Stats.h"
 #include "StdStorage.h"
 
 namespace hyde {
 namespace rt {
 
-template <unsigned>
+template <unsigned, typename>
 class StdTableScan;
 
-template <unsigned>
+template <unsigned, typename>
 class StdIndexScan;
 
+template <unsigned, unsigned, RangeKind, typename>
+class StdRangeScan;
+
+template <unsigned>
+class StdDenseTable;
+
+// A link from one record to another. The low bit of a link is used to tag
+// whether or not the linked record has a different hash than the linking
+// record, and a link whose remaining bits are zero is a null link.
+//
+// By default, links are tagged record pointers. If
+// `HYDE_RT_COMPACT_RECORD_LINKS` is defined, then links are instead tagged
+// 32-bit record ordinals into the table's record arena. This halves the size
+// of every record's back-links on 64-bit targets, at the cost of an extra
+// indirection through the arena when following a link.
+#ifdef HYDE_RT_COMPACT_RECORD_LINKS
+using StdRecordLink = uint32_t;
+#else
+using StdRecordLink = uintptr_t;
+#endif
+
+// Backing storage for all records of a table. Records are allocated in
+// chunks, so they never move once added. The first chunk is small, so that
+// tables with few records stay small, and each chunk after it is twice the
+// size of the one before, so that chunk `k` holds `kFirstChunkSize << k`
+// records. This makes the ordinal of a record, plus `kFirstChunkSize`, encode
+// the chunk holding that record in the position of its most significant bit,
+// and the offset of the record in the chunk in the remaining bits.
+template <typename RecordType>
+class StdRecordArena {
+ public:
+  static constexpr unsigned kFirstChunkShift = 4u;
+  static constexpr size_t kFirstChunkSize = 1u << kFirstChunkShift;
+
+  HYDE_RT_ALWAYS_INLINE StdRecordArena(void) = default;
+
+  StdRecordArena(const StdRecordArena &) = delete;
+  StdRecordArena(StdRecordArena &&) noexcept = delete;
+  StdRecordArena &operator=(const StdRecordArena &) = delete;
+  StdRecordArena &operator=(StdRecordArena &&) noexcept = delete;
+
+  ~StdRecordArena(void) {
+    for (size_t i = 0u; i < num_records; ++i) {
+      (*this)[i].~RecordType();
+    }
+  }
+
+  // Return the number of records in the arena.
+  HYDE_RT_ALWAYS_INLINE size_t Size(void) const noexcept {
+    return num_records;
+  }
+
+  // Return the `i`th record in the arena.
+  HYDE_RT_ALWAYS_INLINE RecordType &operator[](size_t i) const noexcept {
+    assert(i < num_records);
+    return *std::launder(reinterpret_cast<RecordType *>(&(SlotAt(i))));
+  }
+
+  // Add a new record to the end of the arena, returning a reference to it.
+  template <typename... Args>
+  HYDE_RT_ALWAYS_INLINE RecordType &EmplaceBack(Args &&...args) {
+    const auto i = num_records;
+    const auto [chunk, offset] = Locate(i);
+    if (!offset) {
+      assert(chunk == chunks.size());
+      chunks.emplace_back(new Slot[kFirstChunkSize << chunk]);
+    }
+    auto &slot = chunks[chunk][offset];
+    auto record = new (&slot) RecordType(std::forward<Args>(args)...);
+    ++num_records;
+    return *record;
+  }
+
+  // Return an untagged link to `record`, which is the `ordinal`th record in
+  // the arena.
+  HYDE_RT_ALWAYS_INLINE static StdRecordLink LinkTo(RecordType *record,
+                                                    size_t ordinal) noexcept {
+#ifdef HYDE_RT_COMPACT_RECORD_LINKS
+    (void) record;
+    assert((ordinal + 1u) < (static_cast<size_t>(1u) << 31u));
+    return static_cast<StdRecordLink>((ordinal + 1u) << 1u);
+#else
+    (void) ordinal;
+    assert(!(reinterpret_cast<uintptr_t>(record) & 1u));
+    return reinterpret_cast<uintptr_t>(record);
+#endif
+  }
+
+  // Return the record referenced by `link`, ignoring its tag bit, or `nullptr`
+  // if `link` is a null link.
+  HYDE_RT_ALWAYS_INLINE RecordType *Resolve(StdRecordLink link) const noexcept {
+#ifdef HYDE_RT_COMPACT_RECORD_LINKS
+    const auto ordinal_plus_one = static_cast<size_t>(link >> 1u);
+    if (!ordinal_plus_one) {
+      return nullptr;
+    } else {
+      return &((*this)[ordinal_plus_one - 1u]);
+    }
+#else
+    return reinterpret_cast<RecordType *>((link >> 1u) << 1u);
+#endif
+  }
+
+ private:
+  struct alignas(RecordType) Slot {
+    uint8_t data[sizeof(RecordType)];
+  };
+
+  // Return the chunk holding the `i`th record, and the offset of that record
+  // in the chunk.
+  HYDE_RT_ALWAYS_INLINE static std::pair<size_t, size_t> Locate(
+      size_t i) noexcept {
+    const auto biased_i = static_cast<unsigned long long>(i + kFirstChunkSize);
+    const auto msb = 63u - static_cast<unsigned>(__builtin_clzll(biased_i));
+    return {msb - kFirstChunkShift, biased_i - (1ull << msb)};
+  }
+
+  HYDE_RT_ALWAYS_INLINE Slot &SlotAt(size_t i) const noexcept {
+    const auto [chunk, offset] = Locate(i);
+    return chunks[chunk][offset];
+  }
+
+  std::vector<std::unique_ptr<Slot[]>> chunks;
+  size_t num_records{0u};
+};
+
 // A helper to construct typed data structures given only integer
 // identifiers for entities.
 template <typename T>
@@ -41,13 +170,20 @@ struct StdTableHelper<TypeList<TableDescriptor<kTableId>,
   using TupleType = std::tuple<
       typename ColumnDescriptor<kColumnIds>::Type...>;
 
-  using BackPointerArrayType = std::array<void *, kNumIndexes>;
+  using BackPointerArrayType = std::array<StdRecordLink, kNumIndexes>;
+
+  // A complete record is a base record, with `kNumIndexes` back links. The
+  // links chain the record back to other records with identical hashes for
+  // their corresponding indexes, and the last record for a given hash in the
+  // first index chains to the most recently added record with a different
+  // hash, which connects together all records of the table. Records of tables
+  // that count the derivations of their tuples end with that count.
+  static constexpr bool kIsCounted = TableDescriptor<kTableId>::kIsCounted;
 
-  // A complete record is a base record, with `kNumIndexes + 1u` back pointers.
-  // The first back pointer chains this record to the most recently added record
-  // in this table. The `kNumIndexes` pointers chain the record back to other
-  // records with identical hashes for their corresponding indexes.
-  using RecordType = std::tuple<TupleState, TupleType, BackPointerArrayType>;
+  using RecordType = std::conditional_t<
+      kIsCounted,
+      std::tuple<TupleState, TupleType, BackPointerArrayType, uint32_t>,
+      std::tuple<TupleState, TupleType, BackPointerArrayType>>;
 
   using IndexIdList = IdList<kIndexIds...>;
 };
@@ -99,27 +235,15 @@ class StdTableBase {
   // Hash a complete tuple.
   HYDE_RT_ALWAYS_INLINE static uint64_t HashTuple(
       const TupleType &tuple) noexcept {
-    HashingWriter writer;
-    Serializer<NullReader, HashingWriter, TupleType>::Write(writer, tuple);
-    return writer.Digest();
+    return std::apply([] (const auto &...cols) { return HashKey(cols...); },
+                      tuple);
   }
 
-  // Hash an empty list of columns.
-  HYDE_RT_ALWAYS_INLINE static void HashColumnsByOffets(
-      const TupleType &, HashingWriter &, IdList<>) {}
-
   // Hash a specific list of columns known to be inside of a tuple.
-  template <unsigned kColumnOffset, unsigned... kColumnOffsets>
-  HYDE_RT_ALWAYS_INLINE static void HashColumnsByOffets(
-      const TupleType &tuple, HashingWriter &writer,
-      IdList<kColumnOffset, kColumnOffsets...>) {
-
-    const auto &col = std::get<kColumnOffset>(tuple);
-    using ColType = std::remove_const_t<std::remove_reference_t<decltype(col)>>;
-    Serializer<NullReader, HashingWriter, ColType>::Write(writer, col);
-    if constexpr (0u < sizeof...(kColumnOffsets)) {
-      HashColumnsByOffets(tuple, writer, IdList<kColumnOffsets...>{});
-    }
+  template <unsigned... kColumnOffsets>
+  HYDE_RT_ALWAYS_INLINE static uint64_t HashColumnsByOffets(
+      const TupleType &tuple, IdList<kColumnOffsets...>) noexcept {
+    return HashKey(std::get<kColumnOffsets>(tuple)...);
   }
 };
 
@@ -136,9 +260,6 @@ class StdTable
     : public StdTableBase<
           typename StdTableHelper<TableDescriptor<kTableId>>::TupleType> {
  public:
-  // Size of the inline cache of recently accessed tuples.
-  static constexpr auto kCacheSize = 1024u;
-
   // Number of bloom filters.
   static constexpr auto kNumBloomFilters = 2u;
 
@@ -148,17 +269,20 @@ class StdTable
   using BackPointerArrayType = typename TableHelper::BackPointerArrayType;
   using RecordType = typename TableHelper::RecordType;
   using IndexIdList = typename TableHelper::IndexIdList;
+  using ArenaType = StdRecordArena<RecordType>;
 
   using Parent = StdTableBase<TupleType>;
 
   static constexpr unsigned kNumColumns = TableHelper::kNumColumns;
   static constexpr unsigned kNumIndexes = TableHelper::kNumIndexes;
+  static constexpr bool kIsCounted = TableHelper::kIsCounted;
 
   static_assert(0u < kNumIndexes);
 
   static constexpr size_t kStateIndex = 0u;
   static constexpr size_t kTupleIndex = 1u;
   static constexpr size_t kBackLinksIndex = 2u;
+  static constexpr size_t kCountIndex = 3u;
 
   using Parent::Parent;
 
@@ -180,8 +304,7 @@ class StdTable
     const TupleType tuple(std::move(cols)...);
     const auto hash = this->HashTuple(tuple);
     if (const auto record = FindRecord(tuple, hash); record) {
-      return ChangeState(&std::get<kStateIndex>(*record), TupleState::kPresent,
-                         TupleState::kUnknown);
+      return CountStateChange(RemoveDerivation(record, TupleState::kUnknown));
     } else {
       return false;
     }
@@ -193,8 +316,7 @@ class StdTable
     const TupleType tuple(std::move(cols)...);
     const auto hash = this->HashTuple(tuple);
     if (const auto record = FindRecord(tuple, hash); record) {
-      return ChangeState(&std::get<kStateIndex>(*record), TupleState::kPresent,
-                         TupleState::kAbsent);
+      return CountStateChange(RemoveDerivation(record, TupleState::kAbsent));
     } else {
       return false;
     }
@@ -207,8 +329,9 @@ class StdTable
     const TupleType tuple(std::move(cols)...);
     const auto hash = this->HashTuple(tuple);
     if (const auto record = FindRecord(tuple, hash); record) {
-      return ChangeState(&std::get<kStateIndex>(*record), TupleState::kUnknown,
-                         TupleState::kAbsent);
+      return CountStateChange(ChangeState(&std::get<kStateIndex>(*record),
+                                          TupleState::kUnknown,
+                                          TupleState::kAbsent));
     } else {
       return false;
     }
@@ -220,13 +343,11 @@ class StdTable
     TupleType tuple(std::move(cols)...);
     const auto hash = this->HashTuple(tuple);
     if (const auto record = FindRecord(tuple, hash); record) {
-      return TryChangeTupleToPresent(&std::get<kStateIndex>(*record),
-                                     TupleState::kAbsent, TupleState::kAbsent);
+      return CountInsert(
+          AddDerivation(record, TupleState::kAbsent, TupleState::kAbsent));
     } else {
-      auto &record_ref = records.emplace_back(
-          TupleState::kPresent, std::move(tuple), BackPointerArrayType{});
-      LinkNewRecord(&record_ref, hash);
-      return true;
+      AddRecord(TupleState::kPresent, std::move(tuple), hash);
+      return CountInsert(true);
     }
   }
 
@@ -236,58 +357,237 @@ class StdTable
     TupleType tuple(std::move(cols)...);
     const auto hash = this->HashTuple(tuple);
     if (const auto record = FindRecord(tuple, hash); record) {
-      return TryChangeTupleToPresent(&std::get<kStateIndex>(*record),
-                                     TupleState::kAbsent, TupleState::kUnknown);
+      return CountInsert(
+          AddDerivation(record, TupleState::kAbsent, TupleState::kUnknown));
+    } else {
+      AddRecord(TupleState::kPresent, std::move(tuple), hash);
+      return CountInsert(true);
+    }
+  }
+
+  // Find the record associated with a tuple, returning `nullptr` if the tuple
+  // has never been added to this table.
+  template <typename... Ts>
+  HYDE_RT_NEVER_INLINE
+  RecordType *GetRecord(Ts... cols) const noexcept {
+    const TupleType tuple(std::move(cols)...);
+    return FindRecord(tuple, this->HashTuple(tuple));
+  }
+
+  // Find the record associated with a tuple, or add a new record in the
+  // absent state if the tuple has never been added to this table. This is
+  // used by record changes that transition tuples into the present state.
+  template <typename... Ts>
+  HYDE_RT_NEVER_INLINE
+  RecordType *GetOrAddRecord(Ts... cols) noexcept {
+    TupleType tuple(std::move(cols)...);
+    const auto hash = this->HashTuple(tuple);
+    if (const auto record = FindRecord(tuple, hash); record) {
+      return record;
     } else {
-      auto &record_ref = records.emplace_back(
-          TupleState::kPresent, std::move(tuple), BackPointerArrayType{});
-      LinkNewRecord(&record_ref, hash);
-      return true;
+      return AddRecord(TupleState::kAbsent, std::move(tuple), hash);
     }
   }
 
+  // The following methods operate directly on records produced by table or
+  // index scans over this table, or by `GetRecord` and `GetOrAddRecord`, so
+  // that state checks and state changes that follow a scan or a prior record
+  // lookup don't need to re-hash the tuple to find its record.
+
+  HYDE_RT_ALWAYS_INLINE
+  static TupleState GetRecordState(const RecordType *record) noexcept {
+    return std::get<kStateIndex>(*record);
+  }
+
+  HYDE_RT_ALWAYS_INLINE
+  bool TryChangeRecordFromPresentToUnknown(RecordType *record) noexcept {
+    return CountStateChange(RemoveDerivation(record, TupleState::kUnknown));
+  }
+
+  HYDE_RT_ALWAYS_INLINE
+  bool TryChangeRecordFromPresentToAbsent(RecordType *record) noexcept {
+    return CountStateChange(RemoveDerivation(record, TupleState::kAbsent));
+  }
+
+  HYDE_RT_ALWAYS_INLINE
+  bool TryChangeRecordFromUnknownToAbsent(RecordType *record) noexcept {
+    return CountStateChange(ChangeState(&std::get<kStateIndex>(*record),
+                                        TupleState::kUnknown,
+                                        TupleState::kAbsent));
+  }
+
+  HYDE_RT_ALWAYS_INLINE
+  bool TryChangeRecordFromAbsentToPresent(RecordType *record) noexcept {
+    return CountInsert(
+        AddDerivation(record, TupleState::kAbsent, TupleState::kAbsent));
+  }
+
+  HYDE_RT_ALWAYS_INLINE
+  bool TryChangeRecordFromAbsentOrUnknownToPresent(
+      RecordType *record) noexcept {
+    return CountInsert(
+        AddDerivation(record, TupleState::kAbsent, TupleState::kUnknown));
+  }
+
   // Return the number of records in the table.
   uint64_t Size(void) const noexcept {
     return num_records;
   }
 
+  // Return the usage counters of this table.
+  TableStats Stats(void) const noexcept {
+    TableStats ret = stats;
+    ret.num_records = num_records;
+    return ret;
+  }
+
  private:
 
-  template <unsigned>
+  template <unsigned, typename>
   friend class StdTableScan;
 
-  template <unsigned>
+  template <unsigned, typename>
   friend class StdIndexScan;
 
+  template <unsigned, unsigned, RangeKind, typename>
+  friend class StdRangeScan;
+
+  using OrderedRecords = std::vector<RecordType *>;
+
+  // Update our counters for a state change that may have happened. These
+  // return `changed` so that they can wrap the state change itself.
+  HYDE_RT_ALWAYS_INLINE bool CountStateChange(bool changed) const noexcept {
+    stats.num_state_changes += changed;
+    return changed;
+  }
+
+  HYDE_RT_ALWAYS_INLINE bool CountInsert(bool changed) const noexcept {
+    stats.num_state_changes += changed;
+    stats.num_inserts += changed;
+    return changed;
+  }
+
+  // Add a new record for `tuple`. New present records start with a single
+  // derivation.
+  HYDE_RT_ALWAYS_INLINE RecordType *AddRecord(TupleState state,
+                                              TupleType tuple,
+                                              uint64_t hash) noexcept {
+    RecordType *record = nullptr;
+    if constexpr (kIsCounted) {
+      record = &records.EmplaceBack(
+          state, std::move(tuple), BackPointerArrayType{},
+          state == TupleState::kPresent ? 1u : 0u);
+    } else {
+      record = &records.EmplaceBack(
+          state, std::move(tuple), BackPointerArrayType{});
+    }
+    LinkNewRecord(record, hash);
+    return record;
+  }
+
+  // Try to transition a record into the present state, returning `true` if
+  // it changed state. In counted tables, this adds one derivation to an
+  // already present tuple.
+  HYDE_RT_ALWAYS_INLINE static bool AddDerivation(
+      RecordType *record, TupleState a_state, TupleState b_state) noexcept {
+    TupleState *const state = &std::get<kStateIndex>(*record);
+    if constexpr (kIsCounted) {
+      uint32_t &count = std::get<kCountIndex>(*record);
+      if (*state == TupleState::kPresent) {
+        ++count;
+        return false;
+      } else if (TryChangeTupleToPresent(state, a_state, b_state)) {
+        count = 1u;
+        return true;
+      } else {
+        return false;
+      }
+    } else {
+      return TryChangeTupleToPresent(state, a_state, b_state);
+    }
+  }
+
+  // Try to transition a present record into `to_state`, returning `true` if
+  // it changed state. In counted tables, this removes one derivation, and the
+  // tuple only changes state once none are left.
+  HYDE_RT_ALWAYS_INLINE static bool RemoveDerivation(
+      RecordType *record, TupleState to_state) noexcept {
+    TupleState *const state = &std::get<kStateIndex>(*record);
+    if constexpr (kIsCounted) {
+      uint32_t &count = std::get<kCountIndex>(*record);
+      if (*state != TupleState::kPresent || --count) {
+        return false;
+      }
+    }
+    return ChangeState(state, TupleState::kPresent, to_state);
+  }
+
+  // Return a view of all records in this table, ordered by the values in their
+  // `kColumnOffset`th column. The view is built on first use, and then only
+  // the records added since the last request are sorted and merged in.
+  //
+  // NOTE(pag): Range scans can be live while the table grows, e.g. when the
+  //            body of a scan inserts into the same table and then performs
+  //            another range scan over it. To keep those scans valid, we
+  //            copy the view before updating it if it is still shared.
+  template <unsigned kColumnOffset>
+  HYDE_RT_NEVER_INLINE
+  std::shared_ptr<const OrderedRecords> GetOrderedRecords(void) noexcept {
+    using ColumnType = std::tuple_element_t<kColumnOffset, TupleType>;
+    static_assert(!std::is_floating_point_v<ColumnType>,
+                  "NaNs make floating-point columns unsortable with `<`");
+
+    auto &ordered = ordered_records[kColumnOffset];
+    if (!ordered) {
+      ordered = std::make_shared<OrderedRecords>();
+    }
+
+    const auto num_ordered = ordered->size();
+    const auto num_records_now = records.Size();
+    if (num_ordered == num_records_now) {
+      ++stats.num_view_cache_hits;
+
+    } else {
+      ++stats.num_view_cache_misses;
+      if (1 < ordered.use_count()) {
+        ordered = std::make_shared<OrderedRecords>(*ordered);
+      }
+
+      OrderedRecords &vec = *ordered;
+      vec.reserve(num_records_now);
+      for (auto i = num_ordered; i < num_records_now; ++i) {
+        vec.push_back(&(records[i]));
+      }
+
+      const auto order = [] (const RecordType *a, const RecordType *b) {
+        return std::get<kColumnOffset>(std::get<kTupleIndex>(*a)) <
+               std::get<kColumnOffset>(std::get<kTupleIndex>(*b));
+      };
+
+      const auto mid = vec.begin() + static_cast<ptrdiff_t>(num_ordered);
+      std::sort(mid, vec.end(), order);
+      std::inplace_merge(vec.begin(), mid, vec.end(), order);
+    }
+
+    return ordered;
+  }
+
   // Find the base record associated with a tuple.
   HYDE_RT_ALWAYS_INLINE RecordType *FindRecord(
       const TupleType &tuple, uint64_t hash) const noexcept {
 
     // Check for the record in our bloom filter.
+    ++stats.num_lookups;
     uint64_t filter_index = hash;
     for (const auto &filter : bloom_filter) {
       if (!filter.test(static_cast<uint16_t>(filter_index))) {
+        ++stats.num_bloom_filter_hits;
         return nullptr;
       } else {
         filter_index >>= 16u;
       }
     }
 
-    // We have a single element cache that scans update.
-    if (RecordType *scan_record =
-            last_scanned_record.load(std::memory_order_acquire)) {
-      if (std::get<kTupleIndex>(*scan_record) == tuple) {
-        return scan_record;
-      }
-    }
-
-    // We have a `kCacheSize`-sized cache that `FindRecord` populates, as we
-    // expect finding a record to be associated with later state changes.
-    if (RecordType *cached_record = last_accessed_record[hash % kCacheSize];
-        cached_record && std::get<kTupleIndex>(*cached_record) == tuple) {
-      return cached_record;
-    }
-
     // The first index covers all columns, so we can use `hash`.
     if constexpr (TableDesc::kHasCoveringIndex) {
       return FindRecordInFirstIndex(tuple, hash);
@@ -309,12 +609,7 @@ class StdTable
   template <typename KeyColumnOffsets>
   HYDE_RT_ALWAYS_INLINE RecordType *FindRecordInIndex(
       const TupleType &tuple) const noexcept {
-    uint64_t hash = 0;
-    {
-      HashingWriter writer;
-      this->HashColumnsByOffets(tuple, writer, KeyColumnOffsets{});
-      hash = writer.Digest();
-    }
+    const uint64_t hash = this->HashColumnsByOffets(tuple, KeyColumnOffsets{});
     return FindRecordInFirstIndex(tuple, hash);
   }
 
@@ -335,33 +630,23 @@ class StdTable
     //            updates, if any.
 
     // We've got a tuple for this hash, go traverse the linked list.
-    for (RecordType *record = it->second; record; ) {
+    for (RecordType *record = records.Resolve(it->second); record; ) {
 
       // The tuple matches what we're looking for.
       if (std::get<kTupleIndex>(*record) == tuple) {
-
-        // We'll update the most recently touched record here on the assumption
-        // that a subsequent operation near in time will try to change the
-        // state of this tuple.
-        assert(!(reinterpret_cast<uintptr_t>(record) & 1u));
-        last_accessed_record[hash % kCacheSize] = record;
-
-        // We found the record we're looking for, return it.
         return record;
       }
 
       // Go to the next record with the same hash.
       const auto &back_links = std::get<kBackLinksIndex>(*record);
-      const auto record_addr = reinterpret_cast<uintptr_t>(
-          back_links[0]);
+      const StdRecordLink link = back_links[0];
 
       // The next record has a different hash, or it is null.
-      const auto shifted_record_addr = record_addr >> 1u;
-      if (!shifted_record_addr) {
+      if (link & 1u) {
         return nullptr;
 
       } else {
-        record = reinterpret_cast<RecordType *>(shifted_record_addr << 1u);
+        record = records.Resolve(link);
       }
     }
     return nullptr;
@@ -370,14 +655,11 @@ class StdTable
   HYDE_RT_NEVER_INLINE HYDE_RT_FLATTEN
   void LinkNewRecord(RecordType *record, uint64_t hash) {
 
-    // Increment the total number of records in our table.
+    // Increment the total number of records in our table. The new record is
+    // always the last one in the arena.
+    const StdRecordLink record_link = ArenaType::LinkTo(record, num_records);
     ++num_records;
 
-    // Make sure all record addresses are evenly aligned; we rely on this
-    // for figuring out when we've gotten to the end of a linked list in a full
-    // table for a given hash.
-    assert(!(reinterpret_cast<uintptr_t>(record) & 1u));
-
     // Add the record to our bloom filter.
     uint64_t filter_index = hash;
     for (auto &filter : bloom_filter) {
@@ -385,27 +667,21 @@ class StdTable
       filter_index >>= 16u;
     }
 
-    // Add it to our cache.
-    last_accessed_record[hash % kCacheSize] = record;
-
-    AddToIndexes(record, IndexIdList{});
+    AddToIndexes(record, record_link, IndexIdList{});
   }
 
-  HYDE_RT_INLINE static void AddToIndexes(RecordType *, IdList<>) {}
+  HYDE_RT_INLINE static void AddToIndexes(RecordType *, StdRecordLink,
+                                          IdList<>) {}
 
   template <unsigned kIndexId, unsigned... kIndexIds>
   HYDE_RT_ALWAYS_INLINE
-  void AddToIndexes(RecordType *record, IdList<kIndexId, kIndexIds...>) {
+  void AddToIndexes(RecordType *record, StdRecordLink record_link,
+                    IdList<kIndexId, kIndexIds...>) {
     using IndexDesc = IndexDescriptor<kIndexId>;
     using KeyColumnOffsets = typename IndexDesc::KeyColumnOffsets;
 
-    uint64_t hash = 0;
-    {
-      HashingWriter writer;
-      const TupleType &tuple = std::get<kTupleIndex>(*record);
-      this->HashColumnsByOffets(tuple, writer, KeyColumnOffsets{});
-      hash = writer.Digest();
-    }
+    const TupleType &tuple = std::get<kTupleIndex>(*record);
+    const uint64_t hash = this->HashColumnsByOffets(tuple, KeyColumnOffsets{});
 
     static constexpr unsigned kIndexOffset = IndexDesc::kOffset;
     auto &prev_record = indexes[kIndexOffset][hash];
@@ -418,10 +694,10 @@ class StdTable
     // node for the whole table.
     if (prev_record) {
       auto &prev_index_link = std::get<kIndexOffset>(
-          std::get<kBackLinksIndex>(*prev_record));
+          std::get<kBackLinksIndex>(*records.Resolve(prev_record)));
 
       index_link = prev_index_link;
-      prev_index_link = record;
+      prev_index_link = record_link;
 
     // We don't have a previous record associated with this hash, so we'll add
     // it in as the first record for the hash, and then we'll link this record
@@ -430,51 +706,56 @@ class StdTable
     // We make sure that the last record has its low bit marked as `1`, to tell
     // us that its hash doesn't match with `last_record`.
     } else {
-      index_link = reinterpret_cast<void *>(
-          reinterpret_cast<uintptr_t>(last_record) | 1u);
-      prev_record = record;
+      index_link = last_record | 1u;
+      prev_record = record_link;
 
       if constexpr (std::is_same_v<IdList<kIndexId, kIndexIds...>,
                     IndexIdList>) {
-        last_record = record;
+        last_record = record_link;
       }
     }
 
     // Recursively add to the next level of indices.
     if constexpr (0u < sizeof...(kIndexIds)) {
-      AddToIndexes(record, IdList<kIndexIds...>{});
+      AddToIndexes(record, record_link, IdList<kIndexIds...>{});
     }
   }
 
   // Backing storage for all records.
-  std::deque<RecordType> records;
+  ArenaType records;
 
   // The bloom filter that tells us if a record is definitely not in our
   // table.
   std::array<std::bitset<65536>, kNumBloomFilters> bloom_filter;
 
   // List of hash-mapped linked lists
-  std::array<std::unordered_map<uint64_t, RecordType *>, kNumIndexes> indexes;
+  std::array<std::unordered_map<uint64_t, StdRecordLink>, kNumIndexes> indexes;
 
   // Last record added whose hash didn't collide with another pre-existing
   // record. This is basically the head of the linked list of all records. In
   // the case of a record whose hash is already used, we link that record in
   // after the pre-existing record.
-  void * last_record{nullptr};
+  StdRecordLink last_record{0u};
 
-  // The most recent record produced from an index or table scan.
-  //
-  // TODO(pag): Eventually make this be an array, with one per worker.
-  std::atomic<RecordType *> last_scanned_record{};
+  uint64_t num_records{0};
 
-  // Cache of recently accessed records.
-  mutable std::array<RecordType *, kCacheSize> last_accessed_record = {};
+  // Usage counters. These are updated by `const` lookups, hence `mutable`.
+  mutable TableStats stats;
 
-  uint64_t num_records{0};
+  // Lazily maintained views of the records, ordered by the values of one of
+  // their columns. These are only built for columns used by range scans.
+  std::array<std::shared_ptr<OrderedRecords>, kNumColumns> ordered_records;
 };
 
+// Tables whose tuples all come from a tiny domain are backed by dense arrays
+// instead of hash tables. The code generator decides which tables are dense.
+template <unsigned kTableId>
+using StdTableFor = std::conditional_t<TableDescriptor<kTableId>::kIsDense,
+                                       StdDenseTable<kTableId>,
+                                       StdTable<kTableId>>;
+
 template <unsigned kTableId>
-class Table<StdStorage, kTableId> : public StdTable<kTableId> {
+class Table<StdStorage, kTableId> : public StdTableFor<kTableId> {
  public:
   Table(StdStorage &) {}
 };
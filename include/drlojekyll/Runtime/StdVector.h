@@ -4,8 +4,9 @@
 
 #include <algorithm>
 #include <cstddef>
-#include <tuple>
 #include <deque>
+#include <iterator>
+#include <tuple>
 
 #include "Runtime.h"
 
@@ -110,6 +111,19 @@ class StdVector {
     entries.clear();
   }
 
+  // Move all entries of `that` onto the end of this vector, leaving `that`
+  // empty. Both vectors must be backed by the same storage.
+  HYDE_RT_ALWAYS_INLINE void Extend(Self &that) noexcept {
+    if (entries.empty()) {
+      entries.swap(that.entries);
+    } else {
+      entries.insert(entries.end(),
+                     std::make_move_iterator(that.entries.begin()),
+                     std::make_move_iterator(that.entries.end()));
+      that.entries.clear();
+    }
+  }
+
   HYDE_RT_ALWAYS_INLINE
   auto begin(void) const noexcept -> decltype(this->entries.begin()) {
     return entries.begin();
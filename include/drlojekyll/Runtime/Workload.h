@@ -0,0 +1,239 @@
+// Copyright 2021, Trail of Bits, Inc. All rights reserved.
+
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace hyde {
+namespace rt {
+
+// Parses a column value out of a field of a synthetic workload, as produced by
+// `drlojekyll-workload`. Workloads spell every value as a decimal number, so
+// arithmetic and enumeration types are handled here; specialize this for any
+// other referentially transparent foreign type that can be built from one.
+template <typename T, typename Enable = void>
+struct WorkloadValue;
+
+template <>
+struct WorkloadValue<bool> {
+  static bool Parse(std::string_view field, bool &val) {
+    if (field == "0") {
+      val = false;
+      return true;
+    } else if (field == "1") {
+      val = true;
+      return true;
+    } else {
+      return false;
+    }
+  }
+};
+
+template <typename T>
+struct WorkloadValue<
+    T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>> {
+  static bool Parse(std::string_view field, T &val) {
+    const auto end = field.data() + field.size();
+    const auto [ptr, ec] = std::from_chars(field.data(), end, val);
+    return ec == std::errc() && ptr == end;
+  }
+};
+
+template <typename T>
+struct WorkloadValue<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+  static bool Parse(std::string_view field, T &val) {
+    const std::string str(field);
+    char *end = nullptr;
+    val = static_cast<T>(std::strtod(str.c_str(), &end));
+    return end == str.c_str() + str.size();
+  }
+};
+
+template <typename T>
+struct WorkloadValue<T, std::enable_if_t<std::is_enum_v<T>>> {
+  static bool Parse(std::string_view field, T &val) {
+    std::underlying_type_t<T> underlying_val = {};
+    if (!WorkloadValue<std::underlying_type_t<T>>::Parse(field,
+                                                         underlying_val)) {
+      return false;
+    }
+    val = static_cast<T>(underlying_val);
+    return true;
+  }
+};
+
+// Can values of type `T` be parsed out of a workload?
+template <typename T, typename Enable = void>
+struct IsWorkloadValue : std::false_type {};
+
+template <typename T>
+struct IsWorkloadValue<
+    T, std::void_t<decltype(WorkloadValue<T>::Parse(
+           std::declval<std::string_view>(), std::declval<T &>()))>>
+    : std::true_type {};
+
+template <typename TupleT>
+struct IsWorkloadTuple;
+
+template <typename... Ts>
+struct IsWorkloadTuple<std::tuple<Ts...>>
+    : std::conjunction<IsWorkloadValue<Ts>...> {};
+
+// Counts of what was replayed from a workload.
+struct WorkloadSummary {
+  uint64_t num_batches{0};
+  uint64_t num_additions{0};
+  uint64_t num_removals{0};
+
+  // Lines that named an unknown message, that had malformed values, or that
+  // removed a tuple from a message that isn't `@differential`.
+  uint64_t num_rejected{0};
+};
+
+// Replays a synthetic workload, as produced by `drlojekyll-workload`, into
+// the input messages of a generated database. A workload is line-oriented,
+// with tab-separated fields:
+//
+//    + <message>_<arity> <value>...    Add a tuple to a message.
+//    - <message>_<arity> <value>...    Remove a tuple from a message.
+//    .                                 End the current batch.
+//
+// Blank lines, and lines starting with `#`, are ignored. A workload is
+// replayed one batch at a time, so that the time spent reading it can be
+// kept separate from the time spent applying it:
+//
+//    DatabaseInputMessage<StorageT> message(storage);
+//    WorkloadReplayer<DatabaseInputMessage<StorageT>> replayer(message);
+//    VisitDatabaseMessages(replayer);
+//    while (replayer.ReadBatch(is)) {
+//      message.Apply(db);
+//    }
+template <typename InputMessageT>
+class WorkloadReplayer {
+ public:
+  explicit WorkloadReplayer(InputMessageT &message_)
+      : message(message_) {}
+
+  // Makes a message of the workload replayable. Called for each of the
+  // database's received messages by the generated `VisitDatabaseMessages`.
+  // Tuples of messages with columns whose values can't be parsed, e.g.
+  // `bytes`, are rejected.
+  template <typename MessageT>
+  void Visit(void) {
+    if constexpr (IsWorkloadTuple<typename MessageT::TupleType>::value) {
+      appenders.emplace_back(
+          std::string_view(MessageT::kName, MessageT::kNameLength),
+          &Append<MessageT>);
+    }
+  }
+
+  // Reads the next batch of the workload in `is` into the input message.
+  // Returns `false` if there were no more batches.
+  bool ReadBatch(std::istream &is) {
+    auto read_any = false;
+    while (std::getline(is, line)) {
+      read_any = true;
+      std::string_view fields(line);
+      if (fields.empty() || fields.front() == '#') {
+        continue;
+      } else if (fields == ".") {
+        break;
+      } else if (!ReadTuple(fields)) {
+        ++summary.num_rejected;
+      }
+    }
+
+    if (read_any) {
+      ++summary.num_batches;
+    }
+    return read_any;
+  }
+
+  const WorkloadSummary &Summary(void) const noexcept {
+    return summary;
+  }
+
+ private:
+  using AppenderType = bool (*)(InputMessageT &, std::string_view, bool);
+
+  WorkloadReplayer(const WorkloadReplayer &) = delete;
+  WorkloadReplayer &operator=(const WorkloadReplayer &) = delete;
+
+  // Splits the next field off of the front of `fields`.
+  static std::string_view NextField(std::string_view &fields) {
+    const auto tab = fields.find('\t');
+    const auto field = fields.substr(0u, tab);
+    if (tab == std::string_view::npos) {
+      fields = {};
+    } else {
+      fields.remove_prefix(tab + 1u);
+    }
+    return field;
+  }
+
+  template <typename TupleT, size_t... kIndices>
+  static bool ParseTuple(std::string_view fields, TupleT &tuple,
+                         std::index_sequence<kIndices...>) {
+    auto parse_field = [&fields](auto &val) {
+      const auto field = NextField(fields);
+      using ValueT = std::remove_reference_t<decltype(val)>;
+      return !field.empty() && WorkloadValue<ValueT>::Parse(field, val);
+    };
+    return (parse_field(std::get<kIndices>(tuple)) && ...) && fields.empty();
+  }
+
+  template <typename MessageT>
+  static bool Append(InputMessageT &message, std::string_view fields,
+                     bool added) {
+    typename MessageT::TupleType tuple;
+    return ParseTuple(
+               fields, tuple,
+               std::make_index_sequence<
+                   std::tuple_size_v<typename MessageT::TupleType>>()) &&
+           MessageT::AppendTupleToInputMessage(message, std::move(tuple),
+                                               added);
+  }
+
+  bool ReadTuple(std::string_view fields) {
+    const auto op = NextField(fields);
+    const auto added = op == "+";
+    if (!added && op != "-") {
+      return false;
+    }
+
+    // NOTE(pag): Databases have few messages, so a linear scan beats hashing
+    //            the name on every line.
+    const auto name = NextField(fields);
+    for (const auto &[appender_name, appender] : appenders) {
+      if (appender_name != name) {
+        continue;
+      } else if (!appender(message, fields, added)) {
+        return false;
+      } else if (added) {
+        ++summary.num_additions;
+      } else {
+        ++summary.num_removals;
+      }
+      return true;
+    }
+    return false;
+  }
+
+  InputMessageT &message;
+  std::vector<std::pair<std::string_view, AppenderType>> appenders;
+  std::string line;
+  WorkloadSummary summary;
+};
+
+}  // namespace rt
+}  // namespace hyde
@@ -9,6 +9,7 @@
 #include <drlojekyll/Parse/ModuleIterator.h>
 
 #include <algorithm>
+#include <cstring>
 #include <vector>
 
 #include "Util.h"
@@ -29,6 +30,36 @@ static bool AllParametersAreBound(ParsedDeclaration decl) {
   return all_bound;
 }
 
+// Print out the parameter list of a method that sends `message` to the
+// backend. Differential messages take an extra `added` parameter.
+static void DeclareMessageParameters(ParsedModule module,
+                                     ParsedMessage message, OutputStream &os,
+                                     bool with_defaults) {
+  auto sep = "(";
+  for (auto param : ParsedDeclaration(message).Parameters()) {
+    os << sep;
+    if (param.Type().IsReferentiallyTransparent(module, Language::kCxx)) {
+      os << TypeName(module, param.Type()) << " ";
+    } else {
+      os << "const " << TypeName(module, param.Type()) << " &";
+    }
+    os << param.Name();
+    sep = ", ";
+  }
+
+  if (message.IsDifferential()) {
+    os << sep << "bool added";
+    if (with_defaults) {
+      os << "=true";
+    }
+    os << ")";
+  } else if (!strcmp(sep, "(")) {
+    os << "(void)";
+  } else {
+    os << ")";
+  }
+}
+
 // Define the `Build` method of the `DatalogMessageBuilder` class, which
 // goes and packages up all messages into flatbuffer vectors and into
 // added/removed messages. Normally, the offsets to the messages-to-be-published
@@ -188,6 +219,11 @@ static void DefineMessageBuilder(ParsedModule module,
   }
   os << ";\n";
   os.PopIndent();
+  os << os.Indent() << "}\n\n"
+     << os.Indent() << "inline size_t Size(void) const noexcept {\n";
+  os.PushIndent();
+  os << os.Indent() << "return mb.GetSize();\n";
+  os.PopIndent();
   os << os.Indent() << "}\n\n";
 
   DefineBuilderBuilder(messages, os);
@@ -201,26 +237,11 @@ static void DefineMessageBuilder(ParsedModule module,
     ParsedDeclaration decl(message);
     os << "\n\n"
        << os.Indent() << "void " << message.Name() << "_" << message.Arity();
+    DeclareMessageParameters(module, message, os, true);
+    os << " {\n";
+    os.PushIndent();
 
-    auto sep = "(";
-    for (auto param : decl.Parameters()) {
-      os << sep;
-      if (param.Type().IsReferentiallyTransparent(module, Language::kCxx)) {
-        os << TypeName(module, param.Type()) << " ";
-      } else {
-        os << "const " << TypeName(module, param.Type()) << " &";
-      }
-      os << param.Name();
-      sep = ", ";
-    }
-
-    if (message.IsDifferential()) {
-      os << sep << "bool added=true) {\n";
-      os.PushIndent();
-
-    } else {
-      os << ") {\n";
-      os.PushIndent();
+    if (!message.IsDifferential()) {
       os << os.Indent() << "constexpr auto added = true;\n";
     }
 
@@ -264,6 +285,259 @@ static void DefineMessageBuilder(ParsedModule module,
   os << "\n};\n\n";
 }
 
+// Define the `DatalogSubscriptionBuilder` class, which lets a client name the
+// published messages that it wants to receive, and the values that it wants
+// in each filterable column of those messages. A builder with no topics
+// subscribes to every published message.
+static void
+DefineSubscriptionBuilder(ParsedModule module,
+                          const std::vector<ParsedMessage> &messages,
+                          OutputStream &os) {
+
+  os << "class DatalogSubscriptionBuilder final {\n";
+  os.PushIndent();
+  os << os.Indent() << "private:\n";
+  os.PushIndent();
+  os << os.Indent() << "std::vector<std::string> topics;";
+
+  for (ParsedMessage message : messages) {
+    if (!message.IsPublished()) {
+      continue;
+    }
+    for (ParsedParameter param : ParsedDeclaration(message).Parameters()) {
+      if (IsFilterableType(module, param.Type())) {
+        os << "\n"
+           << os.Indent() << "std::vector<" << TypeName(module, param.Type())
+           << "> " << message.Name() << "_" << message.Arity() << "_"
+           << param.Name() << "_values;";
+      }
+    }
+  }
+
+  os.PopIndent();  // private
+  os << "\n\n"
+     << os.Indent() << "public:";
+  os.PushIndent();
+
+  for (ParsedMessage message : messages) {
+    if (!message.IsPublished()) {
+      continue;
+    }
+
+    // Subscribe to a specific published message.
+    os << "\n\n"
+       << os.Indent() << "DatalogSubscriptionBuilder &" << message.Name()
+       << "_" << message.Arity() << "(void) {\n";
+    os.PushIndent();
+    os << os.Indent() << "topics.emplace_back(\"" << message.Name() << "_"
+       << message.Arity() << "\");\n"
+       << os.Indent() << "return *this;\n";
+    os.PopIndent();
+    os << os.Indent() << "}";
+
+    // Only accept messages whose column has one of the given values.
+    for (ParsedParameter param : ParsedDeclaration(message).Parameters()) {
+      if (!IsFilterableType(module, param.Type())) {
+        continue;
+      }
+      os << "\n\n"
+         << os.Indent() << "DatalogSubscriptionBuilder &" << message.Name()
+         << "_" << message.Arity() << "_" << param.Name() << "("
+         << TypeName(module, param.Type()) << " value) {\n";
+      os.PushIndent();
+      os << os.Indent() << message.Name() << "_" << message.Arity() << "_"
+         << param.Name() << "_values.push_back(value);\n"
+         << os.Indent() << "return *this;\n";
+      os.PopIndent();
+      os << os.Indent() << "}";
+    }
+  }
+
+  os << "\n\n"
+     << os.Indent() << "flatbuffers::grpc::Message<Client> Build(const std::string &client_name) const {\n";
+  os.PushIndent();
+  os << os.Indent() << "flatbuffers::grpc::MessageBuilder mb;\n"
+     << os.Indent() << "const auto name_offset = mb.CreateString(client_name);\n"
+     << os.Indent() << "const auto topics_offset = mb.CreateVectorOfStrings(topics);\n";
+
+  for (ParsedMessage message : messages) {
+    if (!message.IsPublished() || !HasFilterableColumns(module, message)) {
+      continue;
+    }
+    os << os.Indent() << "const auto " << message.Name() << "_"
+       << message.Arity() << "_offset = CreateFilter_" << message.Name()
+       << "_" << message.Arity() << "(mb";
+    for (ParsedParameter param : ParsedDeclaration(message).Parameters()) {
+      if (IsFilterableType(module, param.Type())) {
+        os << ", ::hyde::rt::CreateFBVector(mb, " << message.Name() << "_"
+           << message.Arity() << "_" << param.Name() << "_values)";
+      }
+    }
+    os << ");\n";
+  }
+
+  os << os.Indent() << "mb.Finish(CreateClient(mb, name_offset, topics_offset";
+  for (ParsedMessage message : messages) {
+    if (message.IsPublished() && HasFilterableColumns(module, message)) {
+      os << ", " << message.Name() << "_" << message.Arity() << "_offset";
+    }
+  }
+  os << "));\n"
+     << os.Indent() << "return mb.ReleaseMessage<Client>();\n";
+  os.PopIndent();
+  os << os.Indent() << "}";
+
+  os.PopIndent();  // public
+  os.PopIndent();
+  os << "\n};\n\n";
+}
+
+// Declare the `DatalogPublisher` class, which has one method per received
+// message. The publisher coalesces messages into batches, and sends batches
+// to the backend in the background, so that producers don't wait on a round
+// trip per batch. Each method returns a future that resolves once the batch
+// holding the message has been sent.
+static void DeclarePublisher(ParsedModule module,
+                             const std::vector<ParsedMessage> &messages,
+                             OutputStream &os) {
+  os << "class DatalogPublisher final {\n";
+  os.PushIndent();
+  os << os.Indent() << "private:\n";
+  os.PushIndent();
+  os << os.Indent() << "std::mutex lock;\n"
+     << os.Indent() << "DatalogMessageBuilder builder;\n"
+     << os.Indent() << "std::chrono::steady_clock::time_point batch_start;\n"
+     << os.Indent() << "std::promise<bool> batch_done;\n"
+     << os.Indent() << "std::shared_future<bool> batch_future;\n\n"
+     << os.Indent() << "// NOTE: Declared last so that it's destroyed first, i.e. before\n"
+     << os.Indent() << "//       the batch state used by its background threads.\n"
+     << os.Indent() << "::hyde::rt::AsyncPublisher publisher;\n\n"
+     << os.Indent() << "void SendBatch(void);\n\n";
+  os.PopIndent();  // private
+
+  os << os.Indent() << "public:\n";
+  os.PushIndent();
+  os << os.Indent() << "DatalogPublisher(const DatalogPublisher &) = delete;\n"
+     << os.Indent() << "DatalogPublisher &operator=(const DatalogPublisher &) = delete;\n\n"
+     << os.Indent() << "~DatalogPublisher(void);\n"
+     << os.Indent() << "explicit DatalogPublisher(const DatalogClient &client, const ::hyde::rt::AsyncPublisherOptions &options = {});\n\n";
+
+  for (ParsedMessage message : messages) {
+    if (message.IsReceived()) {
+      os << os.Indent() << "std::shared_future<bool> " << message.Name()
+         << "_" << message.Arity();
+      DeclareMessageParameters(module, message, os, true);
+      os << ";\n";
+    }
+  }
+
+  os << "\n"
+     << os.Indent() << "// Send the current batch now, rather than waiting for it to fill up.\n"
+     << os.Indent() << "std::shared_future<bool> Flush(void);\n\n"
+     << os.Indent() << "// Send the current batch, and wait for all batches to be sent.\n"
+     << os.Indent() << "void Drain(void);\n";
+  os.PopIndent();  // public
+  os.PopIndent();
+  os << "};\n\n";
+}
+
+// Define the methods of the `DatalogPublisher` class.
+static void DefinePublisher(ParsedModule module,
+                            const std::vector<ParsedMessage> &messages,
+                            OutputStream &os) {
+  os << "DatalogPublisher::~DatalogPublisher(void) {\n";
+  os.PushIndent();
+  os << os.Indent() << "Flush();\n";
+  os.PopIndent();
+  os << "}\n\n"
+     << "DatalogPublisher::DatalogPublisher(const DatalogClient &client, const ::hyde::rt::AsyncPublisherOptions &options)\n";
+  os.PushIndent();
+  os << os.Indent() << ": batch_future(batch_done.get_future().share()),\n"
+     << os.Indent() << "  publisher(client.send_channel, client.method_Publish, options, [this] (void) {\n";
+  os.PushIndent();
+  os << os.Indent() << "  std::unique_lock<std::mutex> locker(lock);\n"
+     << os.Indent() << "  if (builder.HasAnyMessages() &&\n"
+     << os.Indent() << "      (std::chrono::steady_clock::now() - batch_start) >= publisher.Options().max_batch_delay) {\n"
+     << os.Indent() << "    SendBatch();\n"
+     << os.Indent() << "  }\n";
+  os.PopIndent();
+  os << os.Indent() << "  }) {}\n\n";
+  os.PopIndent();
+
+  os << "void DatalogPublisher::SendBatch(void) {\n";
+  os.PushIndent();
+  os << os.Indent() << "auto message = builder.Build();\n"
+     << os.Indent() << "std::promise<bool> done;\n"
+     << os.Indent() << "done.swap(batch_done);\n"
+     << os.Indent() << "batch_future = batch_done.get_future().share();\n"
+     << os.Indent() << "publisher.Send(message.BorrowSlice(), std::move(done));\n";
+  os.PopIndent();
+  os << "}\n\n";
+
+  for (ParsedMessage message : messages) {
+    if (!message.IsReceived()) {
+      continue;
+    }
+
+    os << "std::shared_future<bool> DatalogPublisher::" << message.Name()
+       << "_" << message.Arity();
+    DeclareMessageParameters(module, message, os, false);
+    os << " {\n";
+    os.PushIndent();
+    os << os.Indent() << "std::unique_lock<std::mutex> locker(lock);\n"
+       << os.Indent() << "if (!builder.HasAnyMessages()) {\n";
+    os.PushIndent();
+    os << os.Indent() << "batch_start = std::chrono::steady_clock::now();\n";
+    os.PopIndent();
+    os << os.Indent() << "}\n"
+       << os.Indent() << "builder." << message.Name() << "_" << message.Arity();
+    auto sep = "(";
+    for (auto param : ParsedDeclaration(message).Parameters()) {
+      os << sep << param.Name();
+      sep = ", ";
+    }
+    if (message.IsDifferential()) {
+      os << sep << "added";
+      sep = ", ";
+    }
+    if (!strcmp(sep, "(")) {
+      os << "(";
+    }
+    os << ");\n"
+       << os.Indent() << "auto future = batch_future;\n"
+       << os.Indent() << "if (builder.Size() >= publisher.Options().max_batch_bytes) {\n";
+    os.PushIndent();
+    os << os.Indent() << "SendBatch();\n";
+    os.PopIndent();
+    os << os.Indent() << "}\n"
+       << os.Indent() << "return future;\n";
+    os.PopIndent();
+    os << "}\n\n";
+  }
+
+  os << "std::shared_future<bool> DatalogPublisher::Flush(void) {\n";
+  os.PushIndent();
+  os << os.Indent() << "std::unique_lock<std::mutex> locker(lock);\n"
+     << os.Indent() << "if (!builder.HasAnyMessages()) {\n";
+  os.PushIndent();
+  os << os.Indent() << "std::promise<bool> nothing_to_send;\n"
+     << os.Indent() << "nothing_to_send.set_value(true);\n"
+     << os.Indent() << "return nothing_to_send.get_future().share();\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n"
+     << os.Indent() << "auto future = batch_future;\n"
+     << os.Indent() << "SendBatch();\n"
+     << os.Indent() << "return future;\n";
+  os.PopIndent();
+  os << "}\n\n"
+     << "void DatalogPublisher::Drain(void) {\n";
+  os.PushIndent();
+  os << os.Indent() << "Flush();\n"
+     << os.Indent() << "publisher.Drain();\n";
+  os.PopIndent();
+  os << "}\n\n";
+}
+
 //// Define the `DatalogMessageVisitor` class, which has one method per
 //// received message. The role of this message visitor is to call methods for
 //// each received message.
@@ -305,8 +579,8 @@ static void DeclareQuery(ParsedModule module, ParsedQuery query,
     os << "std::shared_ptr<" << decl.Name() << "_" << decl.Arity()
        << "> ";
   } else {
-
-    os << "::hyde::rt::ClientResultStream<"
+    os << "::hyde::rt::ClientChunkedResultStream<Chunk_"
+       << decl.Name() << "_" << decl.Arity() << ", "
        << decl.Name() << "_" << decl.Arity() << "> ";
   }
 
@@ -337,9 +611,12 @@ void GenerateClientHeader(Program program, ParsedModule module,
                           OutputStream &os) {
   os << "/* Auto-generated file */\n\n"
      << "#pragma once\n\n"
+     << "#include <chrono>\n"
      << "#include <cstddef>\n"
      << "#include <functional>\n"
+     << "#include <future>\n"
      << "#include <memory>\n"
+     << "#include <mutex>\n"
      << "#include <string>\n"
      << "#include <vector>\n\n"
      << "#include <flatbuffers/flatbuffers.h>\n"
@@ -368,7 +645,18 @@ void GenerateClientHeader(Program program, ParsedModule module,
   // Declare the message builder, which accumulates messages for publication.
   DefineMessageBuilder(module, messages, os);
 
-  os << "using DatalogClientMessagePtr = std::shared_ptr<DatalogClientMessage>;\n\n";
+  // Declare the subscription builder, which filters published messages.
+  DefineSubscriptionBuilder(module, messages, os);
+
+  os << "using DatalogClientMessagePtr = std::shared_ptr<DatalogClientMessage>;\n\n"
+     << "// Returns `true` if the server dropped published messages that were meant\n"
+     << "// for this subscriber, e.g. because it fell behind and the server's outbox\n"
+     << "// policy is `drop_oldest`. Any state derived from earlier messages may then\n"
+     << "// be stale, and should be re-queried.\n"
+     << "inline static bool IsResyncMessage(const DatalogClientMessagePtr &message) {\n"
+     << "  return message && message->resync();\n"
+     << "}\n\n"
+     << "class DatalogPublisher;\n\n";
 
   // Declare the client interface to the database.
   os << "class DatalogClient final {\n";
@@ -376,7 +664,8 @@ void GenerateClientHeader(Program program, ParsedModule module,
   os << os.Indent() << "private:\n";
   os.PushIndent();
 
-  os << os.Indent() << "std::shared_ptr<grpc::Channel> send_channel;\n"
+  os << os.Indent() << "friend class DatalogPublisher;\n\n"
+     << os.Indent() << "std::shared_ptr<grpc::Channel> send_channel;\n"
      << os.Indent() << "std::shared_ptr<grpc::Channel> recv_channel;\n"
      << os.Indent() << "std::shared_ptr<grpc::Channel> query_channel;\n";
 
@@ -388,7 +677,8 @@ void GenerateClientHeader(Program program, ParsedModule module,
   }
 
   os << os.Indent() << "const grpc::internal::RpcMethod method_Publish;\n"
-     << os.Indent() << "const grpc::internal::RpcMethod method_Subscribe;\n\n";
+     << os.Indent() << "const grpc::internal::RpcMethod method_Subscribe;\n"
+     << os.Indent() << "const grpc::internal::RpcMethod method_Stats;\n\n";
 
   os.PopIndent();  // private
 
@@ -409,12 +699,21 @@ void GenerateClientHeader(Program program, ParsedModule module,
   }
 
   os << os.Indent() << "bool Publish(DatalogMessageBuilder &messages) const;\n"
-     << os.Indent() << "::hyde::rt::ClientResultStream<DatalogClientMessage> Subscribe(const std::string &client_name) const;\n";
+     << os.Indent() << "// Subscribe to published messages. Check each received message with\n"
+     << os.Indent() << "// `IsResyncMessage` to learn if earlier messages were dropped.\n"
+     << os.Indent() << "::hyde::rt::ClientResultStream<DatalogClientMessage> Subscribe(const std::string &client_name) const;\n"
+     << os.Indent() << "::hyde::rt::ClientResultStream<DatalogClientMessage> Subscribe(const std::string &client_name, const DatalogSubscriptionBuilder &subscription) const;\n\n"
+     << os.Indent() << "// Ask the server for the live counters of it and of its database.\n"
+     << os.Indent() << "std::shared_ptr<DatalogStats> Stats(void) const;\n";
 
   os.PopIndent();  // public
   os.PopIndent();  // class
   os << "};\n\n";
 
+  // Declare the asynchronous publisher, which batches messages for the
+  // backend.
+  DeclarePublisher(module, messages, os);
+
   if (!ns_name.empty()) {
     for (auto code : inlines) {
       if (code.Stage() == "c++:client:interface:epilogue:namespace") {
@@ -492,7 +791,10 @@ void GenerateClientImpl(Program program, ParsedModule module,
      << ".Datalog/Publish\", ::grpc::internal::RpcMethod::NORMAL_RPC, send_channel)"
      << ",\n"
      << os.Indent() << "  method_Subscribe(\"/" << file_name
-     << ".Datalog/Subscribe\", ::grpc::internal::RpcMethod::SERVER_STREAMING, recv_channel) {}\n\n";
+     << ".Datalog/Subscribe\", ::grpc::internal::RpcMethod::SERVER_STREAMING, recv_channel)"
+     << ",\n"
+     << os.Indent() << "  method_Stats(\"/" << file_name
+     << ".Datalog/Stats\", ::grpc::internal::RpcMethod::NORMAL_RPC, query_channel) {}\n\n";
 
   os.PopIndent();
 
@@ -533,7 +835,8 @@ void GenerateClientImpl(Program program, ParsedModule module,
          << ", message.BorrowSlice());\n";
 
     } else {
-      os << os.Indent() << "return ::hyde::rt::ClientResultStream<"
+      os << os.Indent() << "return ::hyde::rt::ClientChunkedResultStream<Chunk_"
+         << decl.Name() << "_" << decl.Arity() << ", "
          << decl.Name() << "_" << decl.Arity()
          << ">(query_channel, method_Query_"
          << decl.Name() << "_" << decl.BindingPattern()
@@ -565,6 +868,23 @@ void GenerateClientImpl(Program program, ParsedModule module,
   os.PopIndent();  // Subscribe
   os << "}\n\n";
 
+  os << "::hyde::rt::ClientResultStream<DatalogClientMessage> DatalogClient::Subscribe(const std::string &client_name, const DatalogSubscriptionBuilder &subscription) const {\n";
+  os.PushIndent();
+  os << os.Indent() << "auto message = subscription.Build(client_name);\n"
+     << os.Indent() << "return ::hyde::rt::ClientResultStream<DatalogClientMessage>(recv_channel, method_Subscribe, message.BorrowSlice());\n";
+  os.PopIndent();  // Subscribe
+  os << "}\n\n"
+     << "std::shared_ptr<DatalogStats> DatalogClient::Stats(void) const {\n";
+  os.PushIndent();
+  os << os.Indent() << "flatbuffers::grpc::MessageBuilder mb;\n"
+     << os.Indent() << "mb.Finish(CreateEmpty(mb));\n"
+     << os.Indent() << "auto message = mb.ReleaseMessage<Empty>();\n"
+     << os.Indent() << "return ::hyde::rt::Query<DatalogStats>(query_channel.get(), method_Stats, message.BorrowSlice());\n";
+  os.PopIndent();  // Stats
+  os << "}\n\n";
+
+  DefinePublisher(module, messages, os);
+
   if (!ns_name.empty()) {
     for (auto code : inlines) {
       if (code.Stage() == "c++:client:database:epilogue:namespace") {
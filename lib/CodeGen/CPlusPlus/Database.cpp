@@ -9,6 +9,7 @@
 #include <drlojekyll/Parse/ModuleIterator.h>
 
 #include <algorithm>
+#include <optional>
 #include <sstream>
 #include <unordered_set>
 #include <vector>
@@ -19,6 +20,62 @@ namespace hyde {
 namespace cxx {
 namespace {
 
+// The largest number of bits in the packed tuples of a dense table. Dense
+// tables have an array with an entry for every possible tuple.
+static constexpr unsigned kMaxDenseTableBits = 16u;
+
+// Returns the number of bits needed to represent every value of a column of
+// type `type` in a dense table, or `0` if this type can't be used by a dense
+// table.
+static unsigned DenseColumnBits(ParsedModule module, TypeLoc type) {
+  if (type.UnderlyingKind() == TypeKind::kBoolean) {
+    return 1u;
+  }
+
+  const auto foreign_type = module.ForeignType(type);
+  if (!foreign_type) {
+    return 0u;
+  }
+
+  const auto enum_type = ParsedEnumType::From(*foreign_type);
+  if (!enum_type) {
+    return 0u;
+  }
+
+  switch (enum_type->UnderlyingType().UnderlyingKind()) {
+    case TypeKind::kSigned8:
+    case TypeKind::kUnsigned8: return 8u;
+    case TypeKind::kSigned16:
+    case TypeKind::kUnsigned16: return 16u;
+    default: return 0u;
+  }
+}
+
+// Returns `true` if every column of `table` has a tiny, statically known
+// domain, e.g. enums and booleans, such that every possible tuple of `table`
+// can be given an entry in an array.
+//
+// NOTE(pag): Dense tables only store tuple states, so they can't count the
+//            derivations of their tuples.
+static bool IsDenseTable(ParsedModule module, DataTable table) {
+  if (table.IsCounted()) {
+    return false;
+  }
+
+  auto num_bits = 0u;
+  for (auto col : table.Columns()) {
+    const auto col_bits = DenseColumnBits(module, col.Type());
+    if (!col_bits) {
+      return false;
+    }
+    num_bits += col_bits;
+    if (num_bits > kMaxDenseTableBits) {
+      return false;
+    }
+  }
+  return true;
+}
+
 // Declare Table Descriptors that contain additional metadata about columns,
 // indexes, and tables. The output of this code looks roughly like this:
 //
@@ -205,7 +262,11 @@ static void DeclareDescriptors(OutputStream &os, Program program,
         << os.Indent() << "static constexpr unsigned kFirstIndexId = "
         << indexes[0].Id() << ";\n"
         << os.Indent() << "static constexpr unsigned kNumColumns = "
-        << table.Columns().size() << ";\n";
+        << table.Columns().size() << ";\n"
+        << os.Indent() << "static constexpr bool kIsDense = "
+        << (IsDenseTable(module, table) ? "true" : "false") << ";\n"
+        << os.Indent() << "static constexpr bool kIsCounted = "
+        << (table.IsCounted() ? "true" : "false") << ";\n";
 
     os.PopIndent();
     os << "};\n";
@@ -333,11 +394,311 @@ static void DefineConstant(OutputStream &os, ParsedModule module,
 //  os << os.Indent() << "}\n\n";
 //}
 
+// Name of the iterator over a table scan's records.
+static std::string RecordIterator(ProgramTableScanRegion region, unsigned) {
+  return "it_" + std::to_string(region.Id());
+}
+
+// Name of the iterator over the records of the `table_index`th table of a
+// table join.
+static std::string RecordIterator(ProgramTableJoinRegion region,
+                                  unsigned table_index) {
+  return "it_" + std::to_string(region.Id()) + '_' +
+         std::to_string(table_index);
+}
+
+// Name of the record pointer found by a record check.
+static std::string RecordPointer(ProgramCheckRecordRegion region) {
+  return "rec_" + std::to_string(region.Id());
+}
+
+// Name of the record pointer found by a record change.
+static std::string RecordPointer(ProgramChangeRecordRegion region) {
+  return "rec_" + std::to_string(region.Id());
+}
+
+// Expression that evaluates to a pointer to the record described by
+// `provider`.
+static std::string RecordPointer(const ProgramRecordProvider &provider) {
+  if (provider.region.IsTableScan()) {
+    return RecordIterator(ProgramTableScanRegion::From(provider.region),
+                          provider.table_index) + ".Record()";
+
+  } else if (provider.region.IsTableJoin()) {
+    return RecordIterator(ProgramTableJoinRegion::From(provider.region),
+                          provider.table_index) + ".Record()";
+
+  } else if (provider.region.IsChangeRecord()) {
+    return RecordPointer(ProgramChangeRecordRegion::From(provider.region));
+
+  } else {
+    return RecordPointer(ProgramCheckRecordRegion::From(provider.region));
+  }
+}
+
+// Suffix of the `TryChange*From*To*` table methods for a state.
+static const char *TupleStateSuffix(TupleState state) {
+  switch (state) {
+    case TupleState::kAbsent: return "Absent";
+    case TupleState::kPresent: return "Present";
+    case TupleState::kUnknown: return "Unknown";
+    case TupleState::kAbsentOrUnknown: return "AbsentOrUnknown";
+  }
+  return "";
+}
+
+// Describes a range scan that can replace a full scan over the table in an
+// inner loop of a table product.
+struct ProductRangeScan {
+  unsigned column_offset;
+  const char *kind;
+  DataVariable bound;
+};
+
+// If the body of a table product compares a column of `inner_vars` against
+// one of `outer_vars`, then we can scan an ordered view of that column so that
+// the inner loop only visits records that may satisfy the comparison, rather
+// than visiting the whole table and filtering. The comparison is still
+// generated by the body, so it continues to act as a guard.
+static std::optional<ProductRangeScan> FindProductRangeScan(
+    ProgramRegion body,
+    DefinedNodeRange<DataVariable> outer_vars,
+    DefinedNodeRange<DataVariable> inner_vars) {
+
+  if (!body.IsTupleCompare()) {
+    return std::nullopt;
+  }
+
+  // If there is a false body then we must visit every record.
+  const auto cmp = ProgramTupleCompareRegion::From(body);
+  if (cmp.BodyIfFalse()) {
+    return std::nullopt;
+  }
+
+  // Tuple comparisons are lexicographic; only handle the common case of
+  // comparing a single pair of variables.
+  const auto lhs_vars = cmp.LHS();
+  const auto rhs_vars = cmp.RHS();
+  if (lhs_vars.size() != 1u || rhs_vars.size() != 1u) {
+    return std::nullopt;
+  }
+
+  bool is_less = false;
+  switch (cmp.Operator()) {
+    case ComparisonOperator::kLessThan: is_less = true; break;
+    case ComparisonOperator::kGreaterThan: is_less = false; break;
+    default: return std::nullopt;
+  }
+
+  const auto lhs = *lhs_vars.begin();
+  const auto rhs = *rhs_vars.begin();
+
+  // Only order by built-in integral types. Interned values compare by their
+  // addresses, which isn't a useful order to maintain, and floating-point
+  // values aren't strictly weakly ordered by `<` when there are NaNs, which
+  // would make sorting the ordered view undefined.
+  switch (lhs.Type().UnderlyingKind()) {
+    case TypeKind::kBoolean:
+    case TypeKind::kSigned8:
+    case TypeKind::kSigned16:
+    case TypeKind::kSigned32:
+    case TypeKind::kSigned64:
+    case TypeKind::kUnsigned8:
+    case TypeKind::kUnsigned16:
+    case TypeKind::kUnsigned32:
+    case TypeKind::kUnsigned64: break;
+    default: return std::nullopt;
+  }
+
+  const auto is_outer_var = [&] (DataVariable var) {
+    for (auto outer_var : outer_vars) {
+      if (outer_var == var) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  auto column_offset = 0u;
+  for (auto inner_var : inner_vars) {
+
+    // `inner < bound` or `inner > bound`.
+    if (inner_var == lhs && is_outer_var(rhs)) {
+      return ProductRangeScan{
+          column_offset,
+          is_less ? "::hyde::rt::RangeKind::kLessThan"
+                  : "::hyde::rt::RangeKind::kGreaterThan",
+          rhs};
+
+    // `bound < inner` or `bound > inner`, i.e. `inner > bound` or
+    // `inner < bound`.
+    } else if (inner_var == rhs && is_outer_var(lhs)) {
+      return ProductRangeScan{
+          column_offset,
+          is_less ? "::hyde::rt::RangeKind::kGreaterThan"
+                  : "::hyde::rt::RangeKind::kLessThan",
+          lhs};
+    }
+    ++column_offset;
+  }
+
+  return std::nullopt;
+}
+
+// Find the generate regions in the body of `loop` that apply a `@batch`-
+// attributed functor only to variables extracted from the loop's vector, and
+// that run once per iteration of the loop. The inputs to these regions can be
+// gathered ahead of the loop and passed to the functor's batch method at once.
+static std::vector<ProgramGenerateRegion> FindBatchedGenerates(
+    ProgramVectorLoopRegion loop) {
+  std::vector<ProgramGenerateRegion> generates;
+
+  // Induction vectors are appended to while we loop over them, so their
+  // contents aren't known ahead of the loop.
+  const auto body = loop.Body();
+  if (!body || loop.Usage() == VectorUsage::kInductionVector) {
+    return generates;
+  }
+
+  const auto tuple_vars = loop.TupleVariables();
+  const auto is_tuple_var = [&] (DataVariable var) {
+    for (auto tuple_var : tuple_vars) {
+      if (tuple_var == var) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  // Only look through series and parallel regions; anything else might
+  // conditionally execute its body, or execute it more than once.
+  std::vector<ProgramRegion> work_list;
+  work_list.push_back(*body);
+  while (!work_list.empty()) {
+    const auto region = work_list.back();
+    work_list.pop_back();
+
+    if (region.IsSeries()) {
+      for (auto sub_region : ProgramSeriesRegion::From(region).Regions()) {
+        work_list.push_back(sub_region);
+      }
+
+    } else if (region.IsParallel()) {
+      for (auto sub_region : ProgramParallelRegion::From(region).Regions()) {
+        work_list.push_back(sub_region);
+      }
+
+    } else if (region.IsGenerate()) {
+      const auto gen = ProgramGenerateRegion::From(region);
+      if (!gen.Functor().IsBatched()) {
+        continue;
+      }
+
+      auto all_tuple_vars = true;
+      for (auto in_var : gen.InputVariables()) {
+        if (!is_tuple_var(in_var)) {
+          all_tuple_vars = false;
+          break;
+        }
+      }
+
+      if (all_tuple_vars) {
+        generates.push_back(gen);
+      }
+    }
+  }
+
+  return generates;
+}
+
+// Tracks the regions that are instrumented when generating code with
+// `--profile`. Each region is either a procedure or an induction fixpoint
+// loop, and is identified by its ID in the control-flow IR. Regions remember
+// the Datalog declarations whose tables they change, so that a profile can be
+// mapped back onto the clauses that produced them.
+class Profiler {
+ public:
+  struct Region {
+    unsigned id;
+    const char *kind;
+    std::string name;
+    std::vector<ParsedDeclaration> sources;
+  };
+
+  // Start collecting the sources of a region. Regions nest, e.g. inductions
+  // are nested inside of procedures.
+  void Enter(unsigned id, const char *kind, std::string name) {
+    active.push_back(regions.size());
+    regions.push_back(Region{id, kind, std::move(name), {}});
+  }
+
+  void Exit(void) {
+    active.pop_back();
+  }
+
+  // Attribute `decl` to every active region.
+  void AddSource(ParsedDeclaration decl) {
+    for (auto index : active) {
+      auto &sources = regions[index].sources;
+      auto it = std::find_if(sources.begin(), sources.end(),
+                             [&](ParsedDeclaration source) {
+                               return source.Id() == decl.Id();
+                             });
+      if (it == sources.end()) {
+        sources.push_back(decl);
+      }
+    }
+  }
+
+  // Attribute the declarations inserted into `table` to every active region.
+  void AddSources(DataTable table) {
+    for (QueryView view : table.Views()) {
+      if (view.IsInsert()) {
+        AddSource(QueryInsert::From(view).Declaration());
+      }
+    }
+  }
+
+  // The sources of `region` as a C++ string literal, e.g.
+  // `"path/2@file.dr:12, edge/2@file.dr:3"`.
+  static std::string Sources(const OutputStream &os, const Region &region) {
+    std::stringstream ss;
+    auto sep = "";
+    for (ParsedDeclaration decl : region.sources) {
+      const auto pos = decl.SpellingRange().From();
+      ss << sep << decl.NameAsString() << '/' << decl.Arity();
+      if (pos.IsValid()) {
+        ss << '@' << os.display_manager.DisplayName(pos) << ':' << pos.Line();
+      }
+      sep = ", ";
+    }
+
+    std::string literal = "\"";
+    for (auto ch : ss.str()) {
+      if (ch == '"' || ch == '\\') {
+        literal += '\\';
+      }
+      literal += ch;
+    }
+    literal += '"';
+    return literal;
+  }
+
+  std::vector<Region> regions;
+
+ private:
+  std::vector<size_t> active;
+};
+
 class CPPCodeGenVisitor final : public ProgramVisitor {
  public:
-  explicit CPPCodeGenVisitor(OutputStream &os_, ParsedModule module_)
+  explicit CPPCodeGenVisitor(OutputStream &os_, ParsedModule module_,
+                             Profiler *profiler_,
+                             std::vector<ProgramInductionRegion> &inductions_)
       : os(os_),
-        module(module_) {}
+        module(module_),
+        profiler(profiler_),
+        inductions(inductions_) {}
 
   void Visit(ProgramModeSwitchRegion region) override {
     os << Comment(os, region, "ProgramModeSwitchRegion");
@@ -438,8 +799,7 @@ class CPPCodeGenVisitor final : public ProgramVisitor {
 
     auto output_vars = region.OutputVariables();
 
-    auto call_functor = [&](void) {
-      Functor(os, functor) << "(";
+    auto emit_args = [&](void) {
       auto sep = "";
       for (auto in_var : region.InputVariables()) {
         if (in_var.Type().IsReferentiallyTransparent(module, Language::kCxx)) {
@@ -449,7 +809,30 @@ class CPPCodeGenVisitor final : public ProgramVisitor {
         }
         sep = ", ";
       }
-      os << ")";
+    };
+
+    // Memoized functors are called through their caches, which only invoke
+    // the functor itself on a miss.
+    auto call_functor = [&](void) {
+
+      // The results of batched functors were computed ahead of the loop that
+      // contains this region.
+      if (batched_generates.count(id)) {
+        os << "std::move(batch_outputs_" << id << "[batch_index_" << id
+           << "++])";
+
+      } else if (functor.IsMemoized()) {
+        FunctorCache(os, functor) << ".Call([&] (void) { return ";
+        Functor(os, functor) << "(";
+        emit_args();
+        os << "); }, ";
+        emit_args();
+        os << ")";
+      } else {
+        Functor(os, functor) << "(";
+        emit_args();
+        os << ")";
+      }
     };
 
     auto do_body = [&](void) {
@@ -667,13 +1050,36 @@ class CPPCodeGenVisitor final : public ProgramVisitor {
       init_region->Accept(*this);
     }
 
-    // Fixpoint
+    // Fixpoint. The fixpoint loop is traced so that slow-converging
+    // inductions can be found. The trace tracks the induction's stats, and
+    // reports each iteration to the database's induction tracer, if any. When
+    // profiling, the trace also times each iteration of the fixpoint loop,
+    // and counts the tuples flowing into the iteration.
+    const auto id = region.Id();
+    const auto vectors = region.Vectors();
+    inductions.push_back(region);
+
     os << Comment(os, region, "Induction Fixpoint Loop Region");
-    os << os.Indent() << "for (auto changed_" << region.Id()
-       << " = true; changed_" << region.Id() << "; changed_" << region.Id()
-       << " = !!(";
+    os << os.Indent() << "::hyde::rt::InductionTrace<" << vectors.size()
+       << "> trace_" << id << "(induction_stats_" << id
+       << ", induction_tracer, ";
+    if (profiler) {
+      os << "&profile_" << id;
+    } else {
+      os << "nullptr";
+    }
+    os << ", " << id << "u, {";
     auto sep = "";
-    for (auto vec : region.Vectors()) {
+    for (auto vec : vectors) {
+      os << sep << vec.Id() << 'u';
+      sep = ", ";
+    }
+    os << "});\n";
+
+    os << os.Indent() << "for (auto changed_" << id << " = true; changed_"
+       << id << "; changed_" << id << " = !!(";
+    sep = "";
+    for (auto vec : vectors) {
       os << sep << Vector(os, vec) << ".Size()";
       sep = " | ";
     }
@@ -681,29 +1087,39 @@ class CPPCodeGenVisitor final : public ProgramVisitor {
 
     os.PushIndent();
 
-    os << os.Indent() << "DumpStats();\n"
-       << os.Indent() << "if constexpr (false) {\n";
-    os.PushIndent();
-    os << os.Indent() << "fprintf(stderr, \"";
+    if (profiler) {
+      std::stringstream name;
+      name << "induction_" << id;
+      profiler->Enter(id, "induction", name.str());
+    }
 
+    os << os.Indent() << "trace_" << id << ".BeginIteration({";
     sep = "";
-    for (auto vec : region.Vectors()) {
-      os << sep << "vec_" << vec.Id() << " = %\" PRIu64 \"";
-      sep = " ";
-    }
-    sep = "\\n\", ";
-    for (auto vec : region.Vectors()) {
+    for (auto vec : vectors) {
       os << sep << Vector(os, vec) << ".Size()";
       sep = ", ";
     }
-    os << ");\n";
-    os.PopIndent();
-    os << os.Indent() << "}\n\n";
+    os << "});\n\n";
 
     region.FixpointLoop().Accept(*this);
 
+    if (profiler) {
+      profiler->Exit();
+    }
+
+    // Whatever is left in the induction vectors is the work for the next
+    // iteration.
+    os << "\n" << os.Indent() << "trace_" << id << ".EndIteration(";
+    sep = "";
+    for (auto vec : vectors) {
+      os << sep << Vector(os, vec) << ".Size()";
+      sep = " + ";
+    }
+    os << ");\n";
+
     os.PopIndent();
-    os << os.Indent() << "}\n";
+    os << os.Indent() << "}\n"
+       << os.Indent() << "trace_" << id << ".EndFixpoint();\n";
 
     // Output
     if (auto output = region.Output(); output) {
@@ -805,9 +1221,67 @@ class CPPCodeGenVisitor final : public ProgramVisitor {
 
     os << Comment(os, region, "ProgramVectorLoopRegion");
     auto vec = region.Vector();
-    os << os.Indent() << "for (auto [";
-
     const auto tuple_vars = region.TupleVariables();
+
+    // Gather the inputs to any batched functors, and call each functor's batch
+    // method once. The generate regions in the loop body then consume the
+    // results in order.
+    const auto batched = FindBatchedGenerates(region);
+    if (!batched.empty()) {
+      for (auto gen : batched) {
+        const auto gen_id = gen.Id();
+        os << os.Indent() << "std::vector<std::tuple<";
+        auto type_sep = "";
+        for (auto param : ParsedDeclaration(gen.Functor()).Parameters()) {
+          if (param.Binding() == ParameterBinding::kBound) {
+            os << type_sep << TypeName(module, param.Type());
+            type_sep = ", ";
+          }
+        }
+        os << ">> batch_inputs_" << gen_id << ";\n"
+           << os.Indent() << "batch_inputs_" << gen_id << ".reserve("
+           << Vector(os, vec) << ".Size());\n";
+      }
+
+      os << os.Indent() << "for (auto [";
+      auto var_sep = "";
+      for (auto var : tuple_vars) {
+        os << var_sep << Var(os, var);
+        var_sep = ", ";
+      }
+      os << "] : " << Vector(os, vec) << ") {\n";
+      os.PushIndent();
+      for (auto gen : batched) {
+        os << os.Indent() << "batch_inputs_" << gen.Id() << ".emplace_back(";
+        auto arg_sep = "";
+        for (auto in_var : gen.InputVariables()) {
+          os << arg_sep;
+          if (!in_var.Type().IsReferentiallyTransparent(module,
+                                                        Language::kCxx)) {
+            os << '*';
+          }
+          os << Var(os, in_var);
+          arg_sep = ", ";
+        }
+        os << ");\n";
+      }
+      os.PopIndent();
+      os << os.Indent() << "}\n";
+
+      for (auto gen : batched) {
+        const auto gen_id = gen.Id();
+        const auto functor = gen.Functor();
+        os << os.Indent() << "auto batch_outputs_" << gen_id
+           << " = functors." << functor.Name() << '_'
+           << ParsedDeclaration(functor).BindingPattern() << "_batch("
+           << "batch_inputs_" << gen_id << ");\n"
+           << os.Indent() << "::hyde::rt::index_t batch_index_" << gen_id
+           << " = 0u;\n";
+        batched_generates.insert(gen_id);
+      }
+    }
+
+    os << os.Indent() << "for (auto [";
     auto sep = "";
     for (auto var : tuple_vars) {
       os << sep << Var(os, var);
@@ -829,99 +1303,141 @@ class CPPCodeGenVisitor final : public ProgramVisitor {
 
   void Visit(ProgramChangeTupleRegion region) override {
     os << Comment(os, region, "ProgramChangeTupleRegion");
+    if (profiler) {
+      profiler->AddSources(region.Table());
+    }
+
     const auto tuple_vars = region.TupleVariables();
 
-    auto print_state_enum = [&](TupleState state) {
-      switch (state) {
-        case TupleState::kAbsent: os << "Absent"; break;
-        case TupleState::kPresent: os << "Present"; break;
-        case TupleState::kUnknown: os << "Unknown"; break;
-        case TupleState::kAbsentOrUnknown: os << "AbsentOrUnknown"; break;
-      }
-    };
+    // If the tuple comes from a scanned record, then change the record's
+    // state directly.
+    if (auto provider = region.RecordProvider(); provider) {
+      os << os.Indent() << "if (" << Table(os, region.Table())
+         << ".TryChangeRecordFrom" << TupleStateSuffix(region.FromState())
+         << "To" << TupleStateSuffix(region.ToState()) << '('
+         << RecordPointer(*provider) << ")) {\n";
 
-    os << os.Indent() << "if (" << Table(os, region.Table())
-       << ".TryChangeTupleFrom";
+    } else {
+      os << os.Indent() << "if (" << Table(os, region.Table())
+         << ".TryChangeTupleFrom" << TupleStateSuffix(region.FromState())
+         << "To" << TupleStateSuffix(region.ToState());
 
-    print_state_enum(region.FromState());
-    os << "To";
-    print_state_enum(region.ToState());
+      auto sep = "(";
+      for (auto var : tuple_vars) {
+        os << sep << Var(os, var);
+        sep = ", ";
+      }
 
-    auto sep = "(";
-    for (auto var : tuple_vars) {
-      os << sep << Var(os, var);
-      sep = ", ";
+      os << ")) {\n";
     }
 
-    os << ")) {\n";
-    os.PushIndent();
+    VisitChangeBodies(region.BodyIfSucceeded(), region.BodyIfFailed());
+  }
 
-    if (auto succeeded_body = region.BodyIfSucceeded(); succeeded_body) {
-      succeeded_body->Accept(*this);
+  void Visit(ProgramChangeRecordRegion region) override {
+    os << Comment(os, region, "ProgramChangeRecordRegion");
+    const auto table = region.Table();
+    if (profiler) {
+      profiler->AddSources(table);
     }
 
-    os.PopIndent();
-    os << os.Indent() << "}";
-    if (auto failed_body = region.BodyIfFailed(); failed_body) {
-      os << " else {\n";
-      os.PushIndent();
-      failed_body->Accept(*this);
-      os.PopIndent();
-      os << os.Indent() << "}\n";
+    const auto tuple_vars = region.TupleVariables();
+    const auto rec = RecordPointer(region);
+
+    // The record variables are visible in both the succeeded and failed
+    // bodies, and their values match those of the tuple variables.
+    DefineRecordVariables(region.RecordVariables(), tuple_vars);
+
+    // Find the record to change. If we're transitioning into the present
+    // state then the record might need to be added.
+    auto may_be_null = false;
+    os << os.Indent() << "auto *" << rec << " = ";
+    if (auto provider = region.RecordProvider(); provider) {
+      os << RecordPointer(*provider);
+
     } else {
-      os << '\n';
+      if (region.ToState() == TupleState::kPresent) {
+        os << Table(os, table) << ".GetOrAddRecord";
+      } else {
+        os << Table(os, table) << ".GetRecord";
+        may_be_null = true;
+      }
+
+      auto sep = "(";
+      for (auto var : tuple_vars) {
+        os << sep << Var(os, var);
+        sep = ", ";
+      }
+      os << ')';
+    }
+    os << ";\n";
+
+    os << os.Indent() << "if (";
+    if (may_be_null) {
+      os << rec << " && ";
     }
+    os << Table(os, table) << ".TryChangeRecordFrom"
+       << TupleStateSuffix(region.FromState()) << "To"
+       << TupleStateSuffix(region.ToState()) << '(' << rec << ")) {\n";
+
+    VisitChangeBodies(region.BodyIfSucceeded(), region.BodyIfFailed());
   }
 
   void Visit(ProgramCheckTupleRegion region) override {
     os << Comment(os, region, "ProgramCheckTupleRegion");
     const auto table = region.Table();
     const auto vars = region.TupleVariables();
-    os << os.Indent() << "switch (" << Table(os, table) << ".GetState(";
-    auto sep = "";
-    for (auto var : vars) {
-      os << sep << Var(os, var);
-      sep = ", ";
-    }
-    os << ")) {\n";
 
-    os.PushIndent();
+    // If the tuple comes from a scanned record, then read the record's state
+    // directly.
+    if (auto provider = region.RecordProvider(); provider) {
+      os << os.Indent() << "switch (" << Table(os, table) << ".GetRecordState("
+         << RecordPointer(*provider) << ")) {\n";
 
-    if (auto absent_body = region.IfAbsent(); absent_body) {
-      os << os.Indent() << "case ::hyde::rt::TupleState::kAbsent: {\n";
-      os.PushIndent();
-      absent_body->Accept(*this);
-      os << os.Indent() << "break;\n";
-      os.PopIndent();
-      os << os.Indent() << "}\n";
     } else {
-      os << os.Indent() << "case ::hyde::rt::TupleState::kAbsent: break;\n";
+      os << os.Indent() << "switch (" << Table(os, table) << ".GetState(";
+      auto sep = "";
+      for (auto var : vars) {
+        os << sep << Var(os, var);
+        sep = ", ";
+      }
+      os << ")) {\n";
     }
 
-    if (auto present_body = region.IfPresent(); present_body) {
-      os << os.Indent() << "case ::hyde::rt::TupleState::kPresent: {\n";
-      os.PushIndent();
-      present_body->Accept(*this);
-      os << os.Indent() << "break;\n";
-      os.PopIndent();
-      os << os.Indent() << "}\n";
-    } else {
-      os << os.Indent() << "case ::hyde::rt::TupleState::kPresent: break;\n";
-    }
+    VisitStateCases(region.IfAbsent(), region.IfPresent(), region.IfUnknown());
+  }
+
+  void Visit(ProgramCheckRecordRegion region) override {
+    os << Comment(os, region, "ProgramCheckRecordRegion");
+    const auto table = region.Table();
+    const auto vars = region.TupleVariables();
+    const auto rec = RecordPointer(region);
+
+    // The record variables are visible in all bodies, and their values match
+    // those of the tuple variables.
+    DefineRecordVariables(region.RecordVariables(), vars);
+
+    if (auto provider = region.RecordProvider(); provider) {
+      os << os.Indent() << "auto *" << rec << " = " << RecordPointer(*provider)
+         << ";\n"
+         << os.Indent() << "switch (" << Table(os, table) << ".GetRecordState("
+         << rec << ")) {\n";
 
-    if (auto unknown_body = region.IfUnknown(); unknown_body) {
-      os << os.Indent() << "case ::hyde::rt::TupleState::kUnknown: {\n";
-      os.PushIndent();
-      unknown_body->Accept(*this);
-      os << os.Indent() << "break;\n";
-      os.PopIndent();
-      os << os.Indent() << "}\n";
     } else {
-      os << os.Indent() << "case ::hyde::rt::TupleState::kUnknown: break;\n";
+      os << os.Indent() << "auto *" << rec << " = " << Table(os, table)
+         << ".GetRecord(";
+      auto sep = "";
+      for (auto var : vars) {
+        os << sep << Var(os, var);
+        sep = ", ";
+      }
+      os << ");\n"
+         << os.Indent() << "switch (" << rec << " ? " << Table(os, table)
+         << ".GetRecordState(" << rec
+         << ") : ::hyde::rt::TupleState::kAbsent) {\n";
     }
 
-    os.PopIndent();
-    os << os.Indent() << "}\n";
+    VisitStateCases(region.IfAbsent(), region.IfPresent(), region.IfUnknown());
   }
 
   void Visit(ProgramTableJoinRegion region) override {
@@ -980,21 +1496,28 @@ class CPPCodeGenVisitor final : public ProgramVisitor {
     }
 
     // Now, iterate over the scans over the tables where we do use an index.
+    // We iterate with explicit iterators so that state checks and changes
+    // nested inside the body can get at the scanned records.
     for (auto i = 0u; i < tables.size(); ++i) {
       auto out_vars = region.OutputVariables(i);
       assert(out_vars.size() == region.SelectedColumns(i).size());
-      os << os.Indent() << "for (auto [";
+      os << os.Indent() << "for (auto " << RecordIterator(region, i)
+         << " = scan_" << id << '_' << i << ".begin(), end_" << id << '_' << i
+         << " = scan_" << id << '_' << i << ".end(); "
+         << RecordIterator(region, i) << " != end_" << id << '_' << i
+         << "; ++" << RecordIterator(region, i) << ") {\n";
+
+      // We increase indentation here, and the corresponding `PopIndent()`
+      // only comes *after* visiting the `region.Body()`.
+      os.PushIndent();
+
+      os << os.Indent() << "auto [";
       sep = "";
       for (auto var : out_vars) {
         os << sep << Var(os, var);
         sep = ", ";
       }
-
-      os << "] : scan_" << id << '_' << i << ") {\n";
-
-      // We increase indentation here, and the corresponding `PopIndent()`
-      // only comes *after* visiting the `region.Body()`.
-      os.PushIndent();
+      os << "] = *" << RecordIterator(region, i) << ";\n";
     }
 
     body->Accept(*this);
@@ -1045,21 +1568,16 @@ class CPPCodeGenVisitor final : public ProgramVisitor {
       const auto outer_vec = region.Vector(i++);
       (void) outer_table;
 
-      os << os.Indent() << "for (auto ";
-      auto outer_vars_size = outer_vars.size();
-      if (outer_vars_size > 1) {
-        os << "[";
-      }
+      // NOTE(pag): Vectors always produce tuples, even for single-column
+      //            vectors, so we always destructure them.
+      os << os.Indent() << "for (auto [";
       auto sep = "";
       for (auto var : outer_vars) {
         os << sep << Var(os, var);
         sep = ", ";
       }
-      if (outer_vars_size > 1) {
-        os << "]";
-      }
 
-      os << " : " << Vector(os, outer_vec) << ") {\n";
+      os << "] : " << Vector(os, outer_vec) << ") {\n";
       auto indents = 1u;
       os.PushIndent();
 
@@ -1073,24 +1591,32 @@ class CPPCodeGenVisitor final : public ProgramVisitor {
           continue;
         }
 
-        os << os.Indent() << "::hyde::rt::Scan<StorageT, ::hyde::rt::TableTag<"
-           << inner_table.Id() << ">> scan_" << id << "_" << i << "_" << j
-           << "(storage, " << Table(os, inner_table) << ");\n";
+        // If the body compares a column of the inner table against something
+        // from the outer vector, then scan only the matching range of the
+        // inner table.
+        if (auto range = FindProductRangeScan(*body, outer_vars, inner_vars)) {
+          os << os.Indent()
+             << "::hyde::rt::Scan<StorageT, ::hyde::rt::RangeTag<"
+             << inner_table.Id() << ", " << range->column_offset << ", "
+             << range->kind << ">> scan_" << id << "_" << i << "_" << j
+             << "(storage, " << Table(os, inner_table) << ", "
+             << Var(os, range->bound) << ");\n";
 
-        os << os.Indent() << "for (auto ";
-        auto inner_vars_size = inner_vars.size();
-        if (inner_vars_size > 1) {
-          os << "[";
+        } else {
+          os << os.Indent()
+             << "::hyde::rt::Scan<StorageT, ::hyde::rt::TableTag<"
+             << inner_table.Id() << ">> scan_" << id << "_" << i << "_" << j
+             << "(storage, " << Table(os, inner_table) << ");\n";
         }
+
+        // NOTE(pag): Likewise, scans always produce tuples.
+        os << os.Indent() << "for (auto [";
         sep = "";
         for (auto var : inner_vars) {
           os << sep << Var(os, var);
           sep = ", ";
         }
-        if (inner_vars_size > 1) {
-          os << "]";
-        }
-        os << " : scan_" << id << "_" << i << "_" << j << ") {\n";
+        os << "] : scan_" << id << "_" << i << "_" << j << ") {\n";
         os.PushIndent();
         ++indents;
       }
@@ -1161,15 +1687,22 @@ class CPPCodeGenVisitor final : public ProgramVisitor {
     }
     os << ");\n";
 
-    os << os.Indent() << "for (auto [";
+    // We iterate with an explicit iterator so that state checks and changes
+    // nested inside the body can get at the scanned records.
+    os << os.Indent() << "for (auto " << RecordIterator(region, 0u)
+       << " = scan_" << id << ".begin(), end_" << id << " = scan_" << id
+       << ".end(); " << RecordIterator(region, 0u) << " != end_" << id
+       << "; ++" << RecordIterator(region, 0u) << ") {\n";
+    os.PushIndent();
+
+    os << os.Indent() << "auto [";
     auto sep = "";
     for (auto var : region.OutputVariables()) {
       os << sep << Var(os, var);
       sep = ", ";
     }
-    os << "] : scan_" << id << ") {\n";
+    os << "] = *" << RecordIterator(region, 0u) << ";\n";
 
-    os.PushIndent();
     body->Accept(*this);
     os.PopIndent();
     os << os.Indent() << "}\n";
@@ -1225,29 +1758,112 @@ class CPPCodeGenVisitor final : public ProgramVisitor {
   }
 
  private:
+
+  // Define the variables of a record check or change. Their values are the
+  // same as those of the tuple variables.
+  void DefineRecordVariables(DefinedNodeRange<DataVariable> record_vars,
+                             UsedNodeRange<DataVariable> tuple_vars) {
+    auto i = 0u;
+    for (auto var : record_vars) {
+      os << os.Indent() << "auto " << Var(os, var) << " = "
+         << Var(os, tuple_vars[i++]) << ";\n";
+    }
+  }
+
+  // Emit the bodies of a state change, following an already emitted
+  // `if (...) {`.
+  void VisitChangeBodies(std::optional<ProgramRegion> succeeded_body,
+                         std::optional<ProgramRegion> failed_body) {
+    os.PushIndent();
+    if (succeeded_body) {
+      succeeded_body->Accept(*this);
+    }
+    os.PopIndent();
+    os << os.Indent() << "}";
+    if (failed_body) {
+      os << " else {\n";
+      os.PushIndent();
+      failed_body->Accept(*this);
+      os.PopIndent();
+      os << os.Indent() << "}\n";
+    } else {
+      os << '\n';
+    }
+  }
+
+  // Emit the cases of a state check, following an already emitted
+  // `switch (...) {`.
+  void VisitStateCases(std::optional<ProgramRegion> absent_body,
+                       std::optional<ProgramRegion> present_body,
+                       std::optional<ProgramRegion> unknown_body) {
+    os.PushIndent();
+
+    if (absent_body) {
+      os << os.Indent() << "case ::hyde::rt::TupleState::kAbsent: {\n";
+      os.PushIndent();
+      absent_body->Accept(*this);
+      os << os.Indent() << "break;\n";
+      os.PopIndent();
+      os << os.Indent() << "}\n";
+    } else {
+      os << os.Indent() << "case ::hyde::rt::TupleState::kAbsent: break;\n";
+    }
+
+    if (present_body) {
+      os << os.Indent() << "case ::hyde::rt::TupleState::kPresent: {\n";
+      os.PushIndent();
+      present_body->Accept(*this);
+      os << os.Indent() << "break;\n";
+      os.PopIndent();
+      os << os.Indent() << "}\n";
+    } else {
+      os << os.Indent() << "case ::hyde::rt::TupleState::kPresent: break;\n";
+    }
+
+    if (unknown_body) {
+      os << os.Indent() << "case ::hyde::rt::TupleState::kUnknown: {\n";
+      os.PushIndent();
+      unknown_body->Accept(*this);
+      os << os.Indent() << "break;\n";
+      os.PopIndent();
+      os << os.Indent() << "}\n";
+    } else {
+      os << os.Indent() << "case ::hyde::rt::TupleState::kUnknown: break;\n";
+    }
+
+    os.PopIndent();
+    os << os.Indent() << "}\n";
+  }
+
   OutputStream &os;
   const ParsedModule module;
+
+  // Non-null when generating code with `--profile`.
+  Profiler *const profiler;
+
+  // Induction regions visited so far. Each induction has its own stats.
+  std::vector<ProgramInductionRegion> &inductions;
+
+  // IDs of generate regions whose results are computed by a batched call ahead
+  // of their containing loop.
+  std::unordered_set<unsigned> batched_generates;
 };
 
-static void DeclareFunctor(OutputStream &os, ParsedModule module,
-                           ParsedFunctor func) {
+// Emit the return type of the C++ function implementing `func`.
+static void FunctorReturnType(OutputStream &os, ParsedModule module,
+                              ParsedFunctor func) {
   ParsedDeclaration decl(func);
   std::stringstream return_tuple;
-  std::vector<ParsedParameter> args;
   auto sep_ret = "";
   auto num_ret_types = 0u;
   for (auto param : decl.Parameters()) {
-    if (param.Binding() == ParameterBinding::kBound) {
-      args.push_back(param);
-    } else {
+    if (param.Binding() != ParameterBinding::kBound) {
       ++num_ret_types;
       return_tuple << sep_ret << TypeName(module, param.Type());
       sep_ret = ", ";
     }
   }
 
-  os << os.Indent();
-
   if (func.IsFilter()) {
     assert(func.Range() == FunctorRange::kZeroOrOne);
     os << "bool";
@@ -1276,7 +1892,20 @@ static void DeclareFunctor(OutputStream &os, ParsedModule module,
            << tuple_suffix << ">";
     }
   }
+}
+
+static void DeclareFunctor(OutputStream &os, ParsedModule module,
+                           ParsedFunctor func) {
+  ParsedDeclaration decl(func);
+  std::vector<ParsedParameter> args;
+  for (auto param : decl.Parameters()) {
+    if (param.Binding() == ParameterBinding::kBound) {
+      args.push_back(param);
+    }
+  }
 
+  os << os.Indent();
+  FunctorReturnType(os, module, func);
   os << " " << func.Name() << '_'
      << ParsedDeclaration(func).BindingPattern() << '(';
 
@@ -1303,6 +1932,58 @@ static void DefineFunctor(OutputStream &os, ParsedModule module,
   os << os.Indent() << "virtual\n";
   DeclareFunctor(os, module, func);
   os << " = 0;\n";
+
+  if (!func.IsBatched()) {
+    return;
+  }
+
+  // The batch method takes the inputs of many calls at once, and returns their
+  // results in the same order. By default, it calls the functor once per
+  // input.
+  std::stringstream input_tuple;
+  auto sep = "";
+  for (auto param : decl.Parameters()) {
+    if (param.Binding() == ParameterBinding::kBound) {
+      input_tuple << sep << TypeName(module, param.Type());
+      sep = ", ";
+    }
+  }
+
+  os << "\n" << os.Indent() << "virtual\n" << os.Indent() << "std::vector<";
+  FunctorReturnType(os, module, func);
+  os << "> " << func.Name() << '_' << decl.BindingPattern()
+     << "_batch(const std::vector<std::tuple<" << input_tuple.str()
+     << ">> &inputs) {\n";
+  os.PushIndent();
+  os << os.Indent() << "std::vector<";
+  FunctorReturnType(os, module, func);
+  os << "> outputs;\n"
+     << os.Indent() << "outputs.reserve(inputs.size());\n"
+     << os.Indent() << "for (const auto &input : inputs) {\n";
+  os.PushIndent();
+  os << os.Indent() << "outputs.emplace_back(std::apply(\n"
+     << os.Indent() << "    [this] (const auto &...args) { return "
+     << func.Name() << '_' << decl.BindingPattern() << "(args...); },\n"
+     << os.Indent() << "    input));\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n"
+     << os.Indent() << "return outputs;\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n\n";
+}
+
+// Declare the cache of results of a `@memoize`-attributed functor.
+static void DeclareFunctorCache(OutputStream &os, ParsedModule module,
+                                ParsedFunctor func) {
+  os << os.Indent() << "::hyde::rt::FunctorCache<";
+  FunctorReturnType(os, module, func);
+  for (auto param : ParsedDeclaration(func).Parameters()) {
+    if (param.Binding() == ParameterBinding::kBound) {
+      os << ", " << TypeName(module, param.Type());
+    }
+  }
+  os << "> ";
+  FunctorCache(os, func) << ";\n";
 }
 
 static void DeclareFunctors(OutputStream &os, Program program,
@@ -1418,8 +2099,15 @@ static void DeclareMessageLog(OutputStream &os, Program program,
   }
 }
 
+// The name of the member holding the call counters of `proc`.
+static OutputStream &ProcedureStats(OutputStream &os, ProgramProcedure proc) {
+  os << "stats_";
+  return Procedure(os, proc);
+}
+
 static void DefineProcedure(OutputStream &os, ParsedModule module,
-                            ProgramProcedure proc) {
+                            ProgramProcedure proc, Profiler *profiler,
+                            std::vector<ProgramInductionRegion> &inductions) {
 
   // Every procedure has a boolean return type. A lot of the time the return
   // type is not used, but for top-down checkers (which try to prove whether or
@@ -1458,6 +2146,41 @@ static void DefineProcedure(OutputStream &os, ParsedModule module,
   os << ") {\n";
   os.PushIndent();
 
+  // Count calls to every procedure, but only time the entrypoints into the
+  // database, which are called once per batch of messages. Everything else
+  // can be called once per tuple, and reading the clock would then cost more
+  // than the work being measured.
+  os << os.Indent() << "++" << ProcedureStats(os, proc) << ".num_calls;\n";
+  if (proc.Kind() == ProcedureKind::kInitializer ||
+      proc.Kind() == ProcedureKind::kMessageHandler) {
+    os << os.Indent() << "::hyde::rt::ProcedureTimer _timer("
+       << ProcedureStats(os, proc) << ");\n";
+  }
+
+  // Time every procedure when profiling, and count the tuples passed in to
+  // it through vectors.
+  if (profiler) {
+    std::stringstream name;
+    OutputStream name_os(os.display_manager, name);
+    Procedure(name_os, proc);
+    profiler->Enter(proc.Id(), "procedure", name.str());
+    if (auto message = proc.Message(); message) {
+      profiler->AddSource(ParsedDeclaration(*message));
+    }
+
+    os << os.Indent() << "::hyde::rt::RegionTimer _profile(profile_"
+       << proc.Id() << ");\n";
+    if (!vec_params.empty()) {
+      os << os.Indent() << "profile_" << proc.Id() << ".num_tuples += ";
+      sep = "";
+      for (auto vec : vec_params) {
+        os << sep << Vector(os, vec) << ".Size()";
+        sep = " + ";
+      }
+      os << ";\n";
+    }
+  }
+
   // Define the vectors that will be created and used within this procedure.
   // These vectors exist to support inductions, joins (pivot vectors), etc.
   for (auto vec : proc.DefinedVectors()) {
@@ -1473,9 +2196,13 @@ static void DefineProcedure(OutputStream &os, ParsedModule module,
 
   // Visit the body of the procedure. Procedure bodies are never empty; the
   // most trivial procedure body contains a `return False`.
-  CPPCodeGenVisitor visitor(os, module);
+  CPPCodeGenVisitor visitor(os, module, profiler, inductions);
   proc.Body().Accept(visitor);
 
+  if (profiler) {
+    profiler->Exit();
+  }
+
   // From a codegen perspective, we guarantee that all paths through all
   // functions return, but mypy isn't always smart enough, mostly because we
   // have our returns inside of conditionals that mypy doesn't know are
@@ -1560,18 +2287,24 @@ static void DefineQueryEntryPoint(OutputStream &os, ParsedModule module,
     os << ");\n";
   }
 
-  // This is either a table or index scan.
+  // This is either a table or index scan. The scan skips over absent records
+  // on our behalf, and if there's no tuple checker, then it also skips over
+  // unknown records, so that we don't need to re-check their states.
+  const auto scan_states =
+      spec.tuple_checker ? ", ::hyde::rt::TupleState::kPresent, "
+                           "::hyde::rt::TupleState::kUnknown>"
+                         : ", ::hyde::rt::TupleState::kPresent>";
   if (num_free_params) {
     os << os.Indent() << "::hyde::rt::Scan<StorageT, ::hyde::rt::";
 
     // This is an index scan.
     if (num_bound_params) {
       assert(spec.index.has_value());
-      os << "IndexTag<" << spec.index->Id() << ">";
+      os << "FilteredIndexTag<" << spec.index->Id() << scan_states;
 
     // This is a full table scan.
     } else {
-      os << "TableTag<" << spec.table.Id() << ">";
+      os << "FilteredTableTag<" << spec.table.Id() << scan_states;
     }
 
     os << "> scan(storage, " << Table(os, spec.table);
@@ -1642,9 +2375,18 @@ static void DefineQueryEntryPoint(OutputStream &os, ParsedModule module,
       sep = ", ";
     }
     os << ")) {\n";
+    os.PushIndent();
+    if (num_free_params) {
+      os << os.Indent() << "continue;\n";
+    } else {
+      os << os.Indent() << "return num_generated;\n";
+    }
+    os.PopIndent();
+    os << os.Indent() << "}\n";
 
-  // Check the tuple's state directly.
-  } else {
+  // Check the tuple's state directly. If we're scanning, then the scan has
+  // already filtered out non-present tuples.
+  } else if (!num_free_params) {
     os << os.Indent() << "if (" << Table(os, spec.table) << ".GetState(";
 
     sep = "";
@@ -1653,16 +2395,11 @@ static void DefineQueryEntryPoint(OutputStream &os, ParsedModule module,
       sep = ", ";
     }
     os << ") != ::hyde::rt::TupleState::kPresent) {\n";
-  }
-
-  os.PushIndent();
-  if (num_free_params) {
-    os << os.Indent() << "continue;\n";
-  } else {
+    os.PushIndent();
     os << os.Indent() << "return num_generated;\n";
+    os.PopIndent();
+    os << os.Indent() << "}\n";
   }
-  os.PopIndent();
-  os << os.Indent() << "}\n";
 
   os << os.Indent() << "num_generated += 1u;\n";
 
@@ -1694,10 +2431,15 @@ static void DefineQueryEntryPoint(OutputStream &os, ParsedModule module,
 }  // namespace
 
 // Emits C++ code for the given program to `os`.
-void GenerateDatabaseCode(const Program &program, OutputStream &os) {
+void GenerateDatabaseCode(const Program &program, OutputStream &os,
+                          bool profile) {
   const auto module = program.ParsedModule();
   const auto inlines = Inlines(module, Language::kCxx);
 
+  Profiler profiler;
+  Profiler *const profiler_ptr = profile ? &profiler : nullptr;
+  std::vector<ProgramInductionRegion> inductions;
+
   std::string file_name = "datalog";
   std::string ns_name;
   std::string macro_name;
@@ -1799,6 +2541,22 @@ void GenerateDatabaseCode(const Program &program, OutputStream &os) {
        << Table(os, table) << ";\n";
   }
 
+  std::vector<ParsedFunctor> memoized_functors;
+  for (ParsedFunctor func : Functors(module)) {
+    if (func.IsMemoized() && !func.IsAggregate()) {
+      memoized_functors.push_back(func);
+      DeclareFunctorCache(os, module, func);
+    }
+  }
+
+  for (auto proc : program.Procedures()) {
+    os << os.Indent() << "::hyde::rt::ProcedureStats "
+       << ProcedureStats(os, proc) << ";\n";
+  }
+
+  os << os.Indent()
+     << "::hyde::rt::InductionTracer *induction_tracer{nullptr};\n";
+
   for (auto global : program.GlobalVariables()) {
     DefineGlobal(os, module, global);
   }
@@ -1847,7 +2605,7 @@ void GenerateDatabaseCode(const Program &program, OutputStream &os) {
 
   for (auto proc : program.Procedures()) {
     if (proc.Kind() == ProcedureKind::kQueryMessageInjector) {
-      DefineProcedure(os, module, proc);
+      DefineProcedure(os, module, proc, profiler_ptr, inductions);
     }
   }
 
@@ -1857,7 +2615,7 @@ void GenerateDatabaseCode(const Program &program, OutputStream &os) {
 
   for (auto proc : program.Procedures()) {
     if (proc.Kind() == ProcedureKind::kMessageHandler) {
-      DefineProcedure(os, module, proc);
+      DefineProcedure(os, module, proc, profiler_ptr, inductions);
     }
   }
 
@@ -1881,48 +2639,98 @@ void GenerateDatabaseCode(const Program &program, OutputStream &os) {
 
   os.PopIndent();
   os << os.Indent() << "}\n\n"
-     << os.Indent() << "void DumpStats(void) const {\n";
-  os.PushIndent();
-  os << os.Indent() << "if constexpr (true) {\n";
+     << os.Indent() << "template <typename Printer>\n"
+     << os.Indent() << "void DumpFunctorCacheStats(Printer _print) const {\n";
   os.PushIndent();
-  os << os.Indent() << "return;  /* change to false to enable */\n";
+
+  for (ParsedFunctor func : memoized_functors) {
+    os << os.Indent() << "_print(\"" << func.Name() << '_'
+       << ParsedDeclaration(func).BindingPattern() << "\", ";
+    FunctorCache(os, func) << ".NumHits(), ";
+    FunctorCache(os, func) << ".NumMisses());\n";
+  }
+
   os.PopIndent();
-  os << os.Indent() << "}\n"
-     << os.Indent() << "static FILE *tables = nullptr;\n"
-     << os.Indent() << "if (!tables) {\n";
+  os << os.Indent() << "}\n\n"
+     << os.Indent() << "template <typename Printer>\n"
+     << os.Indent() << "void DumpTableStats(Printer _print) const {\n";
   os.PushIndent();
-  os << os.Indent() << "tables = fopen(\"/tmp/tables.csv\", \"w\");\n"
-     << os.Indent() << "fprintf(tables, \"";
 
-  auto sep = "";
   for (auto table : program.Tables()) {
-    os << sep << "table " << table.Id();
-    sep = ",";
+    os << os.Indent() << "_print(" << table.Id() << ", "
+       << Table(os, table) << ".Stats());\n";
   }
-  os << "\\n\");\n";
+
   os.PopIndent();
-  os << os.Indent() << "}\n";
-  os << os.Indent() << "fprintf(tables, \"";
-  sep = "";
-  for (auto table : program.Tables()) {
-    (void) table;
-    os << sep << "%\" PRIu64 \"";
-    sep = ",";
-  }
-  os << "\\n\"";
-  for (auto table : program.Tables()) {
-    os << ", " << Table(os, table) << ".Size()";
+  os << os.Indent() << "}\n\n"
+     << os.Indent() << "template <typename Printer>\n"
+     << os.Indent() << "void DumpProcedureStats(Printer _print) const {\n";
+  os.PushIndent();
+
+  for (auto proc : program.Procedures()) {
+    os << os.Indent() << "_print(\"" << Procedure(os, proc) << "\", "
+       << ProcedureStats(os, proc) << ");\n";
   }
-  os << ");\n";
 
+  os.PopIndent();
+  os << os.Indent() << "}\n\n"
+     << os.Indent() << "// Report every iteration of every induction to "
+     << "`tracer`, or stop tracing\n"
+     << os.Indent() << "// if `tracer` is `nullptr`.\n"
+     << os.Indent()
+     << "void SetInductionTracer(::hyde::rt::InductionTracer *tracer) {\n";
+  os.PushIndent();
+  os << os.Indent() << "induction_tracer = tracer;\n";
   os.PopIndent();
   os << os.Indent() << "}\n\n";
 
   for (auto proc : program.Procedures()) {
     if (proc.Kind() != ProcedureKind::kMessageHandler &&
         proc.Kind() != ProcedureKind::kQueryMessageInjector) {
-      DefineProcedure(os, module, proc);
+      DefineProcedure(os, module, proc, profiler_ptr, inductions);
+    }
+  }
+
+  // The inductions and profiled regions are only known once all procedures
+  // are defined, so their counters go at the end of the class.
+  for (auto induction : inductions) {
+    os << os.Indent() << "::hyde::rt::InductionStats induction_stats_"
+       << induction.Id() << ";\n";
+  }
+
+  os << "\n"
+     << os.Indent() << "template <typename Printer>\n"
+     << os.Indent() << "void DumpInductionStats(Printer _print) const {\n";
+  os.PushIndent();
+
+  for (auto induction : inductions) {
+    os << os.Indent() << "_print(" << induction.Id() << "u, induction_stats_"
+       << induction.Id() << ");\n";
+  }
+
+  os.PopIndent();
+  os << os.Indent() << "}\n\n";
+
+  if (profile) {
+    for (const auto &region : profiler.regions) {
+      os << os.Indent() << "::hyde::rt::RegionProfile profile_" << region.id
+         << ";\n";
     }
+
+    os << "\n"
+       << os.Indent() << "template <typename Printer>\n"
+       << os.Indent() << "void DumpProfile(Printer _print) const {\n";
+    os.PushIndent();
+
+    for (const auto &region : profiler.regions) {
+      os << os.Indent() << "_print(" << region.id << "u, \"" << region.kind
+         << "\", \"" << region.name << "\", "
+         << Profiler::Sources(os, region) << ", profile_" << region.id
+         << ");\n";
+    }
+
+    os.PopIndent();
+    os << os.Indent() << "}\n\n";
   }
 
   os.PopIndent();  // private:
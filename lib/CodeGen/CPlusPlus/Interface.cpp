@@ -237,6 +237,35 @@ void GenerateInterfaceCode(const Program &program, OutputStream &os) {
   os.PopIndent();
   os << os.Indent() << "}\n\n";  // Empty
 
+  // Make a method that merges another input message into this one, so that
+  // many small input messages can be applied to the database all at once.
+  // Additions can always be merged, but retractions are order-sensitive with
+  // respect to the additions of other messages, so we refuse to merge them.
+  os << os.Indent() << "bool Merge(" << gClassName
+     << "InputMessage<StorageT> &that) noexcept {\n";
+  os.PushIndent();
+  for (auto [vec, message, added] : message_vecs) {
+    if (!added) {
+      os << os.Indent() << "if (vec_" << vec.Id() << ".Size() || that.vec_"
+         << vec.Id() << ".Size()) {\n";
+      os.PushIndent();
+      os << os.Indent() << "return false;\n";
+      os.PopIndent();
+      os << os.Indent() << "}\n";
+    }
+  }
+  os << os.Indent() << "size += that.size;\n"
+     << os.Indent() << "that.size = 0u;\n";
+  for (auto [vec, message, added] : message_vecs) {
+    if (added) {
+      os << os.Indent() << "vec_" << vec.Id() << ".Extend(that.vec_"
+         << vec.Id() << ");\n";
+    }
+  }
+  os << os.Indent() << "return true;\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n\n";  // Merge
+
   for (auto [vec, message, added] : message_vecs) {
     DeclareAppendMessageMethod(os, module, vec, message, added);
   }
@@ -339,6 +368,7 @@ void GenerateInterfaceCode(const Program &program, OutputStream &os) {
           sep = ", ";
         }
         os << ");\n";
+        os << os.Indent() << "return true;\n";
       } else {
         os << os.Indent() << "return false;\n";
       }
@@ -701,17 +731,26 @@ void GenerateInterfaceCode(const Program &program, OutputStream &os) {
     // This is either a table or index scan.
     if (num_rets) {
 
+      // The scan only visits present records, unless this is a differential
+      // message, in which case the forcing function double checks unknown
+      // records.
+      const auto scan_states =
+          query_info.forcing_function
+              ? ", ::hyde::rt::TupleState::kPresent, "
+                "::hyde::rt::TupleState::kUnknown>"
+              : ", ::hyde::rt::TupleState::kPresent>";
+
       os << os.Indent()
          << "using ScanType = ::hyde::rt::Scan<StorageT, ::hyde::rt::";
 
       // This is an index scan.
       if (num_params) {
         assert(query_info.index.has_value());
-        os << "IndexTag<" << query_info.index->Id() << ">";
+        os << "FilteredIndexTag<" << query_info.index->Id() << scan_states;
 
       // This is a full table scan.
       } else {
-        os << "TableTag<" << query_info.table.Id() << ">";
+        os << "FilteredTableTag<" << query_info.table.Id() << scan_states;
       }
 
       os << ">;\n"
@@ -29,26 +29,347 @@ static bool AllParametersAreBound(ParsedDeclaration decl) {
   return all_bound;
 }
 
+// Define the `Subscription` structure, which records which published messages
+// a client wants, and which values it wants in each filtered column. Clients
+// with identical subscriptions have identical `key`s, which lets us build the
+// filtered output for all of them at once.
+static void DefineSubscription(ParsedModule module,
+                               const std::vector<ParsedMessage> &messages,
+                               OutputStream &os) {
+  os << "struct Subscription {\n";
+  os.PushIndent();
+  os << os.Indent() << "bool has_filters{false};\n"
+     << os.Indent() << "std::string key;";
+
+  for (ParsedMessage message : messages) {
+    if (!message.IsPublished()) {
+      continue;
+    }
+    os << "\n"
+       << os.Indent() << "bool " << message.Name() << "_" << message.Arity()
+       << "{true};";
+    for (ParsedParameter param : ParsedDeclaration(message).Parameters()) {
+      if (IsFilterableType(module, param.Type())) {
+        os << "\n"
+           << os.Indent() << "std::vector<" << TypeName(module, param.Type())
+           << "> " << message.Name() << "_" << message.Arity() << "_"
+           << param.Name() << ";";
+      }
+    }
+  }
+
+  os << "\n\n"
+     << os.Indent() << "template <typename T>\n"
+     << os.Indent() << "static void AddToKey(std::string &key, const std::vector<T> &values) {\n";
+  os.PushIndent();
+  os << os.Indent() << "const auto size = values.size();\n"
+     << os.Indent() << "key.append(reinterpret_cast<const char *>(&size), sizeof(size));\n"
+     << os.Indent() << "for (T value : values) {\n";
+  os.PushIndent();
+  os << os.Indent() << "key.append(reinterpret_cast<const char *>(&value), sizeof(value));\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n\n"
+     << os.Indent() << "template <typename T>\n"
+     << os.Indent() << "static bool Accepts(const std::vector<T> &values, const T &value) {\n";
+  os.PushIndent();
+  os << os.Indent() << "return values.empty() || std::binary_search(values.begin(), values.end(), value);\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n\n"
+     << os.Indent() << "Subscription(void) = default;\n\n"
+     << os.Indent() << "explicit Subscription(const Client *client) {\n";
+  os.PushIndent();
+
+  // Figure out which topics the client wants.
+  os << os.Indent() << "if (auto topics = client->topics(); topics && topics->size()) {\n";
+  os.PushIndent();
+  os << os.Indent() << "has_filters = true;\n";
+  auto has_published = false;
+  for (ParsedMessage message : messages) {
+    if (message.IsPublished()) {
+      has_published = true;
+      os << os.Indent() << message.Name() << "_" << message.Arity()
+         << " = false;\n";
+    }
+  }
+  if (has_published) {
+    os << os.Indent() << "for (auto topic : *topics) {\n";
+    os.PushIndent();
+    os << os.Indent() << "const auto topic_name = topic->str();\n";
+    os << os.Indent();
+    auto sep = "";
+    for (ParsedMessage message : messages) {
+      if (message.IsPublished()) {
+        os << sep << "if (topic_name == \"" << message.Name()
+           << "_" << message.Arity() << "\") {\n";
+        os.PushIndent();
+        os << os.Indent() << message.Name() << "_" << message.Arity()
+           << " = true;\n";
+        os.PopIndent();
+        os << os.Indent() << "}";
+        sep = " else ";
+      }
+    }
+    os << "\n";
+    os.PopIndent();
+    os << os.Indent() << "}\n";  // for
+  }
+  os.PopIndent();
+  os << os.Indent() << "}\n";  // topics
+
+  // Collect the sorted, unique values accepted by each filtered column.
+  for (ParsedMessage message : messages) {
+    if (!message.IsPublished() || !HasFilterableColumns(module, message)) {
+      continue;
+    }
+
+    os << os.Indent() << "if (auto filter = client->" << message.Name() << "_"
+       << message.Arity() << "()) {\n";
+    os.PushIndent();
+    for (ParsedParameter param : ParsedDeclaration(message).Parameters()) {
+      if (!IsFilterableType(module, param.Type())) {
+        continue;
+      }
+
+      auto vec = [&] (void) -> OutputStream & {
+        os << message.Name() << "_" << message.Arity() << "_" << param.Name();
+        return os;
+      };
+
+      os << os.Indent() << "if (auto values = filter->" << param.Name()
+         << "(); values && values->size()) {\n";
+      os.PushIndent();
+      os << os.Indent() << "has_filters = true;\n"
+         << os.Indent() << "for (flatbuffers::uoffset_t i = 0u; i < values->size(); ++i) {\n";
+      os.PushIndent();
+      os << os.Indent();
+      vec() << ".push_back(static_cast<" << TypeName(module, param.Type())
+            << ">(values->Get(i)));\n";
+      os.PopIndent();
+      os << os.Indent() << "}\n" << os.Indent() << "std::sort(";
+      vec() << ".begin(), ";
+      vec() << ".end());\n" << os.Indent();
+      vec() << ".erase(std::unique(";
+      vec() << ".begin(), ";
+      vec() << ".end()), ";
+      vec() << ".end());\n";
+      os.PopIndent();
+      os << os.Indent() << "}\n";
+    }
+    os.PopIndent();
+    os << os.Indent() << "}\n";  // filter
+  }
+
+  // Summarize the subscription into a key.
+  for (ParsedMessage message : messages) {
+    if (!message.IsPublished()) {
+      continue;
+    }
+    os << os.Indent() << "key.push_back(" << message.Name() << "_"
+       << message.Arity() << " ? '1' : '0');\n";
+    for (ParsedParameter param : ParsedDeclaration(message).Parameters()) {
+      if (IsFilterableType(module, param.Type())) {
+        os << os.Indent() << "AddToKey(key, " << message.Name() << "_"
+           << message.Arity() << "_" << param.Name() << ");\n";
+      }
+    }
+  }
+
+  os.PopIndent();
+  os << os.Indent() << "}";  // constructor
+
+  // Define one method per published message that checks if the client wants
+  // to receive a specific message.
+  for (ParsedMessage message : messages) {
+    if (!message.IsPublished()) {
+      continue;
+    }
+
+    ParsedDeclaration decl(message);
+    os << "\n\n"
+       << os.Indent() << "bool Wants_" << message.Name() << "_"
+       << message.Arity();
+
+    // NOTE(pag): Parameters of columns that can't be filtered are unnamed.
+    auto sep = "(";
+    for (auto param : decl.Parameters()) {
+      os << sep;
+      if (param.Type().IsReferentiallyTransparent(module, Language::kCxx)) {
+        os << TypeName(module, param.Type());
+      } else {
+        os << "const " << TypeName(module, param.Type()) << " &";
+      }
+      if (IsFilterableType(module, param.Type())) {
+        os << " " << param.Name();
+      }
+      sep = ", ";
+    }
+
+    os << ") const {\n";
+    os.PushIndent();
+    os << os.Indent() << "return " << message.Name() << "_" << message.Arity();
+    for (auto param : decl.Parameters()) {
+      if (IsFilterableType(module, param.Type())) {
+        os << " &&\n"
+           << os.Indent() << "       Accepts(" << message.Name() << "_"
+           << message.Arity() << "_" << param.Name() << ", " << param.Name()
+           << ")";
+      }
+    }
+    os << ";\n";
+    os.PopIndent();
+    os << os.Indent() << "}";
+  }
+
+  os.PopIndent();
+  os << "\n};\n\n";
+}
+
 // Define structures for holding the messages that need to be sent back to
 // clients.
+//
+// Outboxes hold at most `--outbox_capacity` updates, so that a stalled
+// subscriber can't make the server's memory grow without bound. What happens
+// when an outbox is full is decided by `--outbox_overflow`:
+//
+//    - `block`: The publisher waits for the subscriber to catch up. Other
+//      subscribers are sent the update first, but ingestion stalls until the
+//      lagging subscriber has room. Updates are never lost.
+//    - `drop_oldest`: The oldest queued updates are dropped, and the
+//      subscriber is sent a `resync` message before its next update, telling
+//      it that it has missed updates and should re-query any state it needs.
+//    - `disconnect`: The subscriber is disconnected with a
+//      `RESOURCE_EXHAUSTED` status.
 static void DefineOutboxes(OutputStream &os) {
-  os << "\n\nstruct Outbox {\n";
+  os << "\n\nenum class OutboxOverflowPolicy {\n";
+  os.PushIndent();
+  os << os.Indent() << "kBlock,\n"
+     << os.Indent() << "kDropOldest,\n"
+     << os.Indent() << "kDisconnect\n";
+  os.PopIndent();
+  os << "};\n\n"
+     << "static OutboxOverflowPolicy gOutboxOverflowPolicy = OutboxOverflowPolicy::kDropOldest;\n\n"
+     << "using DatalogClientMessagePtr = std::shared_ptr<flatbuffers::grpc::Message<DatalogClientMessage>>;\n\n"
+     << "struct Outbox {\n";
   os.PushIndent();
   os << os.Indent() << "Outbox **prev_next{nullptr};\n"
      << os.Indent() << "Outbox *next{nullptr};\n"
      << os.Indent() << "std::string name;\n"
+     << os.Indent() << "Subscription subscription;\n"
      << os.Indent() << "hyde::rt::Semaphore messages_sem;\n"
      << os.Indent() << "std::mutex messages_lock;\n"
-     << os.Indent() << "std::vector<std::shared_ptr<flatbuffers::grpc::Message<DatalogClientMessage>>> messages;\n\n"
-     << os.Indent() << "inline Outbox(void) {\n";
-  os.PushIndent();
-  os << os.Indent() << "messages.reserve(4u);\n";
-  os.PopIndent();
-  os << os.Indent() << "}\n";  // constructor.
+     << os.Indent() << "std::condition_variable messages_drained;\n"
+     << os.Indent() << "std::deque<DatalogClientMessagePtr> messages;\n\n"
+     << os.Indent() << "// Updates were dropped, and the subscriber must be told to resync.\n"
+     << os.Indent() << "bool needs_resync{false};\n\n"
+     << os.Indent() << "// The subscriber is gone, or is being disconnected.\n"
+     << os.Indent() << "bool is_closed{false};\n"
+     << os.Indent() << "bool overflowed{false};\n\n"
+     << os.Indent() << "// Number of publishers that are delivering to this outbox without holding\n"
+     << os.Indent() << "// `gOutboxesLock`. Guarded by `gOutboxesLock`.\n"
+     << os.Indent() << "unsigned num_pins{0u};\n\n"
+     << os.Indent() << "// Lag metrics. The number of updates that haven't yet been delivered\n"
+     << os.Indent() << "// to the subscriber is `num_enqueued - num_sent - num_dropped`.\n"
+     << os.Indent() << "uint64_t num_enqueued{0u};\n"
+     << os.Indent() << "uint64_t num_sent{0u};\n"
+     << os.Indent() << "uint64_t num_dropped{0u};\n"
+     << os.Indent() << "uint64_t max_queued{0u};\n";
   os.PopIndent();
   os << "};\n\n"
      << "static Outbox *gFirstOutbox{nullptr};\n"
-     << "static std::mutex gOutboxesLock;\n";
+     << "static std::mutex gOutboxesLock;\n"
+     << "static std::condition_variable gOutboxesUnpinned;\n\n"
+     << "// Serializes publishers, so that every subscriber sees updates in the same\n"
+     << "// order, even though they are delivered without holding `gOutboxesLock`.\n"
+     << "static std::mutex gPublishLock;\n\n";
+
+  // The resync marker is the same for everyone, so build it once.
+  os << "static const DatalogClientMessagePtr &ResyncMessage(void) {\n";
+  os.PushIndent();
+  os << os.Indent() << "static const auto message = [] (void) {\n";
+  os.PushIndent();
+  os << os.Indent() << "flatbuffers::grpc::MessageBuilder mb;\n"
+     << os.Indent() << "DatalogClientMessageBuilder builder(mb);\n"
+     << os.Indent() << "builder.add_resync(true);\n"
+     << os.Indent() << "mb.Finish(builder.Finish());\n"
+     << os.Indent() << "return std::make_shared<flatbuffers::grpc::Message<DatalogClientMessage>>(\n"
+     << os.Indent() << "    mb.ReleaseMessage<DatalogClientMessage>());\n";
+  os.PopIndent();
+  os << os.Indent() << "}();\n"
+     << os.Indent() << "return message;\n";
+  os.PopIndent();
+  os << "}\n\n";
+
+  // Would adding a message to an outbox make the publisher wait?
+  os << "static bool MustWaitToEnqueue(const Outbox &outbox) {\n";
+  os.PushIndent();
+  os << os.Indent() << "const size_t capacity = FLAGS_outbox_capacity;\n"
+     << os.Indent() << "return gOutboxOverflowPolicy == OutboxOverflowPolicy::kBlock &&\n"
+     << os.Indent() << "       !outbox.is_closed && capacity &&\n"
+     << os.Indent() << "       outbox.messages.size() >= capacity;\n";
+  os.PopIndent();
+  os << "}\n\n";
+
+  // Add `message` to an outbox, applying the overflow policy if the outbox is
+  // full. Returns `true` if the subscriber needs to be woken up.
+  os << "static bool EnqueueMessage(Outbox &outbox, std::unique_lock<std::mutex> &locker,\n"
+     << "                           DatalogClientMessagePtr message) {\n";
+  os.PushIndent();
+  os << os.Indent() << "if (outbox.is_closed) {\n";
+  os.PushIndent();
+  os << os.Indent() << "return false;\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n\n"
+     << os.Indent() << "const size_t capacity = FLAGS_outbox_capacity;\n"
+     << os.Indent() << "if (capacity && outbox.messages.size() >= capacity) {\n";
+  os.PushIndent();
+  os << os.Indent() << "switch (gOutboxOverflowPolicy) {\n";
+  os.PushIndent();
+  os << os.Indent() << "case OutboxOverflowPolicy::kBlock:\n";
+  os.PushIndent();
+  os << os.Indent() << "LOG(WARNING) << \"Waiting for lagging client '\" << outbox.name << \"' to catch up\";\n"
+     << os.Indent() << "outbox.messages_drained.wait(locker, [&] (void) {\n"
+     << os.Indent() << "  return outbox.is_closed || outbox.messages.size() < capacity;\n"
+     << os.Indent() << "});\n"
+     << os.Indent() << "if (outbox.is_closed) {\n";
+  os.PushIndent();
+  os << os.Indent() << "return false;\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n"
+     << os.Indent() << "break;\n";
+  os.PopIndent();
+  os << os.Indent() << "case OutboxOverflowPolicy::kDropOldest:\n";
+  os.PushIndent();
+  os << os.Indent() << "if (!outbox.needs_resync) {\n";
+  os.PushIndent();
+  os << os.Indent() << "LOG(WARNING) << \"Dropping updates to lagging client '\" << outbox.name << \"'\";\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n"
+     << os.Indent() << "outbox.messages.pop_front();\n"
+     << os.Indent() << "outbox.num_dropped += 1u;\n"
+     << os.Indent() << "outbox.needs_resync = true;\n"
+     << os.Indent() << "break;\n";
+  os.PopIndent();
+  os << os.Indent() << "case OutboxOverflowPolicy::kDisconnect:\n";
+  os.PushIndent();
+  os << os.Indent() << "LOG(WARNING) << \"Disconnecting lagging client '\" << outbox.name << \"'\";\n"
+     << os.Indent() << "outbox.num_dropped += outbox.messages.size();\n"
+     << os.Indent() << "outbox.messages.clear();\n"
+     << os.Indent() << "outbox.is_closed = true;\n"
+     << os.Indent() << "outbox.overflowed = true;\n"
+     << os.Indent() << "return true;\n";
+  os.PopIndent();
+  os.PopIndent();
+  os << os.Indent() << "}\n";  // switch
+  os.PopIndent();
+  os << os.Indent() << "}\n\n"  // if
+     << os.Indent() << "outbox.messages.push_back(std::move(message));\n"
+     << os.Indent() << "outbox.num_enqueued += 1u;\n"
+     << os.Indent() << "outbox.max_queued = std::max<uint64_t>(outbox.max_queued, outbox.messages.size());\n"
+     << os.Indent() << "return true;\n";
+  os.PopIndent();
+  os << "}\n";
 }
 
 // Declare a `Query_*` method on the service, which corresponds with a
@@ -79,7 +400,7 @@ static void DeclareQuery(ParsedQuery query, OutputStream &os, bool out_of_line)
        << query.Name() << "_" << query.Arity() << "> *response";
   } else {
     os << os.Indent() << "::grpc::ServerWriter<flatbuffers::grpc::Message<"
-       << query.Name() << "_" << query.Arity() << ">> *writer";
+       << "Chunk_" << query.Name() << "_" << query.Arity() << ">> *writer";
   }
 
   os << ")";
@@ -111,7 +432,14 @@ static void DeclareServiceMethods(const std::vector<ParsedQuery> &queries,
   os.PushIndent();
   os << os.Indent() << "::grpc::ServerContext *context,\n"
      << os.Indent() << "const flatbuffers::grpc::Message<Client> *request,\n"
-     << os.Indent() << "::grpc::ServerWriter<flatbuffers::grpc::Message<DatalogClientMessage>> *writer) final;\n";
+     << os.Indent() << "::grpc::ServerWriter<flatbuffers::grpc::Message<DatalogClientMessage>> *writer) final;\n\n";
+  os.PopIndent();
+
+  os << os.Indent() << "::grpc::Status Stats(\n";
+  os.PushIndent();
+  os << os.Indent() << "::grpc::ServerContext *context,\n"
+     << os.Indent() << "const flatbuffers::grpc::Message<Empty> *request,\n"
+     << os.Indent() << "flatbuffers::grpc::Message<DatalogStats> *response) final;\n";
   os.PopIndent();
 }
 
@@ -122,6 +450,43 @@ static void DefineQuery(ParsedModule module, ParsedQuery query,
      << os.Indent() << "if (auto params = request->GetRoot()) {\n";
   os.PushIndent();
 
+  auto has_free_params = false;
+  for (ParsedParameter param : decl.Parameters()) {
+    if (param.Binding() == ParameterBinding::kFree) {
+      has_free_params = true;
+    }
+  }
+
+  // If we're streaming results back to the client, then we collect a snapshot
+  // of the results while holding the database lock, and only write them to
+  // the client once the lock is released. That way, a slow client never holds
+  // up the database writer thread, nor do other queries.
+  //
+  // The snapshot is a list of chunks, each holding a vector of results, so
+  // that we pay for one gRPC write per chunk rather than per result. A chunk
+  // is cut once it has `--query_chunk_rows` results, or once it reaches
+  // `--query_chunk_bytes` bytes.
+  const auto is_streaming = has_free_params && !query.ReturnsAtMostOneResult();
+  if (is_streaming) {
+    os << os.Indent() << "std::vector<flatbuffers::grpc::Message<Chunk_"
+       << query.Name() << "_" << decl.Arity() << ">> chunks;\n"
+       << os.Indent() << "{\n";
+    os.PushIndent();
+    os << os.Indent() << "flatbuffers::grpc::MessageBuilder mb;\n"
+       << os.Indent() << "std::vector<flatbuffers::Offset<::" << ns_prefix
+       << query.Name() << "_" << decl.Arity() << ">> offsets;\n"
+       << os.Indent() << "const auto finish_chunk = [&] (void) {\n";
+    os.PushIndent();
+    os << os.Indent() << "mb.Finish(CreateChunk_" << query.Name() << "_"
+       << decl.Arity() << "(mb, mb.CreateVector(offsets)));\n"
+       << os.Indent() << "chunks.emplace_back(mb.ReleaseMessage<Chunk_"
+       << query.Name() << "_" << decl.Arity() << ">());\n"
+       << os.Indent() << "mb.Clear();\n"
+       << os.Indent() << "offsets.clear();\n";
+    os.PopIndent();
+    os << os.Indent() << "};\n";
+  }
+
   auto forcing_message = query.ForcingMessage();
   if (forcing_message) {
     os << os.Indent()
@@ -135,20 +500,21 @@ static void DefineQuery(ParsedModule module, ParsedQuery query,
      << "_" << decl.BindingPattern();
 
   auto sep = "(";
-  auto has_free_params = false;
   for (ParsedParameter param : decl.Parameters()) {
     if (param.Binding() == ParameterBinding::kBound) {
       os << sep << "::hyde::rt::FBCast<" << TypeName(module, param.Type())
          << ">::From(params->" << param.Name() << "())";
       sep = ", ";
-    } else if (param.Binding() == ParameterBinding::kFree) {
-      has_free_params = true;
     }
   }
 
   if (has_free_params) {
     os << sep;
-    sep = "[=, &status] (";
+    if (is_streaming) {
+      sep = "[=, &mb, &offsets, &finish_chunk] (";
+    } else {
+      sep = "[=, &status] (";
+    }
     for (ParsedParameter param : decl.Parameters()) {
       os << sep << "auto p" << param.Index();
       sep = ", ";
@@ -156,40 +522,41 @@ static void DefineQuery(ParsedModule module, ParsedQuery query,
     os << ") -> bool {\n";
     os.PushIndent();
 
-    os << os.Indent() << "flatbuffers::grpc::MessageBuilder mb;\n";
-
-    // TODO(pag): Eventually create flatbuffer offsets for non-trivial
-    //            types.
-
-    os << os.Indent() << "mb.Finish(::hyde::rt::CreateFB<::" << ns_prefix
-       << query.Name() << "_" << decl.Arity() << ">::Create(mb";
-
-    for (ParsedParameter param : decl.Parameters()) {
-      os << ", p" << param.Index();
-    }
-
-    os << "));\n"
-       << os.Indent() << "auto message = mb.ReleaseMessage<::" << ns_prefix
-       << query.Name() << "_" << decl.Arity() << ">();\n";
-
     // If there are free parameters, then we're doing server-to-client streaming
-    // using `writer`.
-    if (!query.ReturnsAtMostOneResult()) {
-      os << os.Indent() << "if (!writer->Write(message)) {\n";
+    // using `writer`, but only after we've released the lock.
+    if (is_streaming) {
+      os << os.Indent() << "offsets.emplace_back(::hyde::rt::CreateFB<::"
+         << ns_prefix << query.Name() << "_" << decl.Arity()
+         << ">::Create(mb";
+      for (ParsedParameter param : decl.Parameters()) {
+        os << ", p" << param.Index();
+      }
+      os << "));\n"
+         << os.Indent() << "if (offsets.size() >= FLAGS_query_chunk_rows ||\n"
+         << os.Indent() << "    mb.GetSize() >= FLAGS_query_chunk_bytes) {\n";
       os.PushIndent();
-      os << os.Indent() << "status = grpc::StatusCode::CANCELLED;\n"
-         << os.Indent() << "return false;\n";
+      os << os.Indent() << "finish_chunk();\n";
       os.PopIndent();
-      os << os.Indent() << "} else {\n";
-      os.PushIndent();
-      os << os.Indent() << "status = grpc::StatusCode::OK;\n"
+      os << os.Indent() << "}\n"
          << os.Indent() << "return true;\n";
-      os.PopIndent();
-      os << os.Indent() << "}\n";
 
     // We want to write back only our first found result.
     } else {
-      os << os.Indent() << "*response = std::move(message);\n";
+      os << os.Indent() << "flatbuffers::grpc::MessageBuilder mb;\n";
+
+      // TODO(pag): Eventually create flatbuffer offsets for non-trivial
+      //            types.
+
+      os << os.Indent() << "mb.Finish(::hyde::rt::CreateFB<::" << ns_prefix
+         << query.Name() << "_" << decl.Arity() << ">::Create(mb";
+
+      for (ParsedParameter param : decl.Parameters()) {
+        os << ", p" << param.Index();
+      }
+
+      os << "));\n";
+      os << os.Indent() << "*response = mb.ReleaseMessage<::" << ns_prefix
+         << query.Name() << "_" << decl.Arity() << ">();\n";
       os << os.Indent() << "status = grpc::StatusCode::OK;\n"
          << os.Indent() << "return false;\n";
     }
@@ -198,6 +565,14 @@ static void DefineQuery(ParsedModule module, ParsedQuery query,
     os << os.Indent() << "});\n"
        << os.Indent() << "(void) num_generated;\n";
 
+    if (is_streaming) {
+      os << os.Indent() << "if (!offsets.empty()) {\n";
+      os.PushIndent();
+      os << os.Indent() << "finish_chunk();\n";
+      os.PopIndent();
+      os << os.Indent() << "}\n";
+    }
+
   // If there are not any free parameters, then we're sending back a message
   // to the client using `response`.
   } else {
@@ -218,6 +593,24 @@ static void DefineQuery(ParsedModule module, ParsedQuery query,
     os << os.Indent() << "PublishMessages();\n";
   }
 
+  // Now that the lock is released, stream the snapshotted results back to
+  // the client.
+  if (is_streaming) {
+    os.PopIndent();
+    os << os.Indent() << "}\n"  // Lock scope.
+       << os.Indent() << "for (const auto &chunk : chunks) {\n";
+    os.PushIndent();
+    os << os.Indent() << "if (!writer->Write(chunk)) {\n";
+    os.PushIndent();
+    os << os.Indent() << "status = grpc::StatusCode::CANCELLED;\n"
+       << os.Indent() << "break;\n";
+    os.PopIndent();
+    os << os.Indent() << "}\n"
+       << os.Indent() << "status = grpc::StatusCode::OK;\n";
+    os.PopIndent();
+    os << os.Indent() << "}\n";  // for
+  }
+
   os.PopIndent();
   os << os.Indent() << "}\n\n"  // GetRoot
      << os.Indent() << "return grpc::Status(status, kQuery_"
@@ -279,10 +672,11 @@ static void DefineSubscribeMethod(const std::vector<ParsedMessage> &messages,
   os.PushIndent();
   os << os.Indent() << "outbox.name = client_name->str();\n";
   os.PopIndent();
-  os << os.Indent() << "}\n\n"
-     << os.Indent() << "LOG(INFO) << \"Client '\" << outbox.name << \"' connected\";\n"
-     << os.Indent() << "alignas(64) std::vector<std::shared_ptr<flatbuffers::grpc::Message<DatalogClientMessage>>> messages;\n"
-     << os.Indent() << "messages.reserve(4u);\n\n"
+  os << os.Indent() << "}\n"
+     << os.Indent() << "outbox.subscription = Subscription(client);\n\n"
+     << os.Indent() << "LOG(INFO) << \"Client '\" << outbox.name << \"' connected\"\n"
+     << os.Indent() << "          << (outbox.subscription.has_filters ? \" with filters\" : \"\");\n"
+     << os.Indent() << "alignas(64) std::deque<DatalogClientMessagePtr> messages;\n\n"
      << os.Indent() << "{\n";
   os.PushIndent();
   os << os.Indent() << "std::unique_lock<std::mutex> locker(gOutboxesLock);\n"
@@ -298,14 +692,32 @@ static void DefineSubscribeMethod(const std::vector<ParsedMessage> &messages,
   os << os.Indent() << "}\n\n";  // Link it in.
 
   // Busy loop.
-  os << os.Indent() << "for (auto failed = false; !failed; ) {\n";
+  os << os.Indent() << "for (;;) {\n";
   os.PushIndent();
-  os << os.Indent() << "if (outbox.messages_sem.Wait()) {\n";
+  os << os.Indent() << "auto needs_resync = false;\n"
+     << os.Indent() << "auto is_closed = false;\n"
+     << os.Indent() << "if (outbox.messages_sem.Wait()) {\n";
   os.PushIndent();
   os << os.Indent() << "std::unique_lock<std::mutex> locker(outbox.messages_lock);\n"
-     << os.Indent() << "messages.swap(outbox.messages);\n";
+     << os.Indent() << "messages.swap(outbox.messages);\n"
+     << os.Indent() << "needs_resync = outbox.needs_resync;\n"
+     << os.Indent() << "outbox.needs_resync = false;\n"
+     << os.Indent() << "is_closed = outbox.is_closed;\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n"  // wait
+     << os.Indent() << "outbox.messages_drained.notify_all();\n\n"
+     << os.Indent() << "if (is_closed) {\n";
+  os.PushIndent();
+  os << os.Indent() << "break;\n";
   os.PopIndent();
-  os << os.Indent() << "}\n\n"  // wait
+  os << os.Indent() << "}\n\n"
+
+  // Tell the client that it has missed some updates.
+     << os.Indent() << "if (needs_resync && !writer->Write(*ResyncMessage(), options)) {\n";
+  os.PushIndent();
+  os << os.Indent() << "break;\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n\n"
      << os.Indent() << "if (messages.empty()) {\n";
   os.PushIndent();
   os << os.Indent() << "continue;\n";
@@ -330,6 +742,10 @@ static void DefineSubscribeMethod(const std::vector<ParsedMessage> &messages,
   os << os.Indent() << "}\n\n"  // for
      << os.Indent() << "messages.clear();\n"
      << os.Indent() << "LOG(INFO) << \"Sent \" << num_sent << \"/\" << (num_sent+num_failed) << \" outputs to client '\" << outbox.name << \"'\";\n\n"
+     << os.Indent() << "{\n"
+     << os.Indent() << "  std::unique_lock<std::mutex> locker(outbox.messages_lock);\n"
+     << os.Indent() << "  outbox.num_sent += num_sent;\n"
+     << os.Indent() << "}\n\n"
      << os.Indent() << "if (num_failed) {\n";
   os.PushIndent();
   os << os.Indent() << "break;\n";
@@ -338,19 +754,35 @@ static void DefineSubscribeMethod(const std::vector<ParsedMessage> &messages,
   os.PopIndent();
   os << os.Indent() << "}\n\n";  // busy loop.
 
-  // Unlink the stack-allocated `outbox`.
+  // Wake up a publisher that might be waiting for this subscriber to catch
+  // up, then unlink the stack-allocated `outbox`.
   os << os.Indent() << "{\n";
   os.PushIndent();
+  os << os.Indent() << "std::unique_lock<std::mutex> locker(outbox.messages_lock);\n"
+     << os.Indent() << "outbox.is_closed = true;\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n"
+     << os.Indent() << "outbox.messages_drained.notify_all();\n\n"
+     << os.Indent() << "{\n";
+  os.PushIndent();
   os << os.Indent() << "std::unique_lock<std::mutex> locker(gOutboxesLock);\n"
      << os.Indent() << "if (outbox.next) {\n";
   os.PushIndent();
   os << os.Indent() << "outbox.next->prev_next = outbox.prev_next;\n";
   os.PopIndent();
   os << os.Indent() << "}\n"
-     << os.Indent() << "*(outbox.prev_next) = outbox.next;\n";
+     << os.Indent() << "*(outbox.prev_next) = outbox.next;\n"
+     << os.Indent() << "gOutboxesUnpinned.wait(locker, [&] (void) { return !outbox.num_pins; });\n";
   os.PopIndent();
   os << os.Indent() << "}\n"  // End of unlink.
-     << os.Indent() << "LOG(INFO) << \"Client '\" << outbox.name << \"' disconnected\";\n\n"
+     << os.Indent() << "LOG(INFO) << \"Client '\" << outbox.name << \"' disconnected after \"\n"
+     << os.Indent() << "          << outbox.num_sent << \" updates were sent, \" << outbox.num_dropped\n"
+     << os.Indent() << "          << \" were dropped, and at most \" << outbox.max_queued << \" were queued\";\n\n"
+     << os.Indent() << "if (outbox.overflowed) {\n";
+  os.PushIndent();
+  os << os.Indent() << "return grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED, \"Subscriber fell too far behind\");\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n"
      << os.Indent() << "return grpc::Status::OK;\n";
   os.PopIndent();
   os << "}";  // End of Subscribe.
@@ -443,9 +875,7 @@ static void DefinePublishMethod(ParsedModule module,
   os << os.Indent() << "if (auto size = input_msg->Size()) {\n";
   os.PushIndent();
   os << os.Indent() << "LOG(INFO) << \"Received \" << size << \" messages\";\n\n"
-     << os.Indent() << "std::unique_lock<std::mutex> locker(gInputMessagesLock);\n"
-     << os.Indent() << "gInputMessages.push_back(std::move(input_msg));\n"
-     << os.Indent() << "gInputMessagesSemaphore.Signal();\n";
+     << os.Indent() << "gInputMessages.Enqueue(std::move(input_msg));\n";
   os.PopIndent();
   os << os.Indent() << "}\n"
      << os.Indent() << "return grpc::Status::OK;\n";
@@ -454,10 +884,82 @@ static void DefinePublishMethod(ParsedModule module,
   os << os.Indent() << "}";
 }
 
+// Define the `Stats` method, which reports the live counters of the database,
+// of the database writer thread, and of each subscriber's outbox.
+//
+// NOTE(pag): The counters are maintained whether or not anyone asks for them,
+//            so this only has to pay for copying them out. We copy the
+//            database's counters while holding a shared lock, just like a
+//            query, so they are consistent with one another.
+static void DefineStatsMethod(OutputStream &os) {
+  os << "\n\n::grpc::Status DatalogService::Stats(\n";
+  os.PushIndent();
+  os << os.Indent() << "::grpc::ServerContext *context,\n"
+     << os.Indent() << "const flatbuffers::grpc::Message<Empty> *request,\n"
+     << os.Indent() << "flatbuffers::grpc::Message<DatalogStats> *response) {\n\n"
+     << os.Indent() << "flatbuffers::grpc::MessageBuilder mb;\n"
+     << os.Indent() << "std::vector<flatbuffers::Offset<TableStats>> tables;\n"
+     << os.Indent() << "std::vector<flatbuffers::Offset<ProcedureStats>> procedures;\n"
+     << os.Indent() << "std::vector<flatbuffers::Offset<FunctorCacheStats>> functor_caches;\n"
+     << os.Indent() << "std::vector<flatbuffers::Offset<SubscriberStats>> subscribers;\n"
+     << os.Indent() << "WriterStats writer_stats;\n"
+     << os.Indent() << "{\n";
+  os.PushIndent();
+  os << os.Indent() << "std::shared_lock<std::shared_mutex> locker(gDatabaseLock);\n"
+     << os.Indent() << "writer_stats = gWriterStats;\n"
+     << os.Indent() << "gDatabase->DumpTableStats([&] (unsigned id, const hyde::rt::TableStats &stats) {\n";
+  os.PushIndent();
+  os << os.Indent() << "tables.push_back(CreateTableStats(\n"
+     << os.Indent() << "    mb, id, stats.num_records, stats.num_inserts, stats.num_state_changes,\n"
+     << os.Indent() << "    stats.num_lookups, stats.num_bloom_filter_hits, stats.num_view_cache_hits,\n"
+     << os.Indent() << "    stats.num_view_cache_misses));\n";
+  os.PopIndent();
+  os << os.Indent() << "});\n"
+     << os.Indent() << "gDatabase->DumpProcedureStats([&] (const char *name, const hyde::rt::ProcedureStats &stats) {\n";
+  os.PushIndent();
+  os << os.Indent() << "procedures.push_back(CreateProcedureStats(\n"
+     << os.Indent() << "    mb, mb.CreateString(name), stats.num_calls, stats.num_nanoseconds));\n";
+  os.PopIndent();
+  os << os.Indent() << "});\n"
+     << os.Indent() << "gDatabase->DumpFunctorCacheStats([&] (const char *name, uint64_t num_hits, uint64_t num_misses) {\n";
+  os.PushIndent();
+  os << os.Indent() << "functor_caches.push_back(CreateFunctorCacheStats(\n"
+     << os.Indent() << "    mb, mb.CreateString(name), num_hits, num_misses));\n";
+  os.PopIndent();
+  os << os.Indent() << "});\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n"
+     << os.Indent() << "{\n";
+  os.PushIndent();
+  os << os.Indent() << "std::unique_lock<std::mutex> locker(gOutboxesLock);\n"
+     << os.Indent() << "for (auto outbox = gFirstOutbox; outbox; outbox = outbox->next) {\n";
+  os.PushIndent();
+  os << os.Indent() << "const auto name = mb.CreateString(outbox->name);\n"
+     << os.Indent() << "std::unique_lock<std::mutex> outbox_locker(outbox->messages_lock);\n"
+     << os.Indent() << "subscribers.push_back(CreateSubscriberStats(\n"
+     << os.Indent() << "    mb, name, outbox->messages.size(), outbox->max_queued,\n"
+     << os.Indent() << "    outbox->num_enqueued, outbox->num_sent, outbox->num_dropped));\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n\n"
+     << os.Indent() << "mb.Finish(CreateDatalogStats(\n"
+     << os.Indent() << "    mb, gInputMessages.SizeApprox(), writer_stats.num_batches,\n"
+     << os.Indent() << "    writer_stats.num_messages, writer_stats.num_nanoseconds,\n"
+     << os.Indent() << "    writer_stats.last_nanoseconds, writer_stats.max_nanoseconds,\n"
+     << os.Indent() << "    mb.CreateVector(tables), mb.CreateVector(procedures),\n"
+     << os.Indent() << "    mb.CreateVector(functor_caches), mb.CreateVector(subscribers)));\n"
+     << os.Indent() << "*response = mb.ReleaseMessage<DatalogStats>();\n"
+     << os.Indent() << "return grpc::Status::OK;\n";
+  os.PopIndent();
+  os << os.Indent() << "}";
+}
+
 // Define the `Build` method of the `PublishedMessageBuilder` class, which
-// goes and packages up all messages into flatbuffer vectors and into
-// added/removed messages. Normally, the offsets to the messages-to-be-published
-// are held in `std::vector`s.
+// goes and packages up the published messages wanted by a subscription into
+// flatbuffer vectors and into added/removed messages. The messages to be
+// published are held as tuples in `std::vector`s, so that we can build
+// differently filtered outputs from them.
 static void DefineDatabaseLogBuild(const std::vector<ParsedMessage> &messages,
                                    OutputStream &os) {
   auto has_added = false;
@@ -472,42 +974,70 @@ static void DefineDatabaseLogBuild(const std::vector<ParsedMessage> &messages,
     }
   }
 
-  os << os.Indent() << "flatbuffers::grpc::Message<DatalogClientMessage> Build(void) {\n";
+  os << os.Indent() << "std::shared_ptr<flatbuffers::grpc::Message<DatalogClientMessage>> Build(\n";
   os.PushIndent();
+  os << os.Indent() << "const Subscription *sub) const {\n"
+     << os.Indent() << "flatbuffers::grpc::MessageBuilder mb;\n";
 
-  auto do_message = [&os] (ParsedMessage message, const char *suffix) {
+  auto do_message = [&os] (ParsedMessage message, const char *suffix,
+                           const char *has_var) {
+    ParsedDeclaration decl(message);
     os << os.Indent() << "flatbuffers::Offset<flatbuffers::Vector<flatbuffers::Offset<Message_"
        << message.Name() << "_" << message.Arity() << ">>> "
        << message.Name() << "_" << message.Arity() << suffix << "_offset;\n"
        << os.Indent() << "if (!" << message.Name() << "_"
        << message.Arity() << suffix << ".empty()) {\n";
     os.PushIndent();
-
-    os << os.Indent() << "" << message.Name() << "_"
-       << message.Arity() << suffix << "_offset = mb.CreateVector<Message_"
-       << message.Name() << "_" << message.Arity() << ">("
-       << message.Name() << "_" << message.Arity() << suffix << ".data(), "
-       << message.Name() << "_" << message.Arity() << suffix << ".size());\n"
-       << os.Indent() << message.Name() << "_"
-       << message.Arity() << suffix << ".clear();\n";
+    os << os.Indent() << "std::vector<flatbuffers::Offset<Message_"
+       << message.Name() << "_" << message.Arity() << ">> offsets;\n"
+       << os.Indent() << "for (const auto &entry : " << message.Name() << "_"
+       << message.Arity() << suffix << ") {\n";
+    os.PushIndent();
+    os << os.Indent() << "if (!sub || sub->Wants_" << message.Name() << "_"
+       << message.Arity();
+    auto sep = "(";
+    for (ParsedParameter param : decl.Parameters()) {
+      os << sep << "std::get<" << param.Index() << ">(entry)";
+      sep = ", ";
+    }
+    if (decl.Parameters().empty()) {
+      os << "(";
+    }
+    os << ")) {\n";
+    os.PushIndent();
+    os << os.Indent() << "offsets.emplace_back(::hyde::rt::CreateFB<Message_"
+       << message.Name() << "_" << message.Arity() << ">::Create(mb";
+    for (ParsedParameter param : decl.Parameters()) {
+      os << ", std::get<" << param.Index() << ">(entry)";
+    }
+    os << "));\n";
+    os.PopIndent();
+    os << os.Indent() << "}\n";  // if
+    os.PopIndent();
+    os << os.Indent() << "}\n"  // for
+       << os.Indent() << "if (!offsets.empty()) {\n";
+    os.PushIndent();
+    os << os.Indent() << has_var << " = true;\n"
+       << os.Indent() << message.Name() << "_" << message.Arity() << suffix
+       << "_offset = mb.CreateVector(offsets);\n";
+    os.PopIndent();
+    os << os.Indent() << "}\n";  // if
     os.PopIndent();
     os << os.Indent() << "}\n";
   };
 
   if (has_added) {
-    os << os.Indent() << "flatbuffers::Offset<AddedOutputMessage> added_offset;\n";
-    if (has_removed) {
-      os << os.Indent() << "flatbuffers::Offset<RemovedOutputMessage> removed_offset;\n";
-    }
-
-    os << os.Indent() << "if (has_added) {\n";
-    os.PushIndent();
+    os << os.Indent() << "auto has_added = false;\n"
+       << os.Indent() << "flatbuffers::Offset<AddedOutputMessage> added_offset;\n";
 
     for (ParsedMessage message : messages) {
       if (message.IsPublished()) {
-        do_message(message, "_added");
+        do_message(message, "_added", "has_added");
       }
     }
+
+    os << os.Indent() << "if (has_added) {\n";
+    os.PushIndent();
     os << os.Indent() << "added_offset = CreateAddedOutputMessage(mb";
     for (ParsedMessage message : messages) {
       if (message.IsPublished()) {
@@ -515,19 +1045,20 @@ static void DefineDatabaseLogBuild(const std::vector<ParsedMessage> &messages,
       }
     }
     os << ");\n";
-
     os.PopIndent();
     os << os.Indent() << "}\n";  // has_added
   }
 
   if (has_removed) {
-    os << os.Indent() << "if (has_removed) {\n";
-    os.PushIndent();
+    os << os.Indent() << "auto has_removed = false;\n"
+       << os.Indent() << "flatbuffers::Offset<RemovedOutputMessage> removed_offset;\n";
     for (ParsedMessage message : messages) {
       if (message.IsPublished() && message.IsDifferential()) {
-        do_message(message, "_removed");
+        do_message(message, "_removed", "has_removed");
       }
     }
+    os << os.Indent() << "if (has_removed) {\n";
+    os.PushIndent();
     os << os.Indent() << "removed_offset = CreateRemovedOutputMessage(mb";
     for (ParsedMessage message : messages) {
       if (message.IsPublished() && message.IsDifferential()) {
@@ -540,10 +1071,21 @@ static void DefineDatabaseLogBuild(const std::vector<ParsedMessage> &messages,
     os << os.Indent() << "}\n";  // has_removed
   }
 
-  os << os.Indent() << "has_added = false;\n";
+  // Don't bother sending anything to a client whose filters rejected all
+  // published messages.
+  os << os.Indent() << "if (sub";
+  if (has_added) {
+    os << " && !has_added";
+  }
   if (has_removed) {
-    os << os.Indent() << "has_removed = false;\n";
+    os << " && !has_removed";
   }
+  os << ") {\n";
+  os.PushIndent();
+  os << os.Indent() << "return {};\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n";
+
   os << os.Indent() << "mb.Finish(CreateDatalogClientMessage(mb";
   if (has_added) {
     os << ", added_offset";
@@ -552,26 +1094,25 @@ static void DefineDatabaseLogBuild(const std::vector<ParsedMessage> &messages,
     os << ", removed_offset";
   }
   os << "));\n"
-     << os.Indent() << "return mb.ReleaseMessage<DatalogClientMessage>();\n";
+     << os.Indent() << "return std::make_shared<flatbuffers::grpc::Message<DatalogClientMessage>>(\n"
+     << os.Indent() << "    mb.ReleaseMessage<DatalogClientMessage>());\n";
   os.PopIndent();
   os << os.Indent() << "}";
 }
 
 // Define the `PublishedMessageBuilder` class, which has one method per
 // published message. The role of this message builder is to accumulate
-// messages into a flatbuffer to be published to all connected clients.
+// messages to be published to all connected clients.
 static void DefineDatabaseLog(ParsedModule module,
                               const std::vector<ParsedMessage> &messages,
                               OutputStream &os) {
 
   os << "class PublishedMessageBuilder final : public grpc::GrpcLibraryCodegen {\n";
   os.PushIndent();
-  os << os.Indent() << "private:\n";
+  os << os.Indent() << "private:";
   os.PushIndent();
-  os << os.Indent() << "flatbuffers::grpc::MessageBuilder mb;";
 
-  // Create vectors for holding offsets.
-  bool has_differential = false;
+  // Create vectors for holding the tuples of published messages.
   for (ParsedMessage message : messages) {
     if (!message.IsPublished()) {
       continue;
@@ -579,44 +1120,66 @@ static void DefineDatabaseLog(ParsedModule module,
 
     auto declare_vec = [&] (const char *suffix) {
       os << "\n"
-         << os.Indent() << "std::vector<flatbuffers::Offset<Message_" << message.Name()
-         << "_" << message.Arity() << ">> " << message.Name() << "_"
-         << message.Arity() << suffix << ";";
+         << os.Indent() << "std::vector<std::tuple<";
+      auto sep = "";
+      for (auto param : ParsedDeclaration(message).Parameters()) {
+        os << sep << TypeName(module, param.Type());
+        sep = ", ";
+      }
+      os << ">> " << message.Name() << "_" << message.Arity() << suffix << ";";
     };
 
     declare_vec("_added");
 
     if (message.IsDifferential()) {
-      has_differential = true;
       declare_vec("_removed");
     }
   }
 
-  os << "\n" << os.Indent() << "bool has_added{false};";
-  if (has_differential) {
-    os << "\n" << os.Indent() << "bool has_removed{false};";
-  }
-
   os.PopIndent();  // private
   os << "\n\n"
      << os.Indent() << "public:";
   os.PushIndent();
 
-  // Define a function that builds up the flatbuffer message and clears out
-  // all other empty buffers.
   os << "\n\n"
      << os.Indent() << "inline bool HasAnyMessages(void) const noexcept {\n";
   os.PushIndent();
-  os << os.Indent() << "return has_added";
-  if (has_differential) {
-    os << " || has_removed";
+  os << os.Indent() << "return false";
+  for (ParsedMessage message : messages) {
+    if (message.IsPublished()) {
+      os << " ||\n" << os.Indent() << "       !" << message.Name() << "_"
+         << message.Arity() << "_added.empty()";
+      if (message.IsDifferential()) {
+        os << " ||\n" << os.Indent() << "       !" << message.Name() << "_"
+           << message.Arity() << "_removed.empty()";
+      }
+    }
   }
   os << ";\n";
   os.PopIndent();
   os << os.Indent() << "}\n\n";
 
+  // Define a function that builds up the flatbuffer message.
   DefineDatabaseLogBuild(messages, os);
 
+  // Define a function that clears out all published messages once they have
+  // been built for every subscriber.
+  os << "\n\n"
+     << os.Indent() << "void Clear(void) {\n";
+  os.PushIndent();
+  for (ParsedMessage message : messages) {
+    if (message.IsPublished()) {
+      os << os.Indent() << message.Name() << "_" << message.Arity()
+         << "_added.clear();\n";
+      if (message.IsDifferential()) {
+        os << os.Indent() << message.Name() << "_" << message.Arity()
+           << "_removed.clear();\n";
+      }
+    }
+  }
+  os.PopIndent();
+  os << os.Indent() << "}";
+
   // Define the message logging function for each message.
   for (ParsedMessage message : messages) {
     if (!message.IsPublished()) {
@@ -641,20 +1204,17 @@ static void DefineDatabaseLog(ParsedModule module,
 
     os << sep << "bool added) {\n";
     os.PushIndent();
-    os << os.Indent() << "auto offset = ::hyde::rt::CreateFB<Message_"
-       << message.Name() << "_" << message.Arity() << ">::Create(mb";
+    os << os.Indent() << "if (added) {\n";
+    os.PushIndent();
 
+    os << os.Indent() << message.Name() << "_" << message.Arity()
+       << "_added.emplace_back(";
+    sep = "";
     for (auto param : decl.Parameters()) {
-      os << ", " << param.Name();
+      os << sep << param.Name();
+      sep = ", ";
     }
-
-    os << ");\n"
-       << os.Indent() << "if (added) {\n";
-    os.PushIndent();
-
-    os << os.Indent() << "has_added = true;\n"
-       << os.Indent() << message.Name() << "_"
-       << message.Arity() << "_added.emplace_back(std::move(offset));\n";
+    os << ");\n";
 
     os.PopIndent();
     os << os.Indent() << "}";
@@ -662,9 +1222,14 @@ static void DefineDatabaseLog(ParsedModule module,
       os << " else {\n";
       os.PushIndent();
 
-      os << os.Indent() << "has_removed = true;\n"
-         << os.Indent() << message.Name() << "_"
-         << message.Arity() << "_removed.emplace_back(std::move(offset));\n";
+      os << os.Indent() << message.Name() << "_" << message.Arity()
+         << "_removed.emplace_back(";
+      sep = "";
+      for (auto param : decl.Parameters()) {
+        os << sep << param.Name();
+        sep = ", ";
+      }
+      os << ");\n";
 
       os.PopIndent();
       os << os.Indent() << "}\n";
@@ -686,19 +1251,100 @@ static void DefineDatabaseThread(const std::vector<ParsedMessage> &messages,
                                  OutputStream &os) {
 
   // Make a function to publish messages.
+  //
+  // NOTE(pag): Unfiltered subscribers share one output, and subscribers with
+  //            identical filters share one filtered output, so each distinct
+  //            output is built at most once.
+  //
+  // NOTE(pag): Outboxes are pinned while `gOutboxesLock` is held, and then
+  //            updates are delivered without it, so that a publisher waiting
+  //            on a lagging subscriber doesn't hold up new subscriptions or
+  //            `Stats`. Outboxes with room are delivered to first, so that
+  //            one lagging subscriber doesn't delay the others.
   os << "void PublishMessages(void) {\n";
   os.PushIndent();
-  os << os.Indent() << "auto output = std::make_shared<flatbuffers::grpc::Message<DatalogClientMessage>>(gDatabaseLog->Build());\n"
+  os << os.Indent() << "struct Delivery {\n"
+     << os.Indent() << "  Outbox *outbox;\n"
+     << os.Indent() << "  DatalogClientMessagePtr message;\n"
+     << os.Indent() << "};\n\n"
+     << os.Indent() << "std::unique_lock<std::mutex> publish_locker(gPublishLock);\n"
+     << os.Indent() << "std::vector<Delivery> deliveries;\n"
+     << os.Indent() << "{\n";
+  os.PushIndent();
+  os << os.Indent() << "DatalogClientMessagePtr output;\n"
+     << os.Indent() << "std::unordered_map<std::string, DatalogClientMessagePtr> filtered_outputs;\n"
      << os.Indent() << "std::unique_lock<std::mutex> locker(gOutboxesLock);\n"
-     << os.Indent() << "for (auto outbox = gFirstOutbox; outbox;) {\n";
+     << os.Indent() << "for (auto outbox = gFirstOutbox; outbox; outbox = outbox->next) {\n";
+  os.PushIndent();
+  os << os.Indent() << "DatalogClientMessagePtr outbox_output;\n"
+     << os.Indent() << "if (!outbox->subscription.has_filters) {\n";
+  os.PushIndent();
+  os << os.Indent() << "if (!output) {\n";
+  os.PushIndent();
+  os << os.Indent() << "output = gDatabaseLog->Build(nullptr);\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n"
+     << os.Indent() << "outbox_output = output;\n";
+  os.PopIndent();
+  os << os.Indent() << "} else {\n";
+  os.PushIndent();
+  os << os.Indent() << "auto [it, is_new] = filtered_outputs.try_emplace(outbox->subscription.key);\n"
+     << os.Indent() << "if (is_new) {\n";
+  os.PushIndent();
+  os << os.Indent() << "it->second = gDatabaseLog->Build(&(outbox->subscription));\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n"
+     << os.Indent() << "outbox_output = it->second;\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n\n"
+     << os.Indent() << "if (outbox_output) {\n";
   os.PushIndent();
-  os << os.Indent() << "LOG(INFO) << \"Sending updates to client subscriber '\" << outbox->name << \"'\";\n\n"  // if
+  os << os.Indent() << "outbox->num_pins += 1u;\n"
+     << os.Indent() << "deliveries.push_back({outbox, std::move(outbox_output)});\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n"  // for
+     << os.Indent() << "gDatabaseLog->Clear();\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n\n"  // Lock scope.
+     << os.Indent() << "for (auto must_wait : {false, true}) {\n";
+  os.PushIndent();
+  os << os.Indent() << "for (auto &delivery : deliveries) {\n";
+  os.PushIndent();
+  os << os.Indent() << "if (!delivery.message) {\n";
+  os.PushIndent();
+  os << os.Indent() << "continue;\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n"
+     << os.Indent() << "Outbox *outbox = delivery.outbox;\n"
      << os.Indent() << "std::unique_lock<std::mutex> outbox_locker(outbox->messages_lock);\n"
-     << os.Indent() << "outbox->messages.push_back(output);\n"
-     << os.Indent() << "outbox->messages_sem.Signal();\n"
-     << os.Indent() << "outbox = outbox->next;\n";
+     << os.Indent() << "if (!must_wait && MustWaitToEnqueue(*outbox)) {\n";
+  os.PushIndent();
+  os << os.Indent() << "continue;\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n\n"
+     << os.Indent() << "LOG(INFO) << \"Sending updates to client subscriber '\" << outbox->name << \"'\";\n"
+     << os.Indent() << "if (EnqueueMessage(*outbox, outbox_locker, std::move(delivery.message))) {\n"
+     << os.Indent() << "  outbox->messages_sem.Signal();\n"
+     << os.Indent() << "}\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n";  // for deliveries
+  os.PopIndent();
+  os << os.Indent() << "}\n\n"  // for must_wait
+     << os.Indent() << "if (!deliveries.empty()) {\n";
+  os.PushIndent();
+  os << os.Indent() << "{\n";
+  os.PushIndent();
+  os << os.Indent() << "std::unique_lock<std::mutex> locker(gOutboxesLock);\n"
+     << os.Indent() << "for (const auto &delivery : deliveries) {\n"
+     << os.Indent() << "  delivery.outbox->num_pins -= 1u;\n"
+     << os.Indent() << "}\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n"
+     << os.Indent() << "gOutboxesUnpinned.notify_all();\n";
   os.PopIndent();
-  os << os.Indent() << "}\n";  // for
+  os << os.Indent() << "}\n";
   os.PopIndent();
   os << "}\n\n";
 
@@ -706,29 +1352,55 @@ static void DefineDatabaseThread(const std::vector<ParsedMessage> &messages,
   os << "static void *DatabaseWriterThread(void *) {\n";
   os.PushIndent();
   os << os.Indent() << "std::vector<std::unique_ptr<DatabaseInputMessageType>> inputs;\n"
-     << os.Indent() << "inputs.reserve(128);\n"
+     << os.Indent() << "inputs.reserve(FLAGS_max_inputs_per_batch);\n"
      << os.Indent() << "while (true) {\n";
   os.PushIndent();
-  os << os.Indent() << "if (gInputMessagesSemaphore.Wait()) {\n";
-  os.PushIndent();
-  os << os.Indent() << "std::unique_lock<std::mutex> locker(gInputMessagesLock);\n"
-     << os.Indent() << "inputs.swap(gInputMessages);\n";
-  os.PopIndent();
-  os << os.Indent() << "}\n"  // wait
-     << os.Indent() << "if (inputs.empty()) {\n";
+  os << os.Indent() << "if (!gInputMessages.WaitDequeueBulk(inputs, FLAGS_max_inputs_per_batch)) {\n";
   os.PushIndent();
   os << os.Indent() << "continue;\n";
   os.PopIndent();
   os << os.Indent() << "}\n\n"
+
+  // Coalesce runs of input messages into as few messages as possible, so that
+  // we apply them to the database in bulk.
+  //
+  // NOTE(pag): We hold `gDatabaseLock` exclusively until the whole batch is
+  //            applied, so queries wait for up to `--max_inputs_per_batch`
+  //            publishes. This is intended: a query never observes a partly
+  //            applied batch, and the flag trades query latency against
+  //            ingestion throughput.
      << os.Indent() << "uint64_t total_num_applied = 0u;\n"
+     << os.Indent() << "std::unique_lock<std::shared_mutex> locker(gDatabaseLock);\n"
+     << os.Indent() << "const auto apply_start = std::chrono::steady_clock::now();\n"
+     << os.Indent() << "DatabaseInputMessageType *pending = nullptr;\n"
      << os.Indent() << "for (const auto &input : inputs) {\n";
   os.PushIndent();
   os << os.Indent() << "total_num_applied += input->Size();\n"
-     << os.Indent() << "LOG(INFO) << \"Applying \" << input->Size() << \" messages to the database\";\n\n"
-     << os.Indent() << "std::unique_lock<std::shared_mutex> locker(gDatabaseLock);\n"
-     << os.Indent() << "input->Apply(*gDatabase);\n";
+     << os.Indent() << "if (pending && pending->Merge(*input)) {\n";
+  os.PushIndent();
+  os << os.Indent() << "continue;\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n"
+     << os.Indent() << "if (pending) {\n";
+  os.PushIndent();
+  os << os.Indent() << "LOG(INFO) << \"Applying \" << pending->Size() << \" messages to the database\";\n"
+     << os.Indent() << "pending->Apply(*gDatabase);\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n"
+     << os.Indent() << "pending = input.get();\n";
   os.PopIndent();
   os << os.Indent() << "}\n"  // for
+     << os.Indent() << "LOG(INFO) << \"Applying \" << pending->Size() << \" messages to the database\";\n"
+     << os.Indent() << "pending->Apply(*gDatabase);\n"
+     << os.Indent() << "const uint64_t apply_ns = static_cast<uint64_t>(\n"
+     << os.Indent() << "    std::chrono::duration_cast<std::chrono::nanoseconds>(\n"
+     << os.Indent() << "        std::chrono::steady_clock::now() - apply_start).count());\n"
+     << os.Indent() << "gWriterStats.num_batches += 1u;\n"
+     << os.Indent() << "gWriterStats.num_messages += total_num_applied;\n"
+     << os.Indent() << "gWriterStats.num_nanoseconds += apply_ns;\n"
+     << os.Indent() << "gWriterStats.last_nanoseconds = apply_ns;\n"
+     << os.Indent() << "gWriterStats.max_nanoseconds = std::max(gWriterStats.max_nanoseconds, apply_ns);\n"
+     << os.Indent() << "locker.unlock();\n"
      << os.Indent() << "inputs.clear();\n"
      << os.Indent() << "LOG(INFO) << \"Applied \" << total_num_applied << \" messages to the database\";\n\n"
      << os.Indent() << "PublishMessages();\n";
@@ -746,9 +1418,12 @@ static void DefineDatabaseThread(const std::vector<ParsedMessage> &messages,
 void GenerateServerCode(const Program &program, OutputStream &os) {
   os << "/* Auto-generated file */\n\n"
      << "#include <algorithm>\n"
+     << "#include <chrono>\n"
+     << "#include <condition_variable>\n"
      << "#include <cstdlib>\n"
      << "#include <cstdio>\n"
      << "#include <cstring>\n"
+     << "#include <deque>\n"
      << "#include <iostream>\n"
      << "#include <memory>\n"
      << "#include <mutex>\n"
@@ -757,6 +1432,8 @@ void GenerateServerCode(const Program &program, OutputStream &os) {
      << "#include <sstream>\n"
      << "#include <string>\n"
      << "#include <thread>\n"
+     << "#include <tuple>\n"
+     << "#include <unordered_map>\n"
      << "#include <vector>\n\n"
      << "#define DRLOJEKYLL_SERVER_CODE\n\n"
      << "#include <drlojekyll/Runtime/FlatBuffers.h>\n"
@@ -776,7 +1453,8 @@ void GenerateServerCode(const Program &program, OutputStream &os) {
   }
 
   // Include auto-generated files.
-  os << "#include <drlojekyll/Runtime/Semaphore.h>\n"
+  os << "#include <drlojekyll/Runtime/BlockingInputQueue.h>\n"
+     << "#include <drlojekyll/Runtime/Semaphore.h>\n"
      << "#include <grpcpp/grpcpp.h>\n"
      << "#include <grpcpp/impl/grpc_library.h>\n"
      << "#include <flatbuffers/flatbuffers.h>\n"
@@ -800,6 +1478,16 @@ void GenerateServerCode(const Program &program, OutputStream &os) {
     os << "DEFINE_string(host, \"localhost\", \"Hostname of this server\");\n"
        << "DEFINE_uint32(port, 50051, \"Port of this server\");\n\n";
   }
+  os << "DEFINE_string(compression, \"none\", \"Default compression of messages sent to clients: none, deflate, gzip, or stream_gzip\");\n"
+     << "DEFINE_string(compression_level, \"none\", \"Default compression level of messages sent to clients: none, low, medium, or high. A level other than none lets gRPC pick an algorithm accepted by each client\");\n\n";
+
+  os << "DEFINE_uint32(outbox_capacity, 1024, \"Maximum number of updates queued for each subscriber, or zero for no maximum\");\n"
+     << "DEFINE_string(outbox_overflow, \"drop_oldest\", \"What to do when a subscriber's queue of updates is full: block, drop_oldest, or disconnect\");\n\n";
+
+  os << "DEFINE_uint32(max_inputs_per_batch, 128, \"Maximum number of published messages that are coalesced and applied to the database at once. Queries wait for a whole batch to be applied, so smaller batches lower query latency, and larger batches raise throughput\");\n\n";
+
+  os << "DEFINE_uint32(query_chunk_rows, 1024, \"Maximum number of results in each chunk streamed back by a query\");\n"
+     << "DEFINE_uint64(query_chunk_bytes, 1048576, \"Approximate maximum size, in bytes, of each chunk streamed back by a query\");\n\n";
   auto queries = Queries(module);
   auto messages = Messages(module);
 
@@ -812,6 +1500,7 @@ void GenerateServerCode(const Program &program, OutputStream &os) {
     }
   }
 
+  DefineSubscription(module, messages, os);
   DefineDatabaseLog(module, messages, os);
 
   // Define the main gRPC service class, and declare each of its methods.
@@ -830,13 +1519,21 @@ void GenerateServerCode(const Program &program, OutputStream &os) {
      << "using DatabaseStorageType = hyde::rt::StdStorage;\n"
      << "using DatabaseInputMessageType = DatabaseInputMessage<DatabaseStorageType>;\n"
      << "[[gnu::used]] static grpc::internal::GrpcLibraryInitializer gInitializer;\n"
-     << "static std::vector<std::unique_ptr<DatabaseInputMessageType>> gInputMessages;\n"
-     << "static std::mutex gInputMessagesLock;\n"
-     << "static hyde::rt::Semaphore gInputMessagesSemaphore;\n"
+     << "static hyde::rt::BlockingInputQueue<DatabaseInputMessageType> gInputMessages;\n"
      << "static PublishedMessageBuilder *gDatabaseLog = nullptr;\n"
      << "static DatabaseStorageType *gStorage = nullptr;\n"
      << "static std::shared_mutex gDatabaseLock;\n"
      << "static Database<DatabaseStorageType, PublishedMessageBuilder> *gDatabase = nullptr;\n\n"
+     << "// Statistics about applying batches of messages to the database. These are\n"
+     << "// guarded by `gDatabaseLock`.\n"
+     << "struct WriterStats {\n"
+     << "  uint64_t num_batches{0u};\n"
+     << "  uint64_t num_messages{0u};\n"
+     << "  uint64_t num_nanoseconds{0u};\n"
+     << "  uint64_t last_nanoseconds{0u};\n"
+     << "  uint64_t max_nanoseconds{0u};\n"
+     << "};\n\n"
+     << "static WriterStats gWriterStats;\n\n"
      << "static void PublishMessages(void);\n";
 
   // Define the query methods out-of-line.
@@ -844,6 +1541,7 @@ void GenerateServerCode(const Program &program, OutputStream &os) {
   DefineOutboxes(os);
   DefinePublishMethod(module, messages, os);
   DefineSubscribeMethod(messages, os);
+  DefineStatsMethod(os);
 
   os << "\n\n";
 
@@ -877,13 +1575,73 @@ void GenerateServerCode(const Program &program, OutputStream &os) {
   os << os.Indent() << "google::ParseCommandLineFlags(&argc, &argv, false);\n"
      << os.Indent() << "google::InitGoogleLogging(argv[0]);\n\n";
 
+  // Figure out what to do with subscribers that fall behind.
+  os << os.Indent() << "if (FLAGS_outbox_overflow == \"block\") {\n";
+  os.PushIndent();
+  os << os.Indent() << ns_name_prefix << "gOutboxOverflowPolicy = "
+     << ns_name_prefix << "OutboxOverflowPolicy::kBlock;\n";
+  os.PopIndent();
+  os << os.Indent() << "} else if (FLAGS_outbox_overflow == \"disconnect\") {\n";
+  os.PushIndent();
+  os << os.Indent() << ns_name_prefix << "gOutboxOverflowPolicy = "
+     << ns_name_prefix << "OutboxOverflowPolicy::kDisconnect;\n";
+  os.PopIndent();
+  os << os.Indent() << "} else if (FLAGS_outbox_overflow != \"drop_oldest\") {\n";
+  os.PushIndent();
+  os << os.Indent() << "LOG(FATAL) << \"Unsupported --outbox_overflow value '\" << FLAGS_outbox_overflow << \"'\";\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n\n"
+     << os.Indent() << "if (!FLAGS_max_inputs_per_batch) {\n";
+  os.PushIndent();
+  os << os.Indent() << "LOG(FATAL) << \"--max_inputs_per_batch must be at least one\";\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n\n";
+
+  // Figure out how to compress messages sent back to clients. Gzip is
+  // expensive at high message rates, and often pointless on a loopback or
+  // fast network, so by default we don't compress.
+  os << os.Indent() << "auto compression = GRPC_COMPRESS_NONE;\n"
+     << os.Indent() << "if (FLAGS_compression == \"deflate\") {\n";
+  os.PushIndent();
+  os << os.Indent() << "compression = GRPC_COMPRESS_DEFLATE;\n";
+  os.PopIndent();
+  os << os.Indent() << "} else if (FLAGS_compression == \"gzip\") {\n";
+  os.PushIndent();
+  os << os.Indent() << "compression = GRPC_COMPRESS_GZIP;\n";
+  os.PopIndent();
+  os << os.Indent() << "} else if (FLAGS_compression == \"stream_gzip\") {\n";
+  os.PushIndent();
+  os << os.Indent() << "compression = GRPC_COMPRESS_STREAM_GZIP;\n";
+  os.PopIndent();
+  os << os.Indent() << "} else if (FLAGS_compression != \"none\") {\n";
+  os.PushIndent();
+  os << os.Indent() << "LOG(FATAL) << \"Unsupported --compression value '\" << FLAGS_compression << \"'\";\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n\n"
+     << os.Indent() << "auto compression_level = GRPC_COMPRESS_LEVEL_NONE;\n"
+     << os.Indent() << "if (FLAGS_compression_level == \"low\") {\n";
+  os.PushIndent();
+  os << os.Indent() << "compression_level = GRPC_COMPRESS_LEVEL_LOW;\n";
+  os.PopIndent();
+  os << os.Indent() << "} else if (FLAGS_compression_level == \"medium\") {\n";
+  os.PushIndent();
+  os << os.Indent() << "compression_level = GRPC_COMPRESS_LEVEL_MED;\n";
+  os.PopIndent();
+  os << os.Indent() << "} else if (FLAGS_compression_level == \"high\") {\n";
+  os.PushIndent();
+  os << os.Indent() << "compression_level = GRPC_COMPRESS_LEVEL_HIGH;\n";
+  os.PopIndent();
+  os << os.Indent() << "} else if (FLAGS_compression_level != \"none\") {\n";
+  os.PushIndent();
+  os << os.Indent() << "LOG(FATAL) << \"Unsupported --compression_level value '\" << FLAGS_compression_level << \"'\";\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n\n";
+
   // Start by locking the database. We haven't actually constructed it, so this
   // is a way of making sure that nothing else tries to access it.
   os << os.Indent() << ns_name_prefix << "gDatabaseLock.lock();\n"
 
-  // Make some vectors reasonably big to avoid allocations at runtime, and start
-  // the database thread.
-     << os.Indent() << ns_name_prefix << "gInputMessages.reserve(128);\n"
+  // Start the database thread.
      << os.Indent() << "pthread_t db_thread;\n"
      << os.Indent() << "pthread_attr_t attr;\n"
      << os.Indent() << "pthread_attr_init(&attr);\n"
@@ -899,9 +1657,13 @@ void GenerateServerCode(const Program &program, OutputStream &os) {
      << os.Indent() << "grpc::ServerBuilder builder;\n"
      << os.Indent() << "builder.SetMaxReceiveMessageSize(std::numeric_limits<int>::max());\n"
      << os.Indent() << "builder.SetMaxSendMessageSize(std::numeric_limits<int>::max());\n"
+     << os.Indent() << "builder.SetCompressionAlgorithmSupportStatus(GRPC_COMPRESS_DEFLATE, true);\n"
      << os.Indent() << "builder.SetCompressionAlgorithmSupportStatus(GRPC_COMPRESS_GZIP, true);\n"
      << os.Indent() << "builder.SetCompressionAlgorithmSupportStatus(GRPC_COMPRESS_STREAM_GZIP, true);\n"
-     << os.Indent() << "builder.SetDefaultCompressionAlgorithm(GRPC_COMPRESS_GZIP);\n"
+     << os.Indent() << "builder.SetDefaultCompressionAlgorithm(compression);\n"
+     << os.Indent() << "if (compression_level != GRPC_COMPRESS_LEVEL_NONE) {\n"
+     << os.Indent() << "  builder.SetDefaultCompressionLevel(compression_level);\n"
+     << os.Indent() << "}\n"
      << os.Indent() << "builder.AddListeningPort(address_ss.str(), grpc::InsecureServerCredentials());\n"
      << os.Indent() << "builder.RegisterService(&service);\n"
 
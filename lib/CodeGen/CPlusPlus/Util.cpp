@@ -100,6 +100,32 @@ OutputStream &TypeName(OutputStream &os, ParsedModule module, TypeLoc type) {
   return os;
 }
 
+// Can subscribers filter published messages on the values of a column of
+// this type? Filter values are sent to the server as flatbuffer vectors, and
+// so only scalar and enumeration types are filterable.
+bool IsFilterableType(ParsedModule module, TypeLoc type) {
+  switch (type.UnderlyingKind()) {
+    case TypeKind::kInvalid:
+    case TypeKind::kBytes: return false;
+    case TypeKind::kForeignType:
+      if (auto ft = module.ForeignType(type); ft) {
+        return ft->IsEnum();
+      }
+      return false;
+    default: return true;
+  }
+}
+
+// Does this published message have any columns that subscribers can filter?
+bool HasFilterableColumns(ParsedModule module, ParsedMessage message) {
+  for (ParsedParameter param : ParsedDeclaration(message).Parameters()) {
+    if (IsFilterableType(module, param.Type())) {
+      return true;
+    }
+  }
+  return false;
+}
+
 const char *OperatorString(ComparisonOperator op) {
   switch (op) {
     case ComparisonOperator::kEqual: return "==";
@@ -43,6 +43,13 @@ inline static OutputStream &Functor(OutputStream &os,
   return os;
 }
 
+// The cache of results of a `@memoize`-attributed functor.
+inline static OutputStream &FunctorCache(OutputStream &os,
+                                         const ParsedFunctor func) {
+  return os << "functor_cache_" << func.Name() << '_'
+            << ParsedDeclaration(func).BindingPattern();
+}
+
 inline static OutputStream &Table(OutputStream &os, const DataTable table) {
   return os << "table_" << table.Id();
 }
@@ -63,6 +70,13 @@ std::string TypeName(ParsedModule module, TypeLoc kind);
 
 OutputStream &TypeName(OutputStream &os, ParsedModule module, TypeLoc type);
 
+// Can subscribers filter published messages on the values of a column of
+// this type?
+bool IsFilterableType(ParsedModule module, TypeLoc type);
+
+// Does this published message have any columns that subscribers can filter?
+bool HasFilterableColumns(ParsedModule module, ParsedMessage message);
+
 const char *OperatorString(ComparisonOperator op);
 
 std::string TypeValueOrDefault(ParsedModule module, TypeLoc loc,
@@ -280,9 +280,29 @@ static void DeclareMessages(ParsedModule module,
     }
     os.PopIndent();
   }
+
+  // Tells a subscriber that the server dropped updates that it couldn't keep
+  // up with, and so any state that it derived from its updates may be stale.
+  os.PushIndent();
+  os << os.Indent() << "resync:bool;\n";
+  os.PopIndent();
   os << os.Indent() << "}\n\n";
 }
 
+// Does this query stream its results back to the client? Queries with at
+// least one free parameter can produce many results.
+static bool IsStreamingQuery(ParsedQuery query) {
+  if (query.ReturnsAtMostOneResult()) {
+    return false;
+  }
+  for (ParsedParameter param : ParsedDeclaration(query).Parameters()) {
+    if (param.Binding() != ParameterBinding::kBound) {
+      return true;
+    }
+  }
+  return false;
+}
+
 static void DeclareQueries(ParsedModule module,
                            const std::vector<ParsedQuery> &queries,
                            OutputStream &os) {
@@ -309,6 +329,21 @@ static void DeclareQueries(ParsedModule module,
 
     os.PopIndent();
     os << os.Indent() << "}\n\n";
+
+    // Streaming queries send their results back in chunks, so that the
+    // per-message overhead of gRPC is amortized over many results.
+    for (ParsedDeclaration redecl : decl.Redeclarations()) {
+      if (IsStreamingQuery(ParsedQuery::From(redecl))) {
+        os << os.Indent() << "table Chunk_" << query.Name() << "_"
+           << query.Arity() << " {\n";
+        os.PushIndent();
+        os << os.Indent() << "results:[" << query.Name() << "_"
+           << query.Arity() << "];\n";
+        os.PopIndent();
+        os << os.Indent() << "}\n\n";
+        break;
+      }
+    }
   }
 
   for (ParsedQuery query : queries) {
@@ -333,21 +368,122 @@ static void DeclareQueries(ParsedModule module,
   }
 }
 
+// Declare the filters that subscribers can apply to published messages. Each
+// filterable column of a message gets a vector of accepted values; a missing
+// or empty vector accepts any value.
+static void DeclareFilters(ParsedModule module,
+                           const std::vector<ParsedMessage> &messages,
+                           OutputStream &os) {
+  for (ParsedMessage message : messages) {
+    if (!message.IsPublished() ||
+        !cxx::HasFilterableColumns(module, message)) {
+      continue;
+    }
+
+    os << os.Indent() << "table Filter_" << message.Name() << "_"
+       << message.Arity() << " {\n";
+    os.PushIndent();
+
+    for (ParsedParameter param : ParsedDeclaration(message).Parameters()) {
+      if (cxx::IsFilterableType(module, param.Type())) {
+        os << os.Indent() << param.Name() << ":[";
+        DeclareType(module, param.Type(), os);
+        os << "];\n";
+      }
+    }
+
+    os.PopIndent();
+    os << os.Indent() << "}\n\n";
+  }
+}
+
+// Declare the tables returned by the `Stats` RPC, which reports the live
+// counters of the server and of its database.
+static void DeclareStats(OutputStream &os) {
+  os << os.Indent() << "table TableStats {\n";
+  os.PushIndent();
+  os << os.Indent() << "id:uint;\n"
+     << os.Indent() << "num_records:ulong;\n"
+     << os.Indent() << "num_inserts:ulong;\n"
+     << os.Indent() << "num_state_changes:ulong;\n"
+     << os.Indent() << "num_lookups:ulong;\n"
+     << os.Indent() << "num_bloom_filter_hits:ulong;\n"
+     << os.Indent() << "num_view_cache_hits:ulong;\n"
+     << os.Indent() << "num_view_cache_misses:ulong;\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n\n"
+     << os.Indent() << "table ProcedureStats {\n";
+  os.PushIndent();
+  os << os.Indent() << "name:string;\n"
+     << os.Indent() << "num_calls:ulong;\n"
+     << os.Indent() << "num_nanoseconds:ulong;\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n\n"
+     << os.Indent() << "table FunctorCacheStats {\n";
+  os.PushIndent();
+  os << os.Indent() << "name:string;\n"
+     << os.Indent() << "num_hits:ulong;\n"
+     << os.Indent() << "num_misses:ulong;\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n\n"
+     << os.Indent() << "table SubscriberStats {\n";
+  os.PushIndent();
+  os << os.Indent() << "name:string;\n"
+     << os.Indent() << "num_queued:ulong;\n"
+     << os.Indent() << "max_queued:ulong;\n"
+     << os.Indent() << "num_enqueued:ulong;\n"
+     << os.Indent() << "num_sent:ulong;\n"
+     << os.Indent() << "num_dropped:ulong;\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n\n"
+     << os.Indent() << "table DatalogStats {\n";
+  os.PushIndent();
+  os << os.Indent() << "num_queued_inputs:ulong;\n"
+     << os.Indent() << "num_batches_applied:ulong;\n"
+     << os.Indent() << "num_messages_applied:ulong;\n"
+     << os.Indent() << "apply_nanoseconds:ulong;\n"
+     << os.Indent() << "last_apply_nanoseconds:ulong;\n"
+     << os.Indent() << "max_apply_nanoseconds:ulong;\n"
+     << os.Indent() << "tables:[TableStats];\n"
+     << os.Indent() << "procedures:[ProcedureStats];\n"
+     << os.Indent() << "functor_caches:[FunctorCacheStats];\n"
+     << os.Indent() << "subscribers:[SubscriberStats];\n";
+  os.PopIndent();
+  os << os.Indent() << "}\n\n";
+}
+
 static void DeclareService(Program program, ParsedModule module,
                            const std::vector<ParsedQuery> &queries,
+                           const std::vector<ParsedMessage> &messages,
                            const std::vector<ParsedInline> &inlines,
                            OutputStream &os) {
 
+  DeclareFilters(module, messages, os);
+
+  // A subscribing client names the published messages that it wants, e.g.
+  // `foo_2`, and optionally filters them. Naming no messages subscribes the
+  // client to all of them.
   os << os.Indent() << "table Client {\n";
   os.PushIndent();
 
-  os << os.Indent() << "name:string;\n";
+  os << os.Indent() << "name:string;\n"
+     << os.Indent() << "topics:[string];\n";
+
+  for (ParsedMessage message : messages) {
+    if (message.IsPublished() && cxx::HasFilterableColumns(module, message)) {
+      os << os.Indent() << message.Name() << "_" << message.Arity()
+         << ":Filter_" << message.Name() << "_" << message.Arity() << ";\n";
+    }
+  }
 
-  // Declare a service.
   os.PopIndent();
   os << os.Indent() << "}\n\n"
-     << os.Indent() << "table Empty {}\n\n"
-     << os.Indent() << "rpc_service Datalog {\n";
+     << os.Indent() << "table Empty {}\n\n";
+
+  DeclareStats(os);
+
+  // Declare a service.
+  os << os.Indent() << "rpc_service Datalog {\n";
   os.PushIndent();
 
   for (auto code : inlines) {
@@ -360,19 +496,13 @@ static void DeclareService(Program program, ParsedModule module,
     ParsedDeclaration decl(query);
     os << os.Indent() << "Query_" << query.Name() << "_"
        << decl.BindingPattern() << "(" << query.Name() << "_"
-       << decl.BindingPattern() << "):" << query.Name()
-       << "_" << decl.Arity();
+       << decl.BindingPattern() << "):";
 
-    auto all_bound = true;
-    for (ParsedParameter param : decl.Parameters()) {
-      if (param.Binding() != ParameterBinding::kBound) {
-        all_bound = false;
-        break;
-      }
-    }
-
-    if (!all_bound && !query.ReturnsAtMostOneResult()) {
-      os << " (streaming: \"server\")";
+    if (IsStreamingQuery(query)) {
+      os << "Chunk_" << query.Name() << "_" << decl.Arity()
+         << " (streaming: \"server\")";
+    } else {
+      os << query.Name() << "_" << decl.Arity();
     }
 
     os << ";\n";
@@ -380,7 +510,8 @@ static void DeclareService(Program program, ParsedModule module,
 
   // Apply an input message to the database, producing an output message.
   os << os.Indent() << "Publish(DatalogServerMessage):Empty;\n"
-     << os.Indent() << "Subscribe(Client):DatalogClientMessage (streaming: \"server\");\n";
+     << os.Indent() << "Subscribe(Client):DatalogClientMessage (streaming: \"server\");\n"
+     << os.Indent() << "Stats(Empty):DatalogStats;\n";
 
   for (auto code : inlines) {
     if (code.Stage() == "flat:interface:service:epilogue") {
@@ -467,7 +598,7 @@ void GenerateInterfaceCode(const Program &program, OutputStream &os) {
     }
   }
 
-  DeclareService(program, module, queries, inlines, os);
+  DeclareService(program, module, queries, messages, inlines, os);
 
   for (auto code : inlines) {
     if (code.Stage() == "flat:interface:epilogue:namespace") {
@@ -653,178 +653,24 @@ class PythonCodeGenVisitor final : public ProgramVisitor {
 
   void Visit(ProgramChangeTupleRegion region) override {
     os << Comment(os, region, "Program ChangeTuple Region");
+    VisitChange(region);
+  }
 
-    const auto tuple_vars = region.TupleVariables();
-
-    // Make sure to resolve to the correct reference of the foreign object.
-    ResolveReferences(tuple_vars);
-
-    std::stringstream tuple;
-    tuple << "tuple";
-    for (auto tuple_var : tuple_vars) {
-      tuple << "_" << tuple_var.Id();
-    }
-
-    auto tuple_prefix = "(";
-    auto tuple_suffix = ")";
-    if (tuple_vars.size() == 1u) {
-      tuple_prefix = "";
-      tuple_suffix = "";
-    }
-
-    auto sep = "";
-    auto tuple_var = tuple.str();
-    os << os.Indent() << tuple_var << " = " << tuple_prefix;
-    for (auto var : tuple_vars) {
-      os << sep << Var(os, var);
-      sep = ", ";
-    }
-    os << tuple_suffix << "\n"
-       << os.Indent() << "prev_state = " << Table(os, region.Table()) << "["
-       << tuple_var << "]\n"
-       << os.Indent() << "state = prev_state & " << kStateMask << "\n"
-       << os.Indent() << "present_bit = prev_state & " << kPresentBit << "\n";
-
-    os << os.Indent() << "if ";
-    switch (region.FromState()) {
-      case TupleState::kAbsent:
-        os << "state == " << kStateAbsent << ":\n";
-        break;
-      case TupleState::kPresent:
-        os << "state == " << kStatePresent << ":\n";
-        break;
-      case TupleState::kUnknown:
-        os << "state == " << kStateUnknown << ":\n";
-        break;
-      case TupleState::kAbsentOrUnknown:
-        os << "state == " << kStateAbsent << " or state == " << kStateUnknown
-           << ":\n";
-        break;
-    }
-    os.PushIndent();
-    os << os.Indent() << Table(os, region.Table()) << "[" << tuple_var
-       << "] = ";
-
-    switch (region.ToState()) {
-      case TupleState::kAbsent:
-        os << kStateAbsent << " | " << kPresentBit << "\n";
-        break;
-      case TupleState::kPresent:
-        os << kStatePresent << " | " << kPresentBit << "\n";
-        break;
-      case TupleState::kUnknown:
-        os << kStateUnknown << " | " << kPresentBit << "\n";
-        break;
-      case TupleState::kAbsentOrUnknown:
-        os << kStateUnknown << " | " << kPresentBit << "\n";
-        assert(false);  // Shouldn't be created.
-        break;
-    }
-
-    // If we're transitioning to present, then add it to our indices.
-    //
-    // NOTE(pag): The codegen for negations depends upon transitioning from
-    //            absent to unknown as a way of preventing race conditions.
-    const auto table = region.Table();
-    const auto indices = table.Indices();
-    if (region.ToState() == TupleState::kPresent ||
-        region.FromState() == TupleState::kAbsent) {
-      os << os.Indent() << "if not present_bit:\n";
-      os.PushIndent();
-
-      auto has_indices = false;
-      for (auto index : indices) {
-        const auto key_cols = index.KeyColumns();
-
-        auto key_prefix = "(";
-        auto key_suffix = ")";
-
-        if (key_cols.size() == 1u) {
-          key_prefix = "";
-          key_suffix = "";
-        }
-
-        has_indices = true;
-        os << os.Indent() << TableIndex(os, index);
-
-        os << "[" << key_prefix;
-        sep = "";
-        for (auto indexed_col : key_cols) {
-          os << sep << tuple_var;
-          if (1u < table.Columns().size()) {
-            os << "[" << indexed_col.Index() << "]";
-          }
-          sep = ", ";
-        }
-        os << key_suffix << "]";
-
-        os << ".append(" << tuple_var << ")\n";
-      }
-
-      if (!has_indices) {
-        os << os.Indent() << "pass\n";
-      }
-
-      os.PopIndent();
-    }
-
-    if (auto succeeded_body = region.BodyIfSucceeded(); succeeded_body) {
-      succeeded_body->Accept(*this);
-    } else {
-      os << os.Indent() << "pass\n";
-    }
-
-    os.PopIndent();
-
-    if (auto failed_body = region.BodyIfFailed(); failed_body) {
-      os << os.Indent() << "else:\n";
-      os.PushIndent();
-      failed_body->Accept(*this);
-      os.PopIndent();
-    }
+  void Visit(ProgramChangeRecordRegion region) override {
+    os << Comment(os, region, "Program ChangeRecord Region");
+    DefineRecordVariables(region.RecordVariables(), region.TupleVariables());
+    VisitChange(region);
   }
 
   void Visit(ProgramCheckTupleRegion region) override {
     os << Comment(os, region, "Program CheckTuple Region");
-    const auto table = region.Table();
-    const auto vars = region.TupleVariables();
-    os << os.Indent() << "state = " << Table(os, table) << "[";
-    if (vars.size() == 1u) {
-      os << Var(os, vars[0]);
-    } else {
-      auto sep = "(";
-      for (auto var : vars) {
-        os << sep << Var(os, var);
-        sep = ", ";
-      }
-      os << ')';
-    }
-    os << "] & " << kStateMask << '\n';
-
-    auto sep = "if ";
-
-    if (auto absent_body = region.IfAbsent(); absent_body) {
-      os << os.Indent() << sep << "state == " << kStateAbsent << ":\n";
-      os.PushIndent();
-      absent_body->Accept(*this);
-      os.PopIndent();
-      sep = "elif ";
-    }
-
-    if (auto present_body = region.IfPresent(); present_body) {
-      os << os.Indent() << sep << "state == " << kStatePresent << ":\n";
-      os.PushIndent();
-      present_body->Accept(*this);
-      os.PopIndent();
-      sep = "elif ";
-    }
+    VisitCheck(region);
+  }
 
-    if (auto unknown_body = region.IfUnknown(); unknown_body) {
-      os << os.Indent() << sep << "state == " << kStateUnknown << ":\n";
-      os.PushIndent();
-      unknown_body->Accept(*this);
-      os.PopIndent();
-    }
+  void Visit(ProgramCheckRecordRegion region) override {
+    os << Comment(os, region, "Program CheckRecord Region");
+    DefineRecordVariables(region.RecordVariables(), region.TupleVariables());
+    VisitCheck(region);
   }
 
   void Visit(ProgramTableJoinRegion region) override {
@@ -1206,6 +1052,222 @@ class PythonCodeGenVisitor final : public ProgramVisitor {
   }
 
  private:
+  // Define the variables of a record check or change. Python has no notion
+  // of a record separate from its tuple, so these are just copies of the
+  // tuple variables.
+  void DefineRecordVariables(DefinedNodeRange<DataVariable> record_vars,
+                             UsedNodeRange<DataVariable> tuple_vars) {
+    auto i = 0u;
+    for (auto var : record_vars) {
+      os << os.Indent() << Var(os, var) << ": " << TypeName(module, var.Type())
+         << " = " << Var(os, tuple_vars[i++]) << '\n';
+    }
+  }
+
+  // Shared by tuple and record state changes.
+  template <typename Region>
+  void VisitChange(Region region) {
+    const auto tuple_vars = region.TupleVariables();
+
+    // Make sure to resolve to the correct reference of the foreign object.
+    ResolveReferences(tuple_vars);
+
+    std::stringstream tuple;
+    tuple << "tuple";
+    for (auto tuple_var : tuple_vars) {
+      tuple << "_" << tuple_var.Id();
+    }
+
+    auto tuple_prefix = "(";
+    auto tuple_suffix = ")";
+    if (tuple_vars.size() == 1u) {
+      tuple_prefix = "";
+      tuple_suffix = "";
+    }
+
+    auto sep = "";
+    auto tuple_var = tuple.str();
+    os << os.Indent() << tuple_var << " = " << tuple_prefix;
+    for (auto var : tuple_vars) {
+      os << sep << Var(os, var);
+      sep = ", ";
+    }
+    os << tuple_suffix << "\n"
+       << os.Indent() << "prev_state = " << Table(os, region.Table()) << "["
+       << tuple_var << "]\n"
+       << os.Indent() << "state = prev_state & " << kStateMask << "\n"
+       << os.Indent() << "present_bit = prev_state & " << kPresentBit << "\n";
+
+    // Counted tables add or remove one derivation of the tuple, and only change
+    // its state on the first addition, or on the removal of the last one.
+    const auto table = region.Table();
+    const auto is_counted = table.IsCounted();
+    const auto adds_derivation =
+        is_counted && region.ToState() == TupleState::kPresent;
+    const auto removes_derivation =
+        is_counted && region.FromState() == TupleState::kPresent;
+
+    os << os.Indent() << "if ";
+    switch (region.FromState()) {
+      case TupleState::kAbsent:
+        os << "state == " << kStateAbsent << ":\n";
+        break;
+      case TupleState::kPresent:
+        os << "state == " << kStatePresent;
+        if (removes_derivation) {
+          os << " and prev_state < " << (2u * kCountUnit);
+        }
+        os << ":\n";
+        break;
+      case TupleState::kUnknown:
+        os << "state == " << kStateUnknown << ":\n";
+        break;
+      case TupleState::kAbsentOrUnknown:
+        os << "state == " << kStateAbsent << " or state == " << kStateUnknown
+           << ":\n";
+        break;
+    }
+    os.PushIndent();
+    os << os.Indent() << Table(os, region.Table()) << "[" << tuple_var
+       << "] = ";
+
+    switch (region.ToState()) {
+      case TupleState::kAbsent:
+        os << kStateAbsent << " | " << kPresentBit << "\n";
+        break;
+      case TupleState::kPresent:
+        os << kStatePresent << " | " << kPresentBit;
+        if (adds_derivation) {
+          os << " | " << kCountUnit;
+        }
+        os << "\n";
+        break;
+      case TupleState::kUnknown:
+        os << kStateUnknown << " | " << kPresentBit << "\n";
+        break;
+      case TupleState::kAbsentOrUnknown:
+        os << kStateUnknown << " | " << kPresentBit << "\n";
+        assert(false);  // Shouldn't be created.
+        break;
+    }
+
+    // If we're transitioning to present, then add it to our indices.
+    //
+    // NOTE(pag): The codegen for negations depends upon transitioning from
+    //            absent to unknown as a way of preventing race conditions.
+    const auto indices = table.Indices();
+    if (region.ToState() == TupleState::kPresent ||
+        region.FromState() == TupleState::kAbsent) {
+      os << os.Indent() << "if not present_bit:\n";
+      os.PushIndent();
+
+      auto has_indices = false;
+      for (auto index : indices) {
+        const auto key_cols = index.KeyColumns();
+
+        auto key_prefix = "(";
+        auto key_suffix = ")";
+
+        if (key_cols.size() == 1u) {
+          key_prefix = "";
+          key_suffix = "";
+        }
+
+        has_indices = true;
+        os << os.Indent() << TableIndex(os, index);
+
+        os << "[" << key_prefix;
+        sep = "";
+        for (auto indexed_col : key_cols) {
+          os << sep << tuple_var;
+          if (1u < table.Columns().size()) {
+            os << "[" << indexed_col.Index() << "]";
+          }
+          sep = ", ";
+        }
+        os << key_suffix << "]";
+
+        os << ".append(" << tuple_var << ")\n";
+      }
+
+      if (!has_indices) {
+        os << os.Indent() << "pass\n";
+      }
+
+      os.PopIndent();
+    }
+
+    if (auto succeeded_body = region.BodyIfSucceeded(); succeeded_body) {
+      succeeded_body->Accept(*this);
+    } else {
+      os << os.Indent() << "pass\n";
+    }
+
+    os.PopIndent();
+
+    const auto failed_body = region.BodyIfFailed();
+    if (adds_derivation || removes_derivation || failed_body) {
+      os << os.Indent() << "else:\n";
+      os.PushIndent();
+      if (adds_derivation || removes_derivation) {
+        os << os.Indent() << "if state == " << kStatePresent << ":\n";
+        os.PushIndent();
+        os << os.Indent() << Table(os, table) << "[" << tuple_var
+           << "] = prev_state " << (adds_derivation ? '+' : '-') << ' '
+           << kCountUnit << "\n";
+        os.PopIndent();
+      }
+      if (failed_body) {
+        failed_body->Accept(*this);
+      }
+      os.PopIndent();
+    }
+  }
+
+  // Shared by tuple and record state checks.
+  template <typename Region>
+  void VisitCheck(Region region) {
+    const auto table = region.Table();
+    const auto vars = region.TupleVariables();
+    os << os.Indent() << "state = " << Table(os, table) << "[";
+    if (vars.size() == 1u) {
+      os << Var(os, vars[0]);
+    } else {
+      auto sep = "(";
+      for (auto var : vars) {
+        os << sep << Var(os, var);
+        sep = ", ";
+      }
+      os << ')';
+    }
+    os << "] & " << kStateMask << '\n';
+
+    auto sep = "if ";
+
+    if (auto absent_body = region.IfAbsent(); absent_body) {
+      os << os.Indent() << sep << "state == " << kStateAbsent << ":\n";
+      os.PushIndent();
+      absent_body->Accept(*this);
+      os.PopIndent();
+      sep = "elif ";
+    }
+
+    if (auto present_body = region.IfPresent(); present_body) {
+      os << os.Indent() << sep << "state == " << kStatePresent << ":\n";
+      os.PushIndent();
+      present_body->Accept(*this);
+      os.PopIndent();
+      sep = "elif ";
+    }
+
+    if (auto unknown_body = region.IfUnknown(); unknown_body) {
+      os << os.Indent() << sep << "state == " << kStateUnknown << ":\n";
+      os.PushIndent();
+      unknown_body->Accept(*this);
+      os.PopIndent();
+    }
+  }
+
   OutputStream &os;
   const ParsedModule module;
 };
@@ -16,6 +16,21 @@
 namespace hyde {
 namespace python {
 
+// Does this query stream its results back to the client? This must agree with
+// the schema, which declares the streaming `Query_*` methods as returning
+// `Chunk_*` messages.
+static bool IsStreamingQuery(ParsedQuery query) {
+  if (query.ReturnsAtMostOneResult()) {
+    return false;
+  }
+  for (ParsedParameter param : ParsedDeclaration(query).Parameters()) {
+    if (param.Binding() != ParameterBinding::kBound) {
+      return true;
+    }
+  }
+  return false;
+}
+
 // Emits Python code for the given program to `os`.
 void GenerateInterfaceCode(const Program &program, OutputStream &os) {
   const auto module = program.ParsedModule();
@@ -60,7 +75,7 @@ void GenerateInterfaceCode(const Program &program, OutputStream &os) {
      << "from typing import Final, Iterator, List, Optional\n"
      << "from ." << file_name << "_grpc_fb import DatalogStub\n"
      << "from .InputMessage import InputMessageT as InputMessage\n"
-     << "from .OutputMessage import OutputMessageT as OutputMessage\n"
+     << "from .DatalogClientMessage import DatalogClientMessageT as DatalogClientMessage\n"
      << "from .Client import ClientT as Client\n"
      << "from .AddedInputMessage import AddedInputMessageT as AddedInputMessage\n";
 
@@ -94,6 +109,16 @@ void GenerateInterfaceCode(const Program &program, OutputStream &os) {
       os << "from ." << name << "_" << arity
          << " import " << name << "_" << arity
          << "T as " << name << "_" << arity << '\n';
+
+      // Streaming queries send their results back in chunks.
+      for (ParsedDeclaration redecl : decl.Redeclarations()) {
+        if (IsStreamingQuery(ParsedQuery::From(redecl))) {
+          os << "from .Chunk_" << name << "_" << arity
+             << " import Chunk_" << name << "_" << arity
+             << "T as Chunk_" << name << "_" << arity << '\n';
+          break;
+        }
+      }
     }
 
     auto bp = decl.BindingPattern();
@@ -199,6 +224,13 @@ void GenerateInterfaceCode(const Program &program, OutputStream &os) {
   os << os.Indent() << "pass\n\n";
   os.PopIndent();
 
+  // The server dropped updates that this subscriber couldn't keep up with, so
+  // any state derived from earlier updates may be stale.
+  os << os.Indent() << "def resync(self, db: 'Datalog') -> None:\n";
+  os.PushIndent();
+  os << os.Indent() << "pass\n\n";
+  os.PopIndent();
+
   if (has_outputs) {
     for (ParsedMessage message : messages) {
       if (!message.IsPublished()) {
@@ -226,8 +258,12 @@ void GenerateInterfaceCode(const Program &program, OutputStream &os) {
     }
   }
 
-  os << os.Indent() << "def consume(self, db: 'Datalog', output: OutputMessage):\n";
+  os << os.Indent() << "def consume(self, db: 'Datalog', output: DatalogClientMessage):\n";
+  os.PushIndent();
+  os << os.Indent() << "if output.resync:\n";
   os.PushIndent();
+  os << os.Indent() << "self.resync(db)\n";
+  os.PopIndent();
   os << os.Indent() << "self.begin(db)\n";
   if (has_outputs) {
     auto i = 0;
@@ -313,17 +349,15 @@ void GenerateInterfaceCode(const Program &program, OutputStream &os) {
     const auto bp = decl.BindingPattern();
     os << os.Indent() << "def " << name << '_' << bp << "(self";
 
-    auto has_free = false;
     for (ParsedParameter param : decl.Parameters()) {
       if (param.Binding() == ParameterBinding::kBound) {
         os << ", " << param.Name() << ": " << TypeName(module, param.Type());
-      } else {
-        has_free = true;
       }
     }
 
     os << ")";
-    if (has_free) {
+    const auto is_streaming = IsStreamingQuery(query);
+    if (is_streaming) {
       os << " -> Iterator[" << name << '_' << arity << "]:\n";
     } else {
       os << " -> Optional[" << name << '_' << arity << "]:\n";
@@ -341,16 +375,23 @@ void GenerateInterfaceCode(const Program &program, OutputStream &os) {
        << os.Indent() << "buff = bytes(message_builder.Output())\n"
        << os.Indent() << "resp = self._stub.Query_" << name << '_' << bp << "(buff)\n";
 
-    // It's a `_MultiThreadedRendezvous`.
-    if (has_free) {
+    // It's a `_MultiThreadedRendezvous` of chunks, each holding a vector of
+    // results. An empty chunk unpacks its `results` as `None`.
+    if (is_streaming) {
       os << os.Indent() << "for resp_buff in resp:\n";
       os.PushIndent();
-      os << os.Indent() << "yield " << name << '_' << arity << ".InitFromBuf(resp_buff, 0)\n";
+      os << os.Indent() << "chunk = Chunk_" << name << '_' << arity
+         << ".InitFromBuf(resp_buff, 0)\n"
+         << os.Indent() << "if chunk.results:\n";
+      os.PushIndent();
+      os << os.Indent() << "yield from chunk.results\n";
+      os.PopIndent();
       os.PopIndent();
 
       os << os.Indent() << "del resp\n\n";
     } else {
-
+      os << os.Indent() << "return " << name << '_' << arity
+         << ".InitFromBuf(resp, 0)\n";
     }
 
     os.PopIndent();
@@ -359,20 +400,16 @@ void GenerateInterfaceCode(const Program &program, OutputStream &os) {
 
   os << os.Indent() << "def consume(self, consumer: OutputMessageConsumer) -> None:\n";
   os.PushIndent();
-  os << os.Indent() << "message_builder = flatbuffer.Builder(0)\n"
+  os << os.Indent() << "message_builder = flatbuffers.Builder(0)\n"
      << os.Indent() << "message = Client()\n"
      << os.Indent() << "message.name = self._name\n"
      << os.Indent() << "offset = message.Pack(message_builder)\n"
      << os.Indent() << "message_builder.Finish(offset)\n"
      << os.Indent() << "buff = bytes(message_builder.Output())\n"
-     << os.Indent() << "while True:\n";
+     << os.Indent() << "for resp_buff in self._stub.Subscribe(buff):\n";
   os.PushIndent();
-  os << os.Indent() << "x = self._stub.Subscribe(buff)\n"
-     << os.Indent() << "print(x.__class__)\n"
-     << os.Indent() << "print(dir(x))\n"
-     << os.Indent() << "print(x)\n";
-
-  os.PopIndent();  // while
+  os << os.Indent() << "consumer.consume(self, DatalogClientMessage.InitFromBuf(resp_buff, 0))\n";
+  os.PopIndent();  // for
   os.PopIndent();  // consume
 
   os.PopIndent();  // class Datalog
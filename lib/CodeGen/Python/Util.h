@@ -21,6 +21,10 @@ static constexpr auto kStateUnknown = 2u;
 static constexpr auto kStateMask = 0x3u;
 static constexpr auto kPresentBit = 0x4u;
 
+// NOTE(pag): Counted tables store the number of derivations of each tuple in
+//            the bits above the present bit.
+static constexpr auto kCountUnit = 0x8u;
+
 // NOTE(ekilmer): Classes are named all the same for now.
 static constexpr auto gClassName = "Database";
 
@@ -1,9 +1,8 @@
 // Copyright 2020, Trail of Bits. All rights reserved.
 
 #include <algorithm>
-#include <fstream>
-#include <iostream>
 #include <map>
+#include <set>
 #include <sstream>
 
 #include "Program.h"
@@ -125,6 +124,12 @@ class AnalysisContext {
   void AnalyzeGlobalColumn(TABLE *table, unsigned table_col_index,
                            VAR *var, REGION *var_use, RowProvenance &row);
 
+  // Analyze `var`, which can be the source of the `table_col_index`th column
+  // of `table`, and where we can't see through the definition of `var`, e.g.
+  // because it is a parameter to a procedure.
+  void AnalyzeOpaqueColumn(TABLE *table, unsigned table_col_index,
+                           VAR *var, REGION *var_use, RowProvenance &row);
+
   // Analyze `var`, which can be the source of the `table_col_index`th column
   // of `table`, and is defined in `src`.
   void AnalyzeColumn(TABLE *table, unsigned table_col_index,
@@ -183,11 +188,13 @@ class AnalysisContext {
   // Unique and group the row provenance information.
   void UniqueAndGroupRowProvenance(void);
 
-  // Convert a `CHECKTUPLE` into a `CHECKRECORD`.
-  void ConvertToCheckRecord(ProgramImpl *impl, CHECKTUPLE *check);
+  // Convert a `CHECKTUPLE` into a `CHECKRECORD`. Returns `true` if the
+  // conversion happened.
+  bool ConvertToCheckRecord(ProgramImpl *impl, CHECKTUPLE *check);
 
-  // Convert a `CHANGETUPLE` into a `CHANGERECORD`.
-  void ConvertToChangeRecord(ProgramImpl *impl, CHANGETUPLE *change);
+  // Convert a `CHANGETUPLE` into a `CHANGERECORD`. Returns `true` if the
+  // conversion happened.
+  bool ConvertToChangeRecord(ProgramImpl *impl, CHANGETUPLE *change);
 
   // Convert uses of tuples from tables in the set to uses of records.
   bool ConvertTablesToRecords(ProgramImpl *impl,
@@ -208,8 +215,6 @@ class AnalysisContext {
 
   // Build up the record and record case data structures.
   void Build(ProgramImpl *impl);
-
-  void Dump(ProgramImpl *impl);
 };
 
 // Go find every transition state, and organize it by table, so that we can
@@ -272,33 +277,67 @@ void AnalysisContext::AnalyzeGlobalColumn(
   row.columns->emplace_back(std::move(provenance));
 }
 
+// Analyze `var`, which can be the source of the `table_col_index`th column
+// of `table`, and where we can't see through the definition of `var`, e.g.
+// because it is a parameter to a procedure.
+void AnalysisContext::AnalyzeOpaqueColumn(
+    TABLE *table, unsigned table_col_index, VAR *var, REGION *var_use,
+    RowProvenance &row) {
+
+  ColumnProvenance provenance;
+  provenance.input_var = var;
+  provenance.input_var_use = var_use;
+  provenance.col = table->columns[table_col_index];
+  provenance.src_var = nullptr;
+
+  row.columns->emplace_back(std::move(provenance));
+}
+
 // Analyze `var`, which can be the source of the `table_col_index`th column
 // of `table`, and is defined in `src`.
 void AnalysisContext::AnalyzeColumn(TABLE *table, unsigned table_col_index,
                                     VAR *var, REGION *var_use, TABLEJOIN *src,
                                     RowProvenance &row) {
 
-  // We implement the table join region so that it should always come from
-  // the most represented table in terms of non-pivot variables.
+  auto src_table_index = 0u;
+  auto src_column_index = 0u;
+  TABLECOLUMN *src_col = nullptr;
+
+  // Pivot variables have the same value in every joined table, so we
+  // attribute them to the first table. `pivot_cols` is indexed by table, then
+  // by pivot, and the pivot column also appears in the first table's outputs,
+  // which is where we find its column index.
+  auto pivot_index = 0u;
   for (auto pivot_var : src->pivot_vars) {
     if (var == pivot_var) {
-      assert(false);
+      src_col = src->pivot_cols[0][pivot_index];
+      for (auto out_col : src->output_cols[0]) {
+        if (out_col == src_col) {
+          goto found;
+        }
+        ++src_column_index;
+      }
+      src_col = nullptr;
+      break;
     }
+    ++pivot_index;
   }
 
-  auto src_table_index = 0u;
-  auto src_column_index = 0u;
   for (auto &src_table_vars : src->output_vars) {
     src_column_index = 0u;
     for (auto src_var : src_table_vars) {
       if (src_var == var) {
+        src_col = src->output_cols[src_table_index][src_column_index];
         goto found;
       }
       ++src_column_index;
     }
     ++src_table_index;
   }
-  assert(false);
+
+  // We couldn't attribute `var` to a column, so treat it conservatively.
+  AnalyzeOpaqueColumn(table, table_col_index, var, var_use, row);
+  return;
 
 found:
 
@@ -308,7 +347,7 @@ found:
   provenance.input_var_use = var_use;
   provenance.col = table->columns[table_col_index];
   provenance.src_table = src->tables[src_table_index];
-  provenance.src_col = provenance.src_table->columns[src_column_index];
+  provenance.src_col = src_col;
   provenance.index_of_src_var = src_column_index;
   provenance.index_of_src_table = src_table_index;
   row.columns->emplace_back(std::move(provenance));
@@ -369,9 +408,7 @@ found:
   provenance.input_var_use = var_use;
   provenance.col = table->columns[table_col_index];
   provenance.src_table = src->table.get();
-  provenance.src_col = provenance.src_table->columns[src_column_index];
-
-  row.columns->emplace_back(std::move(provenance));
+  provenance.src_col = src->out_cols[src_column_index];
 
   auto i = 0u;
   for (auto input_col : src->in_cols) {
@@ -382,6 +419,8 @@ found:
     }
     ++i;
   }
+
+  row.columns->emplace_back(std::move(provenance));
 }
 
 // Analyze `var`, which can be the source of the `table_col_index`th column
@@ -559,8 +598,6 @@ void AnalysisContext::AnalyzeVariable(
     });
 
     if (var_const) {
-      std::cerr << "Var " << var->id << " is constant "
-                << var_const->id << '\n';
       AnalyzeGlobalColumn(table, table_col_index, var_const, var_use, row);
       return;
     }
@@ -586,17 +623,32 @@ void AnalysisContext::AnalyzeVariable(
     } else if (CHECKRECORD *check = var_src_op->AsCheckRecord()) {
       AnalyzeColumn(table, table_col_index, var, var_use, check, row);
 
+    // Let bindings are just renamings, so look through them.
+    } else if (LET *let = var_src_op->AsLetBinding()) {
+      auto i = 0u;
+      for (VAR *defined_var : let->defined_vars) {
+        if (defined_var == var) {
+          AnalyzeVariable(table, table_col_index, let->used_vars[i], var_use,
+                          row);
+          return;
+        }
+        ++i;
+      }
+      AnalyzeOpaqueColumn(table, table_col_index, var, var_use, row);
+
     } else {
-      assert(false);
+      AnalyzeOpaqueColumn(table, table_col_index, var, var_use, row);
     }
 
-  // This variable is a parameter to a procedure.
-  } else if (PROC *var_src_proc = var_src->AsProcedure()) {
-    assert(var_src_proc->kind == ProcedureKind::kTupleFinder);
-    assert(false);  // We should never reach here.
+  // This variable is a parameter to a procedure, e.g. a tuple checker, or
+  // a top-down checker. We can't see past the procedure boundary.
+  } else if (var_src->AsProcedure()) {
+    AnalyzeOpaqueColumn(table, table_col_index, var, var_use, row);
 
+  // Anything else, e.g. a variable defined by a series or a parallel region,
+  // is opaque to this analysis.
   } else {
-    assert(false);
+    AnalyzeOpaqueColumn(table, table_col_index, var, var_use, row);
   }
 }
 
@@ -604,16 +656,9 @@ void AnalysisContext::AnalyzeVariable(
 // that we can track back to the original source of some row.
 void AnalysisContext::AnalyzeVectorAppends(void) {
   while (!pending_table_sources.empty()) {
-    std::cerr << "Processing pending: " << pending_table_sources.size() << "\n";
-
     RowProvenance row(std::move(pending_table_sources.back()));
     pending_table_sources.pop_back();
 
-
-    for (auto &col : *(row.columns)) {
-      std::cerr << "  input_var: " << col.input_var->id << "\n";
-    }
-
     const auto c_max = row.columns->size();
     for (auto c = 0u; c < c_max; ++c) {
       const ColumnProvenance &col = row.columns->at(c);
@@ -621,8 +666,6 @@ void AnalysisContext::AnalyzeVectorAppends(void) {
         continue;
       }
 
-      std::cerr << "    focusing on " << col.input_var->id << "\n";
-
       // Analyze this column in the context of each append into the
       // vector. This will produce a new row provenance for each such
       // vector append.
@@ -644,7 +687,6 @@ void AnalysisContext::AnalyzeVectorAppends(void) {
 
         // Maintain the original provenance.
         auto &fixed_col = new_row.columns->back();
-        std::cerr << "       deriving from " << fixed_col.input_var->id << "\n";
         fixed_col.input_var = col.input_var;
         fixed_col.input_var_use = col.input_var_use;
 
@@ -664,7 +706,6 @@ void AnalysisContext::AnalyzeVectorAppends(void) {
       // Handle any subsequent columns in future work list iterations.
       break;
     }
-    std::cerr << "\n";
   }
 }
 
@@ -744,9 +785,14 @@ void AnalysisContext::AnalyzeTable(TABLE *table, const UpdateList &updates) {
   }
 }
 
-// Convert a `CHECKTUPLE` into a `CHECKRECORD`.
-void AnalysisContext::ConvertToCheckRecord(
+// Convert a `CHECKTUPLE` into a `CHECKRECORD`. Returns `true` if the
+// conversion happened.
+bool AnalysisContext::ConvertToCheckRecord(
     ProgramImpl *impl, CHECKTUPLE *check) {
+  if (!check->parent) {
+    return false;
+  }
+
   CHECKRECORD *record = impl->operation_regions.CreateDerived<CHECKRECORD>(
       impl->next_id++, check->parent);
   record->col_values.Swap(check->col_values);
@@ -794,29 +840,21 @@ void AnalysisContext::ConvertToCheckRecord(
           } else {
             return user->FindCommonAncestor(record) == record;
           }
-//          if (user->containing_procedure != record->containing_procedure ||
-//              user == record) {
-//            return false;
-//          } else {
-//            for (auto region = user;
-//                 region && region != region->containing_procedure;
-//                 region = region->parent) {
-//              if (region == body || region == unknown_body) {
-//                return true;
-//              }
-//            }
-//            return false;
-//          }
         });
   }
 
   check->ReplaceAllUsesWith(record);
   check->parent = nullptr;
+  return true;
 }
 
-// Convert a `CHANGETUPLE` into a `CHANGERECORD`.
-void AnalysisContext::ConvertToChangeRecord(
+// Convert a `CHANGETUPLE` into a `CHANGERECORD`. Returns `true` if the
+// conversion happened.
+bool AnalysisContext::ConvertToChangeRecord(
     ProgramImpl *impl, CHANGETUPLE *change) {
+  if (!change->parent) {
+    return false;
+  }
 
   TABLE * const table = change->table.get();
   REGION *prev_record = nullptr;
@@ -870,7 +908,7 @@ void AnalysisContext::ConvertToChangeRecord(
       } else {
         break;
       }
-    } else if (prev_record != op_check) {
+    } else if (prev_record != op_region) {
       prev_record = nullptr;
       break;
     }
@@ -878,9 +916,9 @@ void AnalysisContext::ConvertToChangeRecord(
     ++i;
   }
 
-  // Not worth changing.
-  if (prev_record) {
-    return;
+  // Not worth changing; the backend can operate on the prior record directly.
+  if (prev_record && i == change->col_values.Size()) {
+    return false;
   }
 
   CHANGERECORD *record = impl->operation_regions.CreateDerived<CHANGERECORD>(
@@ -928,6 +966,7 @@ void AnalysisContext::ConvertToChangeRecord(
 
   change->ReplaceAllUsesWith(record);
   change->parent = nullptr;
+  return true;
 }
 
 namespace {
@@ -957,23 +996,25 @@ bool AnalysisContext::ConvertTablesToRecords(
   auto changed = false;
   for (TABLE *table : tables) {
 
-//    // Order deepest first.
-//    auto &checkers = check_states[table];
-//    std::sort(checkers.begin(), checkers.end(), OrderDeepestRegionFirst);
-//
-//    // Check states often contain change states, so we want change states to
-//    // see the record variables of check states, if possible.
-//    for (CHECKTUPLE *check : checkers) {
-//      changed = true;
-//      ConvertToCheckRecord(impl, check);
-//    }
+    // Order deepest first.
+    auto &checkers = check_states[table];
+    std::sort(checkers.begin(), checkers.end(), OrderDeepestRegionFirst);
+
+    // Check states often contain change states, so we want change states to
+    // see the record variables of check states, if possible.
+    for (CHECKTUPLE *check : checkers) {
+      if (ConvertToCheckRecord(impl, check)) {
+        changed = true;
+      }
+    }
 
     auto &changers = change_states[table];
     std::sort(changers.begin(), changers.end(), OrderDeepestRegionFirst);
 
     for (CHANGETUPLE *change : changers) {
-      changed = true;
-      ConvertToChangeRecord(impl, change);
+      if (ConvertToChangeRecord(impl, change)) {
+        changed = true;
+      }
     }
   }
 
@@ -994,19 +1035,14 @@ void AnalysisContext::ConvertInductionsToRecords(ProgramImpl *impl) {
     }
   }
 
-  ConvertTablesToRecords(impl, induction_tables);
+  if (!induction_tables.empty()) {
+    ConvertTablesToRecords(impl, induction_tables);
+  }
 }
 
 // Analyze all tables.
 void AnalysisContext::AnalyzeTables(ProgramImpl *impl) {
-
-  // First, go and change every single `CHANGETUPLE` into a `CHANGERECORD`.
-  std::unordered_set<TABLE *> tables;
-  for (TABLE *table : impl->tables) {
-    tables.insert(table);
-  }
-  ConvertTablesToRecords(impl, tables);
-
+  vector_appends.clear();
   table_updates.clear();
   table_sources.clear();
   pending_table_sources.clear();
@@ -1019,47 +1055,6 @@ void AnalysisContext::AnalyzeTables(ProgramImpl *impl) {
   }
   AnalyzeVectorAppends();
   UniqueAndGroupRowProvenance();
-
-  // Go and normalize the records, so that if a column is is a variable in
-  // any of the provenances for that row, then it is always a variable.
-  for (auto changed = true; changed; ) {
-    changed = false;
-    break;
-    std::cerr << "Running...\n";
-    for (auto &[table, rows] : unique_table_sources) {
-
-      std::vector<bool> any_derived(table->columns.Size(), false);
-      std::vector<bool> all_derived(table->columns.Size(), true);
-
-      for (RowProvenance *row : rows) {
-        auto i = 0u;
-        for (const ColumnProvenance &col : *(row->columns)) {
-          if (col.src_table) {
-            any_derived[i] = true;
-          } else {
-            all_derived[i] = false;
-          }
-          ++i;
-        }
-      }
-
-      for (RowProvenance *row : rows) {
-        auto i = 0u;
-        for (ColumnProvenance &col : *(row->columns)) {
-          if (any_derived[i] && !all_derived[i]) {
-            std::cerr << "  Killing var " << col.input_var->id << '\n';
-            if (col.input_var->id == 8528) {
-              assert(false);
-            }
-            col.src_table = nullptr;
-            col.src_col = nullptr;
-            changed = true;
-          }
-          ++i;
-        }
-      }
-    }
-  }
 }
 
 // Converts this row provenance into a string, which can be used for
@@ -1094,122 +1089,61 @@ std::string RowProvenance::Key(void) const {
 bool AnalysisContext::ConvertSinglePointerTuplesToRecords(
     ProgramImpl *impl) {
 
-//  std::unordered_set<REGION *> regions;
-//  std::unordered_set<TABLEJOIN *> joins;
-//  std::unordered_set<TABLEPRODUCT *> products;
-//  std::unordered_set<TABLESCAN *> scans;
-//  std::unordered_set<CHANGERECORD *> changes;
-//  std::unordered_set<CHECKRECORD *> checks;
-//  std::unordered_set<VECTORLOOP *> loops;
-//  std::unordered_set<GENERATOR *> generators;
-//
-//  std::unordered_map<TABLE *, std::unordered_set<size_t>> needed_pointers;
-//  std::unordered_map<TABLE *, unsigned> max_tuple_size;
-//  std::unordered_map<TABLE *, unsigned> max_record_size;
-//
-//  std::unordered_map<RowProvenance *, std::vector<TABLE *>> row_to_tables;
-//
-//
-//  for (auto &[key, row_ptr] : key_to_provenance) {
-//
-//
-//    for (const ColumnProvenance &col : *row->columns) {
-//      if (col.src_table) {
-//        needed_pointers[row->table].insert(num_needed_pointers);
-//      }
-//
-//
-//      inductions.insert(col.induction_table);
-//      joins.insert(col.join);
-//      products.insert(col.product);
-//      scans.insert(col.scan);
-//      changes.insert(col.change);
-//      checks.insert(col.check);
-//      loops.insert(col.loop);
-//      generators.insert(col.generator);
-//
-//      const auto col_size = col.EstimateSizeInBits();
-//      tuple_size += col_size;
-//
-//      if (!col.change && !col.check && !col.induction_table && !col.join &&
-//          !col.product && !col.scan) {
-//        record_size += col_size;
-//      }
-//    }
-//
-//    inductions.erase(nullptr);
-//    joins.erase(nullptr);
-//    products.erase(nullptr);
-//    scans.erase(nullptr);
-//    changes.erase(nullptr);
-//    checks.erase(nullptr);
-//    loops.erase(nullptr);
-//    generators.erase(nullptr);
-//
-//    size_t num_needed_pointers = 0u;
-//    num_needed_pointers += scans.size();
-//    num_needed_pointers += inductions.size();
-//    num_needed_pointers += changes.size();
-//    num_needed_pointers += checks.size();
-//
-//    for (TABLEJOIN *join : joins) {
-//      for (auto &out_var_list : join->output_vars) {
-//
-//        // If one table only contributes pivots, then we don't need to
-//        // store a pointer to its data.
-//        if (out_var_list.Size() > join->pivot_vars.Size()) {
-//          ++num_needed_pointers;
-//        }
-//      }
-//    }
-//
-//    for (TABLEPRODUCT *product : products) {
-//      num_needed_pointers += product->tables.Size();
-//    }
-//
-//    record_size += num_needed_pointers * 64;
-//
-//
-//    auto &curr_max_tuple_size = max_tuple_size[row->table];
-//    auto &curr_max_record_size = max_record_size[row->table];
-//
-//    curr_max_tuple_size = std::max(curr_max_tuple_size, tuple_size);
-//    curr_max_record_size = std::max(curr_max_record_size, record_size);
-//  }
-//
-//  std::unordered_set<TABLE *> single_pointer_tables;
-//  for (const auto &[table, pointer_counts] : needed_pointers) {
-//
-//    // NOTE(pag): We consider the case of zero pointers to be for data that
-//    //            depends on input messages, and the case of 1 pointers to be
-//    //            the case where all ways of inserting into a given table only
-//    //            ever depends on one other table.
-//    //
-//    // NOTE(pag): The zero-or-one case (where there are two entries in
-//    //            `pointer_counts` should get handled by repeated applications.
-//    if (pointer_counts.size() == 1u && *(pointer_counts.begin()) <= 1u) {
-//      single_pointer_tables.insert(table);
-//    }
-//  }
-//
-//  if (!single_pointer_tables.empty() &&
-//      ConvertTablesToRecords(impl, single_pointer_tables)) {
-//    return true;
-//  }
-//
-//  single_pointer_tables.clear();
-//  for (auto [table, tuple_size] : max_tuple_size) {
-//    if (tuple_size >= max_record_size[table]) {
-//      single_pointer_tables.insert(table);
-//    }
-//  }
-//
-//  if (single_pointer_tables.empty()) {
-//    return false;
-//  }
-//
-//  return ConvertTablesToRecords(impl, single_pointer_tables);
-  return false;
+  std::unordered_set<TABLE *> single_pointer_tables;
+  std::set<std::pair<REGION *, unsigned>> pointers;
+
+  for (const auto &[table, rows] : unique_table_sources) {
+    auto is_single_pointer = true;
+
+    for (RowProvenance *row : rows) {
+
+      // An expanding generator produces many rows from a single input, so
+      // the resulting rows can't be summarized by a pointer to their input.
+      if (row->generator_is_expanding) {
+        is_single_pointer = false;
+        break;
+      }
+
+      // Count the number of distinct records that this row's columns are
+      // derived from. Pivots of a join are attributed to the first joined
+      // table, so a join where one table only contributes pivots needs only
+      // the one pointer.
+      pointers.clear();
+      for (const ColumnProvenance &col : *(row->columns)) {
+        if (!col.src_table) {
+          continue;
+        }
+
+        REGION *const regions[] = {col.loop, col.scan, col.change, col.check,
+                                   col.join, col.product};
+        for (REGION *region : regions) {
+          if (region) {
+            pointers.emplace(region, col.index_of_src_table);
+            break;
+          }
+        }
+      }
+
+      // NOTE(pag): We consider the case of zero pointers to be for data that
+      //            depends on input messages, and the case of one pointer to
+      //            be the case where all ways of inserting into a given table
+      //            only ever depend on one other table.
+      if (1u < pointers.size()) {
+        is_single_pointer = false;
+        break;
+      }
+    }
+
+    if (is_single_pointer) {
+      single_pointer_tables.insert(table);
+    }
+  }
+
+  if (single_pointer_tables.empty()) {
+    return false;
+  }
+
+  return ConvertTablesToRecords(impl, single_pointer_tables);
 }
 
 // Build up the record and record case data structures.
@@ -1291,94 +1225,10 @@ void AnalysisContext::Build(ProgramImpl *impl) {
     for (RowProvenance *row : rows) {
       DATARECORDCASE *rc = cases[row];
       record->cases.AddUse(rc);
-
-      if (record->table->id == 189) {
-        if (rc->derived_from.Size() == 1u &&
-            rc->derived_from[0]->table->id == 223) {
-          std::cerr << "189 from 223:\n";
-          for (auto &col : *(row->columns)) {
-            std::cerr << "  var " << col.input_var->id;
-            if (col.src_var) {
-              std::cerr << "  src " << col.src_var->id;
-            }
-            std::cerr << "\n";
-          }
-        }
-      }
     }
   }
 }
 
-void AnalysisContext::Dump(ProgramImpl *impl) {
-  std::ofstream os("/tmp/tables.dot");
-
-  static constexpr auto kTable = "<TABLE cellpadding=\"0\" cellspacing=\"0\" border=\"1\">";
-  static constexpr auto kRow = "<TR>";
-  static constexpr auto kCell = "<TD>";
-  static constexpr auto kBold = "<B>";
-
-
-  static constexpr auto kEndTable = "</TABLE>";
-  static constexpr auto kEndRow = "</TR>";
-  static constexpr auto kEndCell = "</TD>";
-  static constexpr auto kEndBold = "</B>";
-
-  os << "digraph {\n"
-     << "node [shape=none margin=0 nojustify=false labeljust=l font=courier];\n";
-
-  for (TABLE *table : impl->tables) {
-    for (DATARECORD *record : table->records) {
-      os << "r" << record->id << " [label=<" << kTable << kRow
-         << kCell << kBold << "TABLE " << table->id << kEndBold << kEndCell
-         << kCell << kBold << "RECORD " << record->id << kEndBold << kEndCell;
-
-      auto i = 0u;
-      for (TABLECOLUMN *col : table->columns) {
-        os << "<TD port=\"c" << (i++) << "\">COL " << col->id << kEndCell;
-      }
-
-      os << kEndRow << kEndTable << ">];\n";
-
-      for (DATARECORDCASE *rc : record->cases) {
-
-        os << "r" << record->id << " -> rc" << rc->id << ";\n"
-           << "rc" << rc->id << " [label=<" << kTable << kRow << kCell
-           << kBold << "CASE " << rc->id << kEndBold << kEndCell;
-
-        i = 0u;
-        for (RecordColumn &rc_col : rc->columns) {
-          if (rc_col.column) {
-            os << "<TD port=\"c" << i << "\">COL " << rc_col.column->id;
-          } else if (rc_col.var->IsConstant()) {
-            os << kCell << "CONST " << rc_col.var->id;
-
-          } else {
-            os << kCell << "VAR " << rc_col.var->id;
-          }
-          os << kEndCell;
-          ++i;
-        }
-
-        os << kEndRow << kEndTable << ">];\n";
-
-        i = 0u;
-        for (RecordColumn &rc_col : rc->columns) {
-          if (rc_col.column) {
-            DATARECORD *dr = rc->derived_from[rc_col.derived_index];
-            os << "rc" << rc->id << ":c" << i << " -> r" << dr->id
-               << ":c" << rc_col.derived_offset << " [label=\""
-               << rc_col.derived_index << "\"];\n";
-          }
-          ++i;
-        }
-      }
-    }
-
-  }
-
-  os << "}\n";
-}
-
 }  // namespace
 
 // Analyze the control-flow IR and table usage, looking for strategies that
@@ -1396,20 +1246,21 @@ void ProgramImpl::Analyze(void) {
     max_depth = std::max(max_depth, region->CachedDepth());
   }
 
-//  context.ConvertInductionsToRecords(this);
+  context.ConvertInductionsToRecords(this);
   context.AnalyzeTables(this);
-//  for (auto i = 0u; i < max_depth; ++i) {
-//    if (context.ConvertSinglePointerTuplesToRecords(this)) {
-//      context.AnalyzeTables(this);
-//      std::cerr << "Updated!!\n";
-//    } else {
-//      std::cerr << "Converged at iteration " << i << "\n";
-//      break;
-//    }
-//  }
+
+  // Each conversion can expose new record variables that later analyses can
+  // trace back through, so iterate until we converge. The depth of the deepest
+  // region bounds how far that can propagate.
+  for (auto i = 0u; i < max_depth; ++i) {
+    if (context.ConvertSinglePointerTuplesToRecords(this)) {
+      context.AnalyzeTables(this);
+    } else {
+      break;
+    }
+  }
 
   context.Build(this);
-  context.Dump(this);
 }
 
 }  // namespace hyde
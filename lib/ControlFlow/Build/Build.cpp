@@ -5,6 +5,7 @@
 #include <drlojekyll/Parse/ErrorLog.h>
 
 #include <algorithm>
+#include <functional>
 #include <sstream>
 
 namespace hyde {
@@ -153,6 +154,150 @@ static void FillDataModel(const Query &query, ProgramImpl *impl,
       (void) TABLE::GetOrCreate(impl, context, view);
     }
   }
+
+  // Unique the data of differential messages into records. This lets us
+  // ignore duplicate additions, as well as removals of messages that were
+  // never added, and lets the tables fed by these messages count derivations.
+  for (auto io : query.IOs()) {
+    for (auto receive : io.Receives()) {
+      if (receive.CanReceiveDeletions()) {
+        (void) TABLE::GetOrCreate(impl, context, receive);
+      }
+    }
+  }
+}
+
+// Figure out which tables can count the derivations of their tuples. Counting
+// replaces the speculative `present -> unknown` transitions of bottom-up
+// removers, and the re-proving of unknown tuples by top-down checkers, with
+// a decrement, where a tuple is only removed once its last derivation goes
+// away.
+//
+// Counting is only correct if every derivation of a tuple is added exactly
+// once and removed exactly once. That holds for a table when the data flowing
+// into its views comes only through SELECTs, TUPLEs, non-inductive MERGEs,
+// and COMPAREs, and when each of those views' predecessors is itself counted,
+// or is backed by the table of a differential message. We exclude anything
+// else, e.g. JOINs, which re-discover the same outputs from different inputs,
+// and views testing conditions, which re-send their data when a condition
+// changes.
+static void FindCountedTables(const Query &query, ProgramImpl *impl) {
+  std::unordered_map<TABLE *, std::vector<QueryView>> table_views;
+  query.ForEachView([&](QueryView view) {
+    const auto model = impl->view_to_model[view]->FindAs<DataModel>();
+    if (model->table) {
+      table_views[model->table].push_back(view);
+    }
+  });
+
+  // A message table holds exactly the set of received messages, so its
+  // additions and removals are already in one-to-one correspondence with
+  // the published ones. The table itself must keep set semantics, so that
+  // duplicate additions are ignored.
+  std::unordered_set<TABLE *> message_tables;
+  for (const auto &[table, views] : table_views) {
+    auto num_receives = 0u;
+    auto is_closed = true;
+    for (QueryView view : views) {
+      if (view.IsSelect() && QuerySelect::From(view).IsStream()) {
+        ++num_receives;
+      }
+      for (auto pred_view : view.Predecessors()) {
+        const auto pred_model =
+            impl->view_to_model[pred_view]->FindAs<DataModel>();
+        is_closed = is_closed && pred_model->table == table;
+      }
+    }
+    if (1u == num_receives && is_closed) {
+      message_tables.insert(table);
+    }
+  }
+
+  // Are the additions and removals that `view` sends to its successors in
+  // one-to-one correspondence with derivations of the tuples of `view`?
+  std::unordered_map<QueryView, bool> is_exact;
+  std::function<bool(QueryView)> produces_exact_updates =
+      [&](QueryView view) -> bool {
+    if (!view.CanProduceDeletions()) {
+      return true;  // Extra derivations are harmless if none are removed.
+    }
+
+    if (auto it = is_exact.find(view); it != is_exact.end()) {
+      return it->second;
+    }
+
+    // Guard against cycles through views without tables.
+    is_exact.emplace(view, false);
+
+    auto exact = false;
+    const auto model = impl->view_to_model[view]->FindAs<DataModel>();
+    if (TABLE *const table = model->table) {
+      exact = table->is_counted || message_tables.count(table);
+
+    } else if (view.IsTuple() || view.IsInsert() || view.IsCompare() ||
+               (view.IsMerge() && !view.InductionGroupId().has_value())) {
+      exact = true;
+      for (auto pred_view : view.Predecessors()) {
+        if (!produces_exact_updates(pred_view)) {
+          exact = false;
+          break;
+        }
+      }
+    }
+
+    is_exact[view] = exact;
+    return exact;
+  };
+
+  // Can `table` count derivations, assuming that `table` itself does?
+  auto can_count = [&](TABLE *table, const std::vector<QueryView> &views) {
+    if (message_tables.count(table)) {
+      return false;
+    }
+
+    auto has_deletions = false;
+    for (QueryView view : views) {
+      if (view.IsSelect()) {
+        if (QuerySelect::From(view).IsStream()) {
+          return false;
+        }
+      } else if (!view.IsTuple() && !view.IsInsert() && !view.IsCompare() &&
+                 !view.IsMerge()) {
+        return false;
+      }
+
+      if (view.InductionGroupId().has_value() || view.SetCondition() ||
+          !view.PositiveConditions().empty() ||
+          !view.NegativeConditions().empty()) {
+        return false;
+      }
+
+      for (auto pred_view : view.Predecessors()) {
+        const auto pred_model =
+            impl->view_to_model[pred_view]->FindAs<DataModel>();
+        if (pred_model->table != table &&
+            !produces_exact_updates(pred_view)) {
+          return false;
+        }
+      }
+
+      has_deletions = has_deletions || view.CanReceiveDeletions();
+    }
+    return has_deletions;
+  };
+
+  // Counting a table can make the views of other tables exact, so iterate
+  // until we stop finding new counted tables.
+  for (auto changed = true; changed;) {
+    changed = false;
+    for (const auto &[table, views] : table_views) {
+      if (!table->is_counted && can_count(table, views)) {
+        table->is_counted = true;
+        changed = true;
+        is_exact.clear();
+      }
+    }
+  }
 }
 
 // Building the data model means figuring out which `QueryView`s can share the
@@ -565,8 +710,9 @@ static void BuildTopDownChecker(ProgramImpl *impl, Context &context,
       return;
 
     // If this view can't produce deletions, and if we have a table for it, then
-    // all we need to do is check the state.
-    } else if (!view.CanProduceDeletions()) {
+    // all we need to do is check the state. The same goes for counted tables,
+    // whose tuples are never unknown.
+    } else if (!view.CanProduceDeletions() || table->is_counted) {
       assert(view.PositiveConditions().empty());
       assert(view.NegativeConditions().empty());
 
@@ -1658,10 +1804,11 @@ InTryMarkUnknown(ProgramImpl *impl, Context &context, QueryView view,
 
       assert(!cols.empty());
 
-      // Do the marking.
-      const auto table_remove =
-          BuildChangeTuple(impl, table, parent, cols, TupleState::kPresent,
-                           TupleState::kUnknown);
+      // Do the marking. Counted tables drop one derivation of the tuple, and
+      // only remove it when none are left, so there is nothing to re-prove.
+      const auto table_remove = BuildChangeTuple(
+          impl, table, parent, cols, TupleState::kPresent,
+          table->is_counted ? TupleState::kAbsent : TupleState::kUnknown);
 
       parent->body.Emplace(parent, table_remove);
       parent = table_remove;
@@ -2252,7 +2399,7 @@ WorkItem::~WorkItem(void) {}
 
 // Build a program from a query.
 std::optional<Program> Program::Build(const ::hyde::Query &query,
-                                      unsigned first_id) {
+                                      unsigned first_id, bool use_records) {
   auto impl = std::make_shared<ProgramImpl>(query, first_id);
   const auto program = impl.get();
 
@@ -2289,6 +2436,7 @@ std::optional<Program> Program::Build(const ::hyde::Query &query,
   // Now that we've identified our inductions, we can fill our data model,
   // i.e. assign persistent tables to each disjoint set of views.
   FillDataModel(query, program, context);
+  FindCountedTables(query, program);
 
   // Build bottom-up procedures starting from message receives.
   PROC *const entry_proc = BuildEntryProcedure(program, context, query);
@@ -2351,7 +2499,12 @@ std::optional<Program> Program::Build(const ::hyde::Query &query,
     MapVariables(proc);
   }
 
-  // impl->Analyze();
+  // Convert state checks and changes into record checks and changes, where
+  // profitable.
+  if (use_records) {
+    impl->Analyze();
+  }
+
 #if 0
   // Finally, go through our tables. Any table with no indices is given a
   // full table index, on the assumption that it is used for things like state
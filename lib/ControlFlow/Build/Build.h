@@ -266,9 +266,11 @@ BuildBottomUpTryMarkUnknown(ProgramImpl *impl, TABLE *table, REGION *parent,
                             Cols &&cols, AfterChangeTuple with_par_node) {
 
   // Change the tuple's state to mark it as deleted so that we can't use it
-  // as its own base case.
+  // as its own base case. Counted tables instead drop one derivation, and the
+  // tuple is only removed once none are left.
   const auto table_remove = BuildChangeTuple(
-      impl, table, parent, cols, TupleState::kPresent, TupleState::kUnknown);
+      impl, table, parent, cols, TupleState::kPresent,
+      table->is_counted ? TupleState::kAbsent : TupleState::kUnknown);
 
   // Now that we've established the base case (marking the tuple absent), we
   // need to go and actually check all the possibilities.
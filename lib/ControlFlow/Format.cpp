@@ -34,7 +34,11 @@ static OutputStream &Type(OutputStream &os, ParsedModule module,
 
 static void DefineTable(OutputStream &os, ParsedModule module,
                         DataTable table) {
-  os << os.Indent() << "create " << table;
+  os << os.Indent() << "create ";
+  if (table.IsCounted()) {
+    os << "counted ";
+  }
+  os << table;
   os.PushIndent();
   for (auto col : table.Columns()) {
     os << '\n';
@@ -780,7 +784,7 @@ OutputStream &operator<<(OutputStream &os, ProgramTableScanRegion region) {
 }
 
 OutputStream &operator<<(OutputStream &os, ProgramInductionRegion region) {
-  os << os.Indent() << "induction\n";
+  os << os.Indent() << "induction:" << region.Id() << '\n';
   os.PushIndent();
   if (auto init = region.Initializer(); init) {
     os << os.Indent() << "init\n";
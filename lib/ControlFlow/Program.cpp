@@ -540,6 +540,132 @@ TupleState ProgramChangeTupleRegion::ToState(void) const noexcept {
   return impl->to_state;
 }
 
+namespace {
+
+// Returns `true` if the `i`th variable in `col_values` is the variable in
+// `vars` that was bound to the `i`th column of `table`, where `cols` tells us
+// which column each variable in `vars` was bound to.
+template <typename VarList>
+static bool ColumnsMatchRecord(TABLE *table, const UseList<VAR> &col_values,
+                               const VarList &vars,
+                               const UseList<TABLECOLUMN> &cols) {
+  const auto num_cols = table->columns.Size();
+  if (col_values.Size() != num_cols || vars.Size() != cols.Size()) {
+    return false;
+  }
+
+  for (auto i = 0u; i < num_cols; ++i) {
+    TABLECOLUMN *const col = table->columns[i];
+    VAR *const var = col_values[i];
+    auto found = false;
+    for (auto j = 0u; j < vars.Size(); ++j) {
+      if (vars[j] == var && cols[j] == col) {
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Returns `true` if `col_values` are exactly the record variables in
+// `record_vars`, in order.
+static bool VariablesMatchRecord(const UseList<VAR> &col_values,
+                                 const DefList<VAR> &record_vars) {
+  if (col_values.Size() != record_vars.Size()) {
+    return false;
+  }
+  for (auto i = 0u; i < col_values.Size(); ++i) {
+    if (col_values[i] != record_vars[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns `true` if `user` is nested inside of `body` of `op`.
+static bool IsNestedInBody(REGION *user, OP *op, REGION *body) {
+  if (!body) {
+    return false;
+  }
+  for (REGION *region = user; region && region != op;
+       region = region->parent) {
+    if (region == body) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Figure out if all of `col_values` are defined by a single table scan,
+// table join, or record check/change, where the table is `table`, and where
+// the variables line up with the columns of `table`. If so, then the record
+// found by the scan is exactly the record that would be found by hashing
+// `col_values`.
+static std::optional<ProgramRecordProvider>
+FindRecordProvider(REGION *user, TABLE *table,
+                   const UseList<VAR> &col_values) {
+  if (col_values.Empty()) {
+    return std::nullopt;
+  }
+
+  REGION *const def_region = col_values[0]->defining_region;
+  if (!def_region) {
+    return std::nullopt;
+  }
+
+  OP *const def_op = def_region->AsOperation();
+  if (!def_op) {
+    return std::nullopt;
+  }
+
+  if (TABLESCAN *scan = def_op->AsTableScan()) {
+    if (scan->table.get() == table &&
+        ColumnsMatchRecord(table, col_values, scan->out_vars, scan->out_cols)) {
+      return ProgramRecordProvider{ProgramRegion(scan), 0u};
+    }
+
+  } else if (TABLEJOIN *join = def_op->AsTableJoin()) {
+    for (auto i = 0u; i < join->tables.Size(); ++i) {
+      if (join->tables[i] == table &&
+          ColumnsMatchRecord(table, col_values, join->output_vars[i],
+                             join->output_cols[i])) {
+        return ProgramRecordProvider{ProgramRegion(join), i};
+      }
+    }
+
+  // A record is only guaranteed to exist if the state change succeeded.
+  } else if (CHANGERECORD *change = def_op->AsChangeRecord()) {
+    if (change->table.get() == table &&
+        VariablesMatchRecord(col_values, change->record_vars) &&
+        IsNestedInBody(user, change, change->body.get())) {
+      return ProgramRecordProvider{ProgramRegion(change), 0u};
+    }
+
+  // A record is only guaranteed to exist if the tuple is present or unknown.
+  } else if (CHECKRECORD *check = def_op->AsCheckRecord()) {
+    if (check->table.get() == table &&
+        VariablesMatchRecord(col_values, check->record_vars) &&
+        (IsNestedInBody(user, check, check->body.get()) ||
+         IsNestedInBody(user, check, check->unknown_body.get()))) {
+      return ProgramRecordProvider{ProgramRegion(check), 0u};
+    }
+  }
+
+  return std::nullopt;
+}
+
+}  // namespace
+
+std::optional<ProgramRecordProvider>
+ProgramChangeTupleRegion::RecordProvider(void) const noexcept {
+  return FindRecordProvider(impl, impl->table.get(), impl->col_values);
+}
+
 unsigned ProgramChangeRecordRegion::Arity(void) const noexcept {
   return impl->col_values.Size();
 }
@@ -561,6 +687,11 @@ TupleState ProgramChangeRecordRegion::ToState(void) const noexcept {
   return impl->to_state;
 }
 
+std::optional<ProgramRecordProvider>
+ProgramChangeRecordRegion::RecordProvider(void) const noexcept {
+  return FindRecordProvider(impl, impl->table.get(), impl->col_values);
+}
+
 unsigned ProgramCheckTupleRegion::Arity(void) const noexcept {
   return impl->col_values.Size();
 }
@@ -569,6 +700,11 @@ DataTable ProgramCheckTupleRegion::Table(void) const {
   return DataTable(impl->table.get());
 }
 
+std::optional<ProgramRecordProvider>
+ProgramCheckTupleRegion::RecordProvider(void) const noexcept {
+  return FindRecordProvider(impl, impl->table.get(), impl->col_values);
+}
+
 std::optional<ProgramRegion>
 ProgramCheckTupleRegion::IfPresent(void) const noexcept {
   if (auto body = impl->body.get(); body) {
@@ -601,6 +737,11 @@ unsigned ProgramCheckRecordRegion::Id(void) const noexcept {
   return impl->id;
 }
 
+std::optional<ProgramRecordProvider>
+ProgramCheckRecordRegion::RecordProvider(void) const noexcept {
+  return FindRecordProvider(impl, impl->table.get(), impl->col_values);
+}
+
 unsigned ProgramCheckRecordRegion::Arity(void) const noexcept {
   return impl->col_values.Size();
 }
@@ -789,6 +930,11 @@ const std::vector<QueryView> DataTable::Views(void) const noexcept {
   return impl->views;
 }
 
+// Does this table count the derivations of its tuples?
+bool DataTable::IsCounted(void) const noexcept {
+  return impl->is_counted;
+}
+
 VectorKind DataVector::Kind(void) const noexcept {
   return impl->kind;
 }
@@ -123,6 +123,12 @@ class DataTableImpl final : public Def<DataTableImpl>, public User {
 
   // All views sharing this table.
   std::vector<QueryView> views;
+
+  // Does this table count the derivations of its tuples? If so, then removing
+  // a tuple only removes one of its derivations, and the tuple transitions
+  // directly to the absent state once no derivations remain, rather than
+  // transitioning to the unknown state and later being re-proven.
+  bool is_counted{false};
 };
 
 using TABLE = DataTableImpl;
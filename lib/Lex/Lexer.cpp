@@ -470,6 +470,16 @@ bool Lexer::TryGetNextToken(const StringPool &string_pool, Token *tok_out) {
         basic.Store<Lexeme>(Lexeme::kPragmaPerfInline);
         basic.Store<lex::SpellingWidth>(impl->data.size());
 
+      } else if (impl->data == "@memoize") {
+        auto &basic = ret.As<lex::BasicToken>();
+        basic.Store<Lexeme>(Lexeme::kPragmaPerfMemoize);
+        basic.Store<lex::SpellingWidth>(impl->data.size());
+
+      } else if (impl->data == "@batch") {
+        auto &basic = ret.As<lex::BasicToken>();
+        basic.Store<Lexeme>(Lexeme::kPragmaPerfBatch);
+        basic.Store<lex::SpellingWidth>(impl->data.size());
+
       } else if (impl->data == "@transparent") {
         auto &basic = ret.As<lex::BasicToken>();
         basic.Store<Lexeme>(Lexeme::kPragmaPerfTransparent);
@@ -129,6 +129,12 @@ OutputStream &operator<<(OutputStream &os, ParsedDeclaration decl) {
       }
       os << ")";
     }
+    if (functor.IsMemoized()) {
+      os << " @memoize";
+    }
+    if (functor.IsBatched()) {
+      os << " @batch";
+    }
 
   } else if (decl.IsLocal() && decl.IsInline()) {
     os << " @inline";
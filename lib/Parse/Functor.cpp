@@ -259,6 +259,40 @@ void ParserImpl::ParseFunctor(ParsedModuleImpl *module) {
             return;
           }
 
+        } else if (Lexeme::kPragmaPerfMemoize == lexeme) {
+          if (functor->memoize_attribute.IsValid()) {
+            auto err = context->error_log.Append(scope_range, tok_range);
+            err << "Unexpected '@memoize' pragma here; functor " << name
+                << " was already marked as memoized";
+
+            err.Note(scope_range, functor->memoize_attribute.SpellingRange())
+                << "Previous '@memoize' pragma was here";
+
+            RemoveDecl(functor);
+            return;
+          }
+
+          functor->memoize_attribute = tok;
+          state = 6;
+          continue;
+
+        } else if (Lexeme::kPragmaPerfBatch == lexeme) {
+          if (functor->batch_attribute.IsValid()) {
+            auto err = context->error_log.Append(scope_range, tok_range);
+            err << "Unexpected '@batch' pragma here; functor " << name
+                << " was already marked as batched";
+
+            err.Note(scope_range, functor->batch_attribute.SpellingRange())
+                << "Previous '@batch' pragma was here";
+
+            RemoveDecl(functor);
+            return;
+          }
+
+          functor->batch_attribute = tok;
+          state = 6;
+          continue;
+
         } else if (Lexeme::kPragmaPerfInline == lexeme) {
           // Duplicate `@inline`.
           if (functor->inline_attribute.IsValid()) {
@@ -319,7 +353,8 @@ void ParserImpl::ParseFunctor(ParsedModuleImpl *module) {
         } else {
           context->error_log.Append(scope_range, tok_range)
               << "Expected either a terminating period or an "
-              << "'@range' pragma or '@impure' pragma here, "
+              << "'@range', '@impure', '@inline', '@memoize', or '@batch' "
+              << "pragma here, "
               << "but got '" << tok << "' instead";
           RemoveDecl(functor);
           return;
@@ -556,6 +591,43 @@ void ParserImpl::ParseFunctor(ParsedModuleImpl *module) {
         << "Marking an aggregating functor as impure is redundant";
     RemoveDecl(functor);
 
+  // Aggregating functors are given a whole group of values at once, so there
+  // is no single input tuple that we could use to memoize their results.
+  } else if (functor->memoize_attribute.IsValid() && is_aggregate) {
+    context->error_log.Append(scope_range,
+                              functor->memoize_attribute.SpellingRange())
+        << "Aggregating functors cannot be memoized";
+    RemoveDecl(functor);
+
+  // Aggregating functors already receive whole groups of values at once.
+  } else if (functor->batch_attribute.IsValid() && is_aggregate) {
+    context->error_log.Append(scope_range,
+                              functor->batch_attribute.SpellingRange())
+        << "Aggregating functors cannot be batched";
+    RemoveDecl(functor);
+
+  // The batch method of a functor is generated alongside the functor's method
+  // in the functors class, which inline functors don't use.
+  } else if (functor->batch_attribute.IsValid() &&
+             functor->inline_attribute.IsValid()) {
+    auto err = context->error_log.Append(
+        scope_range, functor->batch_attribute.SpellingRange());
+    err << "Inline functors cannot be batched";
+    err.Note(scope_range, functor->inline_attribute.SpellingRange())
+        << "Functor was marked as inline here";
+    RemoveDecl(functor);
+
+  // Batched calls bypass the memoization cache, so it's ambiguous which one
+  // the user wants.
+  } else if (functor->batch_attribute.IsValid() &&
+             functor->memoize_attribute.IsValid()) {
+    auto err = context->error_log.Append(
+        scope_range, functor->batch_attribute.SpellingRange());
+    err << "Functors cannot be both batched and memoized";
+    err.Note(scope_range, functor->memoize_attribute.SpellingRange())
+        << "Functor was marked as memoized here";
+    RemoveDecl(functor);
+
   // A functor with no bound parameters cannot reasonably be supported.
   //
   // NOTE(pag): I had considered supporting it before as the concept of a
@@ -1221,6 +1221,34 @@ bool ParsedFunctor::IsFilter(void) const noexcept {
   }
 }
 
+// Should the results of this functor be memoized? This is `true` if any
+// declaration of this functor with the same binding pattern is marked with
+// the `@memoize` pragma.
+bool ParsedFunctor::IsMemoized(void) const noexcept {
+  const auto &pattern = impl->BindingPattern();
+  for (ParsedDeclarationImpl *redecl : impl->context->redeclarations) {
+    if (redecl->memoize_attribute.IsValid() &&
+        redecl->BindingPattern() == pattern) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Does this functor have a batched implementation? This is `true` if any
+// declaration of this functor with the same binding pattern is marked with
+// the `@batch` pragma.
+bool ParsedFunctor::IsBatched(void) const noexcept {
+  const auto &pattern = impl->BindingPattern();
+  for (ParsedDeclarationImpl *redecl : impl->context->redeclarations) {
+    if (redecl->batch_attribute.IsValid() &&
+        redecl->BindingPattern() == pattern) {
+      return true;
+    }
+  }
+  return false;
+}
+
 // Is this an inline functor? This means that is will have a direct definition
 // provided in some file or in the auto-generated code (via a `#prologue` or
 // `#epilogue`). This is really a symbol visibility thing.
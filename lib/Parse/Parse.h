@@ -381,6 +381,8 @@ class ParsedDeclarationImpl : public Def<ParsedDeclarationImpl>, public User {
   Token range_end_opt;
   FunctorRange range{FunctorRange::kZeroOrMore};
   Token inline_attribute;
+  Token memoize_attribute;
+  Token batch_attribute;
   Token differential_attribute;
   Token first_attribute;
   Token last_tok;
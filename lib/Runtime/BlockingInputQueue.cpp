@@ -0,0 +1,63 @@
+// Copyright 2021, Trail of Bits, Inc. All rights reserved.
+
+#include <drlojekyll/Runtime/BlockingInputQueue.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace hyde {
+namespace rt {
+
+// NOTE(pag): This is deliberately a single lock-protected deque rather than a
+//            lock-free queue. Lock-free multi-producer queues only keep items
+//            in order per producer, and gRPC handlers run on arbitrary
+//            threads, so a retraction could otherwise be dequeued before the
+//            addition that it retracts.
+class UntypedBlockingInputQueueImpl {
+ public:
+  std::mutex lock;
+  std::condition_variable cv;
+  std::deque<void *> items;
+
+  size_t DequeueBulk(void **out, size_t max) {
+    const auto num = std::min(max, items.size());
+    std::copy_n(items.begin(), num, out);
+    items.erase(items.begin(), items.begin() + static_cast<ptrdiff_t>(num));
+    return num;
+  }
+};
+
+UntypedBlockingInputQueue::UntypedBlockingInputQueue(void)
+    : impl(std::make_unique<UntypedBlockingInputQueueImpl>()) {}
+
+UntypedBlockingInputQueue::~UntypedBlockingInputQueue(void) {}
+
+void UntypedBlockingInputQueue::Enqueue(void *item) {
+  {
+    std::lock_guard<std::mutex> locker(impl->lock);
+    impl->items.push_back(item);
+  }
+  impl->cv.notify_one();
+}
+
+size_t UntypedBlockingInputQueue::WaitDequeueBulk(void **items, size_t max) {
+  std::unique_lock<std::mutex> locker(impl->lock);
+  impl->cv.wait(locker, [this] { return !impl->items.empty(); });
+  return impl->DequeueBulk(items, max);
+}
+
+size_t UntypedBlockingInputQueue::TryDequeueBulk(void **items, size_t max) {
+  std::lock_guard<std::mutex> locker(impl->lock);
+  return impl->DequeueBulk(items, max);
+}
+
+size_t UntypedBlockingInputQueue::SizeApprox(void) const {
+  std::lock_guard<std::mutex> locker(impl->lock);
+  return impl->items.size();
+}
+
+}  // namespace rt
+}  // namespace hyde
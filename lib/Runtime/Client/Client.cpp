@@ -2,7 +2,10 @@
 
 #include "Client.h"
 
+#include <algorithm>
 #include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <new>
 
 #include <grpcpp/impl/codegen/sync_stream.h>
@@ -14,6 +17,29 @@
 
 namespace hyde {
 namespace rt {
+namespace {
+
+// Turn a received slice into a buffer holding a flatbuffer. If the slice's
+// data is suitably aligned and big enough, then the returned buffer aliases
+// the slice, and keeps it alive. Otherwise, the data is copied into a new,
+// aligned buffer.
+static std::shared_ptr<uint8_t> AdoptSlice(grpc::Slice slice, size_t align,
+                                           size_t min_size) {
+  auto holder = std::make_shared<grpc::Slice>(std::move(slice));
+  const auto data = const_cast<uint8_t *>(holder->begin());
+  const auto size = holder->size();
+  if (size >= min_size && !(reinterpret_cast<uintptr_t>(data) % align)) {
+    return std::shared_ptr<uint8_t>(std::move(holder), data);
+  }
+
+  std::shared_ptr<uint8_t> out(
+      new (std::align_val_t{align}) uint8_t[std::max<size_t>(size, min_size)],
+      [align] (uint8_t *p) { operator delete[](p, std::align_val_t{align}); });
+  memcpy(out.get(), data, size);
+  return out;
+}
+
+}  // namespace
 
 ClientResultStreamImpl::ClientResultStreamImpl(
     std::shared_ptr<grpc::Channel> channel_,
@@ -22,7 +48,6 @@ ClientResultStreamImpl::ClientResultStreamImpl(
     : channel(std::move(channel_)),
       context() {
 
-  context.set_compression_algorithm(GRPC_COMPRESS_STREAM_GZIP);
   context.set_wait_for_ready(true);
   reader.reset(
       grpc::internal::ClientReaderFactory<grpc::Slice>::Create<grpc::Slice>(
@@ -57,12 +82,7 @@ bool ClientResultStreamImpl::Next(std::shared_ptr<uint8_t> *out,
   }
 
   if (read) {
-    auto size = std::max<size_t>(slice.size(), min_size);
-    std::shared_ptr<uint8_t> new_out(
-        new (std::align_val_t{align}) uint8_t[size],
-        [](uint8_t *p ){ delete [] p; });
-
-    memcpy(new_out.get(), slice.begin(), slice.size());
+    auto new_out = AdoptSlice(std::move(slice), align, min_size);
     out->swap(new_out);
     return true;
 
@@ -101,13 +121,7 @@ std::shared_ptr<uint8_t> Call(
       ::grpc::internal::BlockingUnaryCall<grpc::Slice, grpc::Slice>(
           channel, method, &context, data, &slice);
   if (status.ok()) {
-    auto size = std::max<size_t>(slice.size(), min_size);
-    std::shared_ptr<uint8_t> out(
-        new (std::align_val_t{align}) uint8_t[size],
-        [](uint8_t *p ){ delete [] p; });
-
-    memcpy(out.get(), slice.begin(), slice.size());
-    return out;
+    return AdoptSlice(std::move(slice), align, min_size);
   } else {
     return {};
   }
@@ -122,6 +136,17 @@ void Kill(ClientResultStreamImpl *stream) {
 
 }  // namespace internal
 
+// Create an insecure channel to the backend at `address`.
+std::shared_ptr<grpc::Channel> CreateChannel(
+    const std::string &address, grpc_compression_algorithm compression) {
+  grpc::ChannelArguments args;
+  args.SetCompressionAlgorithm(compression);
+  args.SetMaxReceiveMessageSize(-1);
+  args.SetMaxSendMessageSize(-1);
+  return grpc::CreateCustomChannel(
+      address, grpc::InsecureChannelCredentials(), args);
+}
+
 // Send data to the backend.
 bool Publish(grpc::Channel *channel, const grpc::internal::RpcMethod &method,
              const grpc::Slice &data) {
@@ -133,5 +158,118 @@ bool Publish(grpc::Channel *channel, const grpc::internal::RpcMethod &method,
   return status.error_code() == grpc::StatusCode::OK;
 }
 
+AsyncPublisherImpl::AsyncPublisherImpl(
+    std::shared_ptr<grpc::Channel> channel_,
+    const grpc::internal::RpcMethod &method_,
+    const AsyncPublisherOptions &options_,
+    std::function<void(void)> on_tick_)
+    : channel(std::move(channel_)),
+      method(method_),
+      options(options_),
+      on_tick(std::move(on_tick_)) {
+  sender = std::thread([this] (void) { SendLoop(); });
+  if (on_tick) {
+    ticker = std::thread([this] (void) { TickLoop(); });
+  }
+}
+
+// NOTE(pag): The ticker is stopped first, as it can still enqueue batches.
+//            Then the sender finishes sending everything that is enqueued.
+AsyncPublisherImpl::~AsyncPublisherImpl(void) {
+  {
+    std::unique_lock<std::mutex> locker(lock);
+    ticker_stopping = true;
+  }
+  stop_ticking.notify_all();
+  if (ticker.joinable()) {
+    ticker.join();
+  }
+
+  {
+    std::unique_lock<std::mutex> locker(lock);
+    stopping = true;
+  }
+  queue_changed.notify_all();
+  sender.join();
+}
+
+void AsyncPublisherImpl::Send(const grpc::Slice &data,
+                              std::promise<bool> done) {
+  std::unique_lock<std::mutex> locker(lock);
+  const auto max_in_flight = std::max(1u, options.max_in_flight);
+  queue_changed.wait(locker, [=] (void) {
+    return queue.size() < max_in_flight;
+  });
+  queue.emplace_back(data, std::move(done));
+  locker.unlock();
+  queue_changed.notify_all();
+}
+
+void AsyncPublisherImpl::Drain(void) {
+  std::unique_lock<std::mutex> locker(lock);
+  queue_changed.wait(locker, [this] (void) {
+    return queue.empty();
+  });
+}
+
+void AsyncPublisherImpl::SendLoop(void) {
+  std::unique_lock<std::mutex> locker(lock);
+  for (;;) {
+    queue_changed.wait(locker, [this] (void) {
+      return stopping || !queue.empty();
+    });
+    if (queue.empty()) {
+      return;  // Stopping, and nothing left to send.
+    }
+
+    // Send the batch without holding the lock, so that producers can keep
+    // enqueuing batches in the meantime.
+    grpc::Slice data = queue.front().first;
+    locker.unlock();
+    const auto sent = Publish(channel.get(), method, data);
+    locker.lock();
+
+    auto done = std::move(queue.front().second);
+    queue.pop_front();
+    locker.unlock();
+    queue_changed.notify_all();
+    done.set_value(sent);
+    locker.lock();
+  }
+}
+
+void AsyncPublisherImpl::TickLoop(void) {
+  std::unique_lock<std::mutex> locker(lock);
+  for (;;) {
+    const auto stop = stop_ticking.wait_for(
+        locker, options.max_batch_delay,
+        [this] (void) { return ticker_stopping; });
+    if (stop) {
+      return;
+    }
+    locker.unlock();
+    on_tick();
+    locker.lock();
+  }
+}
+
+AsyncPublisher::~AsyncPublisher(void) {}
+
+AsyncPublisher::AsyncPublisher(std::shared_ptr<grpc::Channel> channel_,
+                               const grpc::internal::RpcMethod &method,
+                               const AsyncPublisherOptions &options_,
+                               std::function<void(void)> on_tick)
+    : options(options_),
+      impl(new AsyncPublisherImpl(std::move(channel_), method, options_,
+                                  std::move(on_tick))) {}
+
+void AsyncPublisher::Send(const grpc::Slice &data, std::promise<bool> done) {
+  impl->Send(data, std::move(done));
+}
+
+void AsyncPublisher::Drain(void) {
+  impl->Drain();
+}
+
 }  // namespace rt
 }  // namespace hyde
@@ -5,12 +5,16 @@
 #include <drlojekyll/Runtime/Client.h>
 
 #include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <grpcpp/grpcpp.h>
 #include <grpcpp/support/async_stream.h>
 #include <list>
 #include <mutex>
 #include <new>
+#include <thread>
 #include <type_traits>
+#include <utility>
 
 #include "Serialize.h"
 
@@ -41,5 +45,42 @@ class ClientResultStreamImpl
   bool Next(std::shared_ptr<uint8_t> *out, size_t align, size_t min_size);
 };
 
+class AsyncPublisherImpl {
+ public:
+  ~AsyncPublisherImpl(void);
+
+  AsyncPublisherImpl(std::shared_ptr<grpc::Channel> channel_,
+                     const grpc::internal::RpcMethod &method_,
+                     const AsyncPublisherOptions &options_,
+                     std::function<void(void)> on_tick_);
+
+  void Send(const grpc::Slice &data, std::promise<bool> done);
+  void Drain(void);
+
+ private:
+  void SendLoop(void);
+  void TickLoop(void);
+
+  // Hold onto the connection to make sure we don't lose it.
+  const std::shared_ptr<grpc::Channel> channel;
+  const grpc::internal::RpcMethod method;
+  const AsyncPublisherOptions options;
+  const std::function<void(void)> on_tick;
+
+  std::mutex lock;
+  std::condition_variable queue_changed;
+  std::condition_variable stop_ticking;
+
+  // Batches waiting to be sent. The front of the queue is sent first, and is
+  // only popped once it has been sent, so that `Drain` can wait for the queue
+  // to become empty.
+  std::deque<std::pair<grpc::Slice, std::promise<bool>>> queue;
+  bool stopping{false};
+  bool ticker_stopping{false};
+
+  std::thread sender;
+  std::thread ticker;
+};
+
 }  // namespace rt
 }  // namespace hyde
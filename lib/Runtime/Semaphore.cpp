@@ -2,12 +2,19 @@
 
 #include <drlojekyll/Runtime/Semaphore.h>
 
-#include <blockingconcurrentqueue.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
 
 namespace hyde {
 namespace rt {
 
-class SemaphoreImpl : public moodycamel::LightweightSemaphore {};
+class SemaphoreImpl {
+ public:
+  std::mutex lock;
+  std::condition_variable cv;
+  ssize_t count{0};
+};
 
 Semaphore::Semaphore(void)
     : impl(std::make_unique<SemaphoreImpl>()) {}
@@ -15,19 +22,28 @@ Semaphore::Semaphore(void)
 Semaphore::~Semaphore(void) {}
 
 void Semaphore::Signal(void) {
-  impl->signal();
+  Signal(1);
 }
 
 bool Semaphore::Wait(void) {
-  return impl->wait();
+  return Wait(1);
 }
 
 void Semaphore::Signal(ssize_t count) {
-  impl->signal(count);
+  {
+    std::lock_guard<std::mutex> locker(impl->lock);
+    impl->count += count;
+  }
+  impl->cv.notify_all();
 }
 
+// Wait until the semaphore is signalled, then consume up to `max` of its
+// signals.
 bool Semaphore::Wait(ssize_t max) {
-  return impl->waitMany(max);
+  std::unique_lock<std::mutex> locker(impl->lock);
+  impl->cv.wait(locker, [this] (void) { return 0 < impl->count; });
+  impl->count -= std::min(impl->count, max);
+  return true;
 }
 
 }  // namespace rt
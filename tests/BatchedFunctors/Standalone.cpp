@@ -0,0 +1,111 @@
+// Copyright 2021, Trail of Bits. All rights reserved.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <drlojekyll/Runtime/StdRuntime.h>
+#include "batched_functors.db.h"  // Auto-generated.
+
+using DatabaseStorage = hyde::rt::StdStorage;
+using DatabaseLog = batched_functors::DatabaseLog<DatabaseStorage>;
+
+template <typename... Args>
+using Vector = hyde::rt::Vector<DatabaseStorage, Args...>;
+
+// Both functors compute the same thing; `scale` additionally counts how many
+// times its batch method is called, and with how many inputs. Empty batches
+// aren't counted, as the database initializes itself by running its message
+// procedures on empty vectors.
+class DatabaseFunctors
+    : public batched_functors::DatabaseFunctors<DatabaseStorage> {
+ public:
+  using BaseType = batched_functors::DatabaseFunctors<DatabaseStorage>;
+
+  virtual ~DatabaseFunctors(void) = default;
+
+  uint64_t scale_bf(uint64_t x) override {
+    ++num_calls;
+    return x * 3u + 1u;
+  }
+
+  std::vector<uint64_t> scale_bf_batch(
+      const std::vector<std::tuple<uint64_t>> &inputs) override {
+    if (!inputs.empty()) {
+      ++num_batches;
+      num_batched_inputs += inputs.size();
+    }
+    return BaseType::scale_bf_batch(inputs);
+  }
+
+  uint64_t scale_unbatched_bf(uint64_t x) override {
+    return x * 3u + 1u;
+  }
+
+  uint64_t num_calls{0};
+  uint64_t num_batches{0};
+  uint64_t num_batched_inputs{0};
+};
+
+using Database = batched_functors::Database<DatabaseStorage, DatabaseLog,
+                                            DatabaseFunctors>;
+
+using Tuples = std::set<std::pair<uint64_t, uint64_t>>;
+
+static Tuples Scaled(Database &db) {
+  Tuples tuples;
+  db.scaled_ff([&tuples] (uint64_t x, uint64_t y) {
+    tuples.emplace(x, y);
+    return true;
+  });
+  return tuples;
+}
+
+static Tuples ScaledUnbatched(Database &db) {
+  Tuples tuples;
+  db.scaled_unbatched_ff([&tuples] (uint64_t x, uint64_t y) {
+    tuples.emplace(x, y);
+    return true;
+  });
+  return tuples;
+}
+
+TEST(BatchedFunctors, BatchMatchesUnbatched) {
+
+  DatabaseFunctors functors;
+  DatabaseLog log;
+  DatabaseStorage storage;
+  Database db(storage, log, functors);
+
+  // All of the numbers in one published vector go into a single batch.
+  Vector<uint64_t> numbers(storage, 0);
+  for (uint64_t x = 1; x <= 8; ++x) {
+    numbers.Add(x);
+  }
+  db.number_1(std::move(numbers));
+
+  const Tuples expected = {{1, 4}, {2, 7}, {3, 10}, {4, 13},
+                           {5, 16}, {6, 19}, {7, 22}, {8, 25}};
+  ASSERT_EQ(ScaledUnbatched(db), expected);
+  ASSERT_EQ(Scaled(db), expected);
+  ASSERT_EQ(functors.num_batches, 1u);
+  ASSERT_EQ(functors.num_batched_inputs, 8u);
+  ASSERT_EQ(functors.num_calls, 8u);
+
+  // A second vector gets a batch of its own, and adds to the same results.
+  Vector<uint64_t> numbers2(storage, 0);
+  numbers2.Add(9);
+  numbers2.Add(10);
+  db.number_1(std::move(numbers2));
+
+  const Tuples expected2 = {{1, 4}, {2, 7}, {3, 10}, {4, 13}, {5, 16},
+                            {6, 19}, {7, 22}, {8, 25}, {9, 28}, {10, 31}};
+  ASSERT_EQ(ScaledUnbatched(db), expected2);
+  ASSERT_EQ(Scaled(db), expected2);
+  ASSERT_EQ(functors.num_batches, 2u);
+  ASSERT_EQ(functors.num_batched_inputs, 10u);
+}
@@ -0,0 +1,73 @@
+// Copyright 2021, Trail of Bits. All rights reserved.
+
+#pragma once
+
+#include <benchmark/benchmark.h>
+#include <sys/resource.h>
+
+#ifdef __GLIBC__
+#  include <malloc.h>
+#endif
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// Read a memory size, in bytes, from a field of `/proc/self/status`, e.g.
+// `VmRSS` or `VmHWM`. Returns zero if the field can't be read.
+static uint64_t ProcStatusBytes(const char *field) {
+  const std::string prefix = std::string(field) + ":";
+  std::ifstream fs("/proc/self/status");
+  for (std::string line; std::getline(fs, line);) {
+    if (!line.compare(0, prefix.size(), prefix)) {
+      return std::stoull(line.substr(prefix.size())) * 1024u;
+    }
+  }
+  return 0u;
+}
+
+// Tracks the memory high-water mark of a benchmark. On Linux, the peak
+// resident set size of the process is reset on construction, so each
+// benchmark reports its own peak rather than the peak of every benchmark
+// that ran before it. Elsewhere, the peak is that of the whole process, and
+// so benchmarks should be run one at a time with `--benchmark_filter`.
+class MemoryHighWaterMark {
+ public:
+  MemoryHighWaterMark(void) {
+
+    // Give memory freed by earlier benchmarks back to the OS, otherwise it
+    // would count towards the baseline.
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+    std::ofstream("/proc/self/clear_refs") << "5";
+    baseline = ProcStatusBytes("VmRSS");
+  }
+
+  // The peak resident set size since construction, in bytes.
+  uint64_t PeakBytes(void) const {
+    if (auto peak = ProcStatusBytes("VmHWM")) {
+      return peak;
+    }
+
+    struct rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024u;
+#endif
+  }
+
+  // Report the peak, and how much it grew since construction, as counters of
+  // `state`.
+  void Report(benchmark::State &state) const {
+    const auto peak = PeakBytes();
+    state.counters["peak_rss_bytes"] = static_cast<double>(peak);
+    state.counters["peak_rss_growth_bytes"] =
+        static_cast<double>(peak > baseline ? peak - baseline : 0u);
+  }
+
+ private:
+  uint64_t baseline{0};
+};
@@ -0,0 +1,86 @@
+// Copyright 2021, Trail of Bits. All rights reserved.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <drlojekyll/Runtime/StdRuntime.h>
+#include "counted_tables.db.h"  // Auto-generated.
+
+using DatabaseStorage = hyde::rt::StdStorage;
+using DatabaseFunctors = counted_tables::DatabaseFunctors<DatabaseStorage>;
+using DatabaseLog = counted_tables::DatabaseLog<DatabaseStorage>;
+using Database = counted_tables::Database<DatabaseStorage, DatabaseLog, DatabaseFunctors>;
+
+template <typename... Args>
+using Vector = hyde::rt::Vector<DatabaseStorage, Args...>;
+
+template <typename DB>
+std::vector<uint64_t> Reachable(DB &db, uint64_t from) {
+  std::vector<uint64_t> tos;
+  db.reachable_bf(from, [&tos] (uint64_t, uint64_t to) {
+    tos.push_back(to);
+    return true;
+  });
+  std::sort(tos.begin(), tos.end());
+  return tos;
+}
+
+TEST(CountedTables, TupleSurvivesUntilLastDerivationIsRetracted) {
+
+  DatabaseFunctors functors;
+  DatabaseLog log;
+  DatabaseStorage storage;
+  Database db(storage, log, functors);
+
+  // Derive `reachable(1, 2)` through both messages, and `reachable(1, 3)`
+  // through only one of them.
+  Vector<uint64_t, uint64_t> direct(storage, 0);
+  Vector<uint64_t, uint64_t> no_direct(storage, 0);
+  direct.Add(1, 2);
+  direct.Add(1, 3);
+  db.direct_edge_2(std::move(direct), std::move(no_direct));
+
+  Vector<uint64_t, uint64_t> indirect(storage, 0);
+  Vector<uint64_t, uint64_t> no_indirect(storage, 0);
+  indirect.Add(1, 2);
+  db.indirect_edge_2(std::move(indirect), std::move(no_indirect));
+
+  ASSERT_EQ(Reachable(db, 1), std::vector<uint64_t>({2, 3}));
+
+  // Retracting one of the two derivations of `reachable(1, 2)` keeps it, but
+  // retracting the only derivation of `reachable(1, 3)` removes it.
+  Vector<uint64_t, uint64_t> direct2(storage, 0);
+  Vector<uint64_t, uint64_t> no_direct2(storage, 0);
+  no_direct2.Add(1, 2);
+  no_direct2.Add(1, 3);
+  db.direct_edge_2(std::move(direct2), std::move(no_direct2));
+
+  ASSERT_EQ(Reachable(db, 1), std::vector<uint64_t>({2}));
+
+  // Retracting an already retracted message doesn't remove another derivation.
+  Vector<uint64_t, uint64_t> direct3(storage, 0);
+  Vector<uint64_t, uint64_t> no_direct3(storage, 0);
+  no_direct3.Add(1, 2);
+  db.direct_edge_2(std::move(direct3), std::move(no_direct3));
+
+  ASSERT_EQ(Reachable(db, 1), std::vector<uint64_t>({2}));
+
+  // Retracting the second derivation removes it.
+  Vector<uint64_t, uint64_t> indirect2(storage, 0);
+  Vector<uint64_t, uint64_t> no_indirect2(storage, 0);
+  no_indirect2.Add(1, 2);
+  db.indirect_edge_2(std::move(indirect2), std::move(no_indirect2));
+
+  ASSERT_EQ(Reachable(db, 1), std::vector<uint64_t>());
+
+  // Publishing it again brings it back.
+  Vector<uint64_t, uint64_t> indirect3(storage, 0);
+  Vector<uint64_t, uint64_t> no_indirect3(storage, 0);
+  indirect3.Add(1, 2);
+  db.indirect_edge_2(std::move(indirect3), std::move(no_indirect3));
+
+  ASSERT_EQ(Reachable(db, 1), std::vector<uint64_t>({2}));
+}
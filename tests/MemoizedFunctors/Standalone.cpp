@@ -0,0 +1,103 @@
+// Copyright 2021, Trail of Bits. All rights reserved.
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include <drlojekyll/Runtime/StdRuntime.h>
+#include "memoized_functors.db.h"  // Auto-generated.
+
+using DatabaseStorage = hyde::rt::StdStorage;
+using DatabaseLog = memoized_functors::DatabaseLog<DatabaseStorage>;
+
+template <typename... Args>
+using Vector = hyde::rt::Vector<DatabaseStorage, Args...>;
+
+// Counts how many times `square` is actually called, as opposed to having its
+// result come out of the database's functor cache.
+class DatabaseFunctors
+    : public memoized_functors::DatabaseFunctors<DatabaseStorage> {
+ public:
+  virtual ~DatabaseFunctors(void) = default;
+
+  uint64_t square_bf(uint64_t x) override {
+    ++num_calls;
+    return x * x;
+  }
+
+  uint64_t num_calls{0};
+};
+
+using Database = memoized_functors::Database<DatabaseStorage, DatabaseLog,
+                                             DatabaseFunctors>;
+
+static std::map<uint64_t, uint64_t> Squares(Database &db) {
+  std::map<uint64_t, uint64_t> squares;
+  db.squared_ff([&squares] (uint64_t x, uint64_t y) {
+    squares.emplace(x, y);
+    return true;
+  });
+  return squares;
+}
+
+static uint64_t NumCacheHits(Database &db) {
+  uint64_t num_hits = 0;
+  db.DumpFunctorCacheStats(
+      [&num_hits] (const char *name, uint64_t hits, uint64_t) {
+        if (std::string(name) == "square_bf") {
+          num_hits = hits;
+        }
+      });
+  return num_hits;
+}
+
+TEST(MemoizedFunctors, RepeatedInputsHitTheCache) {
+
+  DatabaseFunctors functors;
+  DatabaseLog log;
+  DatabaseStorage storage;
+  Database db(storage, log, functors);
+
+  Vector<uint64_t> added(storage, 0);
+  Vector<uint64_t> removed(storage, 1);
+  added.Add(1);
+  added.Add(2);
+  added.Add(3);
+  db.number_1(std::move(added), std::move(removed));
+
+  const std::map<uint64_t, uint64_t> expected = {{1, 1}, {2, 4}, {3, 9}};
+  ASSERT_EQ(Squares(db), expected);
+  ASSERT_EQ(functors.num_calls, 3u);
+
+  // Retracting a number and then publishing it again re-derives its square,
+  // but the functor has already been called on it.
+  Vector<uint64_t> added2(storage, 0);
+  Vector<uint64_t> removed2(storage, 1);
+  removed2.Add(2);
+  db.number_1(std::move(added2), std::move(removed2));
+
+  const std::map<uint64_t, uint64_t> expected2 = {{1, 1}, {3, 9}};
+  ASSERT_EQ(Squares(db), expected2);
+
+  Vector<uint64_t> added3(storage, 0);
+  Vector<uint64_t> removed3(storage, 1);
+  added3.Add(2);
+  db.number_1(std::move(added3), std::move(removed3));
+
+  ASSERT_EQ(Squares(db), expected);
+  ASSERT_EQ(functors.num_calls, 3u);
+  ASSERT_LT(0u, NumCacheHits(db));
+
+  // A new number still calls the functor.
+  Vector<uint64_t> added4(storage, 0);
+  Vector<uint64_t> removed4(storage, 1);
+  added4.Add(4);
+  db.number_1(std::move(added4), std::move(removed4));
+
+  const std::map<uint64_t, uint64_t> expected4 = {
+      {1, 1}, {2, 4}, {3, 9}, {4, 16}};
+  ASSERT_EQ(Squares(db), expected4);
+  ASSERT_EQ(functors.num_calls, 4u);
+}
@@ -0,0 +1,194 @@
+// Copyright 2021, Trail of Bits. All rights reserved.
+
+// Benchmarks of the mini disassembler over synthetic programs. Run with
+// `--benchmark_format=json` or `--benchmark_out=<PATH>` to get results that
+// can be compared between builds, e.g. with Google Benchmark's `compare.py`.
+
+#include <cstdint>
+#include <memory>
+
+#include "../Benchmark.h"
+
+#include <drlojekyll/Runtime/StdRuntime.h>
+#include "mini_disassembler.db.h"  // Auto-generated.
+
+namespace {
+
+using DatabaseStorage = hyde::rt::StdStorage;
+using DatabaseFunctors = mini_disassembler::DatabaseFunctors<DatabaseStorage>;
+using DatabaseLog = mini_disassembler::DatabaseLog<DatabaseStorage>;
+using Database = mini_disassembler::Database<DatabaseStorage, DatabaseLog, DatabaseFunctors>;
+
+template <typename... Args>
+using Vector = hyde::rt::Vector<DatabaseStorage, Args...>;
+
+// The number of instructions in each block of a synthetic program.
+static constexpr uint64_t kBlockSize = 64u;
+
+// Owns a database and everything it needs.
+struct DatabaseInstance {
+  DatabaseFunctors functors;
+  DatabaseLog log;
+  DatabaseStorage storage;
+  Database db{storage, log, functors};
+};
+
+// Add the blocks `[begin, end)` of a synthetic program. Each block is a run of
+// instructions that fall through to the next. If `with_calls` is `true` then
+// the first instruction of each block is called from the middle of the
+// previous block, otherwise nothing transfers control into the block.
+// Either way, each block is a function. Returns the number of messages sent.
+static uint64_t AddBlocks(DatabaseInstance &instance, uint64_t begin,
+                          uint64_t end, bool with_calls) {
+  Vector<uint64_t> instructions(instance.storage, 0);
+  Vector<uint64_t, uint64_t, mini_disassembler::EdgeType> transfers(
+      instance.storage, 1);
+
+  for (auto ea = begin * kBlockSize; ea < end * kBlockSize; ++ea) {
+    instructions.Add(ea);
+    if (ea % kBlockSize) {
+      transfers.Add(ea - 1u, ea, mini_disassembler::EdgeType::FALL_THROUGH);
+    } else if (with_calls && ea) {
+      transfers.Add(ea - kBlockSize / 2u, ea,
+                    mini_disassembler::EdgeType::CALL);
+    }
+  }
+
+  const auto num_messages = instructions.Size() + transfers.Size();
+  instance.db.instruction_1(std::move(instructions));
+  instance.db.raw_transfer_3(std::move(transfers));
+  return num_messages;
+}
+
+}  // namespace
+
+// Time to add a whole program to an empty database, in a single batch.
+static void BM_ApplyAll(benchmark::State &state) {
+  const auto num_blocks = static_cast<uint64_t>(state.range(0)) / kBlockSize;
+  MemoryHighWaterMark memory;
+  uint64_t num_messages = 0u;
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto instance = std::make_unique<DatabaseInstance>();
+    state.ResumeTiming();
+
+    num_messages += AddBlocks(*instance, 0u, num_blocks, true);
+
+    state.PauseTiming();
+    instance.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(num_messages));
+  memory.Report(state);
+}
+BENCHMARK(BM_ApplyAll)
+    ->ArgName("instructions")
+    ->RangeMultiplier(4)
+    ->Range(1 << 12, 1 << 16)
+    ->Unit(benchmark::kMillisecond);
+
+// Time to add new functions to a program, in `batches` batches.
+static void BM_IncrementalAdd(benchmark::State &state) {
+  const uint64_t num_blocks = (1u << 16) / kBlockSize;
+  const auto num_batches = static_cast<uint64_t>(state.range(0));
+  const auto blocks_per_batch = num_blocks / num_batches;
+  MemoryHighWaterMark memory;
+  uint64_t num_messages = 0u;
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto instance = std::make_unique<DatabaseInstance>();
+    AddBlocks(*instance, 0u, num_blocks, true);
+    state.ResumeTiming();
+
+    for (auto i = 0u; i < num_batches; ++i) {
+      const auto begin = num_blocks + i * blocks_per_batch;
+      num_messages +=
+          AddBlocks(*instance, begin, begin + blocks_per_batch, true);
+    }
+
+    state.PauseTiming();
+    instance.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(num_messages));
+  memory.Report(state);
+}
+BENCHMARK(BM_IncrementalAdd)
+    ->ArgName("batches")
+    ->RangeMultiplier(8)
+    ->Range(1, 1024)
+    ->Unit(benchmark::kMillisecond);
+
+// Time to add fall-through edges that merge every pair of functions into one
+// function, in `batches` batches. Most of the work is in retracting the
+// second function of each pair, and everything derived from it.
+static void BM_IncrementalRetract(benchmark::State &state) {
+  const uint64_t num_blocks = (1u << 16) / kBlockSize;
+  const auto num_batches = static_cast<uint64_t>(state.range(0));
+  const auto blocks_per_batch = num_blocks / num_batches;
+  MemoryHighWaterMark memory;
+  uint64_t num_messages = 0u;
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto instance = std::make_unique<DatabaseInstance>();
+    AddBlocks(*instance, 0u, num_blocks, false);
+    state.ResumeTiming();
+
+    for (auto i = 0u; i < num_batches; ++i) {
+      Vector<uint64_t, uint64_t, mini_disassembler::EdgeType> transfers(
+          instance->storage, 1);
+      for (auto b = i * blocks_per_batch; b < (i + 1u) * blocks_per_batch;
+           b += 2u) {
+        const auto ea = (b + 1u) * kBlockSize;
+        transfers.Add(ea - 1u, ea, mini_disassembler::EdgeType::FALL_THROUGH);
+      }
+      num_messages += transfers.Size();
+      instance->db.raw_transfer_3(std::move(transfers));
+    }
+
+    state.PauseTiming();
+    instance.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(num_messages));
+  memory.Report(state);
+}
+BENCHMARK(BM_IncrementalRetract)
+    ->ArgName("batches")
+    ->RangeMultiplier(8)
+    ->Range(1, 512)
+    ->Unit(benchmark::kMillisecond);
+
+// Latency of checking whether an instruction is the head of a function.
+static void BM_QueryFunction(benchmark::State &state) {
+  const uint64_t num_blocks = (1u << 16) / kBlockSize;
+  DatabaseInstance instance;
+  AddBlocks(instance, 0u, num_blocks, true);
+
+  uint64_t ea = 0u;
+  uint64_t num_functions = 0u;
+  for (auto _ : state) {
+    num_functions += instance.db.function_b(ea);
+    ea = (ea + kBlockSize / 2u) % (num_blocks * kBlockSize);
+  }
+  state.SetItemsProcessed(state.iterations());
+  benchmark::DoNotOptimize(num_functions);
+}
+BENCHMARK(BM_QueryFunction);
+
+// Latency of listing the instructions of a function.
+static void BM_QueryFunctionInstructions(benchmark::State &state) {
+  const uint64_t num_blocks = (1u << 16) / kBlockSize;
+  DatabaseInstance instance;
+  AddBlocks(instance, 0u, num_blocks, true);
+
+  uint64_t block = 0u;
+  uint64_t num_results = 0u;
+  for (auto _ : state) {
+    num_results += instance.db.function_instructions_bf(
+        block * kBlockSize, [](uint64_t, uint64_t) { return true; });
+    block = (block + 1u) % num_blocks;
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(num_results));
+}
+BENCHMARK(BM_QueryFunctionInstructions);
@@ -43,6 +43,25 @@ size_t NumFunctionInstructions(DB &db, uint64_t func_ea) {
   return eas.size();
 }
 
+// Build a client message like the ones the server publishes, with or without
+// its resync marker set.
+static mini_disassembler::DatalogClientMessagePtr MakeClientMessage(
+    bool resync) {
+  auto builder = std::make_shared<flatbuffers::FlatBufferBuilder>();
+  builder->Finish(
+      mini_disassembler::CreateDatalogClientMessage(*builder, resync));
+  return mini_disassembler::DatalogClientMessagePtr(
+      builder,
+      flatbuffers::GetMutableRoot<mini_disassembler::DatalogClientMessage>(
+          builder->GetBufferPointer()));
+}
+
+TEST(MiniDisassembler, ResyncMessagesAreSurfaced) {
+  ASSERT_TRUE(mini_disassembler::IsResyncMessage(MakeClientMessage(true)));
+  ASSERT_FALSE(mini_disassembler::IsResyncMessage(MakeClientMessage(false)));
+  ASSERT_FALSE(mini_disassembler::IsResyncMessage(nullptr));
+}
+
 // A simple Google Test example
 TEST(MiniDisassembler, ServerConnectionWorks) {
 
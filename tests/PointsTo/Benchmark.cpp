@@ -0,0 +1,284 @@
+// Copyright 2021, Trail of Bits. All rights reserved.
+
+// Benchmarks of the points-to analysis, over samples of the facts in
+// `facts/`, and over synthetically scaled copies of those samples. Run with
+// `--benchmark_format=json` or `--benchmark_out=<PATH>` to get results that
+// can be compared between builds, e.g. with Google Benchmark's `compare.py`.
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "../Benchmark.h"
+#include "FactPaths.h"
+
+#include <drlojekyll/Runtime/StdRuntime.h>
+#include "points_to.db.h"  // Auto-generated.
+
+namespace {
+
+using DatabaseStorage = hyde::rt::StdStorage;
+using DatabaseFunctors = points_to::DatabaseFunctors<DatabaseStorage>;
+using DatabaseLog = points_to::DatabaseLog<DatabaseStorage>;
+using Database = points_to::Database<DatabaseStorage, DatabaseLog, DatabaseFunctors>;
+
+template <typename... Args>
+using Vector = hyde::rt::Vector<DatabaseStorage, Args...>;
+
+// The input facts of the analysis.
+struct Facts {
+  std::vector<std::tuple<uint32_t, uint32_t>> assign_alloc;
+  std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> load;
+  std::vector<std::tuple<uint32_t, uint32_t>> primitive_assign;
+  std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> store;
+
+  size_t Size(void) const {
+    return assign_alloc.size() + load.size() + primitive_assign.size() +
+           store.size();
+  }
+};
+
+template <typename... Ts>
+static void ReadFacts(const char *path, const char *format,
+                      std::vector<std::tuple<Ts...>> &facts) {
+  std::ifstream fs(path);
+  for (std::string line; std::getline(fs, line);) {
+    std::tuple<Ts...> fact;
+    if (sizeof...(Ts) == std::apply([&](Ts &...vals) {
+          return sscanf(line.c_str(), format, &vals...);
+        }, fact)) {
+      facts.push_back(fact);
+    }
+  }
+}
+
+static Facts ReadAllFacts(void) {
+  Facts facts;
+  ReadFacts(kAssignAllocPath, "%u\t%u", facts.assign_alloc);
+  ReadFacts(kLoadPath, "%u\t%u\t%u", facts.load);
+  ReadFacts(kPrimitiveAssignPath, "%u\t%u", facts.primitive_assign);
+  ReadFacts(kStorePath, "%u\t%u\t%u", facts.store);
+  return facts;
+}
+
+// Take the first `1 / fraction` of each kind of fact, and then make `copies`
+// disjoint copies of them. Each copy renames every variable, allocation, and
+// field, so the analysis of the copies does `copies` times the work.
+static Facts SampleFacts(const Facts &facts, unsigned fraction,
+                         unsigned copies) {
+  uint32_t max_id = 0u;
+  auto update_max = [&](const auto &fact) {
+    std::apply([&](auto... vals) { max_id = std::max({max_id, vals...}); },
+               fact);
+  };
+  std::for_each(facts.assign_alloc.begin(), facts.assign_alloc.end(),
+                update_max);
+  std::for_each(facts.load.begin(), facts.load.end(), update_max);
+  std::for_each(facts.primitive_assign.begin(), facts.primitive_assign.end(),
+                update_max);
+  std::for_each(facts.store.begin(), facts.store.end(), update_max);
+
+  Facts sampled;
+  for (auto i = 0u; i < copies; ++i) {
+    const uint32_t offset = i * (max_id + 1u);
+    auto copy = [=](const auto &from, auto &to) {
+      for (auto j = 0u; j < from.size() / fraction; ++j) {
+        to.push_back(std::apply(
+            [=](auto... vals) { return std::make_tuple((vals + offset)...); },
+            from[j]));
+      }
+    };
+    copy(facts.assign_alloc, sampled.assign_alloc);
+    copy(facts.load, sampled.load);
+    copy(facts.primitive_assign, sampled.primitive_assign);
+    copy(facts.store, sampled.store);
+  }
+  return sampled;
+}
+
+// Returns the sampled facts of a benchmark, whose first argument is the
+// fraction of the facts to take, and whose second argument is the number of
+// copies of those facts to make.
+static const Facts &SampledFacts(const benchmark::State &state) {
+  static const Facts kFacts = ReadAllFacts();
+  static std::map<std::pair<int64_t, int64_t>, Facts> sampled_facts;
+
+  const auto key = std::make_pair(state.range(0), state.range(1));
+  auto it = sampled_facts.find(key);
+  if (it == sampled_facts.end()) {
+    auto facts = SampleFacts(kFacts, static_cast<unsigned>(key.first),
+                             static_cast<unsigned>(key.second));
+    it = sampled_facts.emplace(key, std::move(facts)).first;
+  }
+  return it->second;
+}
+
+// Owns a database and everything it needs.
+struct DatabaseInstance {
+  DatabaseFunctors functors;
+  DatabaseLog log;
+  DatabaseStorage storage;
+  Database db{storage, log, functors};
+};
+
+// Add slice `i` of `n` of every kind of fact to the database.
+static void ApplySlice(DatabaseInstance &instance, const Facts &facts,
+                       size_t i, size_t n) {
+  auto &storage = instance.storage;
+  auto slice = [=](const auto &from, auto &to) {
+    const auto begin = (from.size() * i) / n;
+    const auto end = (from.size() * (i + 1u)) / n;
+    for (auto j = begin; j < end; ++j) {
+      std::apply([&](auto... vals) { to.Add(vals...); }, from[j]);
+    }
+  };
+
+  Vector<uint32_t, uint32_t> assign_alloc(storage, 0);
+  Vector<uint32_t, uint32_t, uint32_t> load(storage, 1);
+  Vector<uint32_t, uint32_t> primitive_assign(storage, 2);
+  Vector<uint32_t, uint32_t, uint32_t> store(storage, 3);
+  slice(facts.assign_alloc, assign_alloc);
+  slice(facts.load, load);
+  slice(facts.primitive_assign, primitive_assign);
+  slice(facts.store, store);
+
+  instance.db.assign_alloc_2(std::move(assign_alloc));
+  instance.db.load_3(std::move(load));
+  instance.db.primitive_assign_2(std::move(primitive_assign));
+  instance.db.store_3(std::move(store));
+}
+
+static size_t NumVarPointsTo(Database &db) {
+  size_t num_tuples = 0u;
+  db.var_points_to_ff([&](uint32_t, uint32_t) {
+    ++num_tuples;
+    return true;
+  });
+  return num_tuples;
+}
+
+}  // namespace
+
+// Time to read and parse the fact files.
+static void BM_LoadFacts(benchmark::State &state) {
+  MemoryHighWaterMark memory;
+  size_t num_facts = 0u;
+  for (auto _ : state) {
+    const auto facts = ReadAllFacts();
+    num_facts += facts.Size();
+    benchmark::DoNotOptimize(facts.assign_alloc.data());
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(num_facts));
+  memory.Report(state);
+}
+BENCHMARK(BM_LoadFacts)->Unit(benchmark::kMillisecond);
+
+// Time to add all facts to an empty database, in a single batch.
+static void BM_ApplyAll(benchmark::State &state) {
+  const auto &facts = SampledFacts(state);
+  MemoryHighWaterMark memory;
+  size_t num_results = 0u;
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto instance = std::make_unique<DatabaseInstance>();
+    state.ResumeTiming();
+
+    ApplySlice(*instance, facts, 0u, 1u);
+
+    state.PauseTiming();
+    num_results = NumVarPointsTo(instance->db);
+    instance.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(
+      static_cast<int64_t>(facts.Size() * state.iterations()));
+  state.counters["facts"] = static_cast<double>(facts.Size());
+  state.counters["var_points_to"] = static_cast<double>(num_results);
+  memory.Report(state);
+}
+BENCHMARK(BM_ApplyAll)
+    ->ArgNames({"fraction", "copies"})
+    ->Args({32, 1})
+    ->Args({16, 1})
+    ->Args({8, 1})
+    ->Args({16, 2})
+    ->Args({16, 4})
+    ->Args({16, 8})
+    ->Unit(benchmark::kMillisecond);
+
+// Time to add the second half of the facts to a database that already has
+// the first half, split into `batches` batches.
+static void BM_IncrementalAdd(benchmark::State &state) {
+  const auto &facts = SampledFacts(state);
+  const auto num_batches = static_cast<size_t>(state.range(2));
+  MemoryHighWaterMark memory;
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto instance = std::make_unique<DatabaseInstance>();
+    ApplySlice(*instance, facts, 0u, 2u);
+    state.ResumeTiming();
+
+    for (auto i = 0u; i < num_batches; ++i) {
+      ApplySlice(*instance, facts, num_batches + i, num_batches * 2u);
+    }
+
+    state.PauseTiming();
+    instance.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(
+      static_cast<int64_t>((facts.Size() / 2u) * state.iterations()));
+  memory.Report(state);
+}
+BENCHMARK(BM_IncrementalAdd)
+    ->ArgNames({"fraction", "copies", "batches"})
+    ->Args({8, 1, 1})
+    ->Args({8, 1, 8})
+    ->Args({8, 1, 64})
+    ->Args({8, 1, 512})
+    ->Unit(benchmark::kMillisecond);
+
+enum class Query { kAssign, kVarPointsTo, kAlias };
+
+// Time to read out every result of a query.
+static void BM_Query(benchmark::State &state, Query query) {
+  const auto &facts = SampledFacts(state);
+  DatabaseInstance instance;
+  ApplySlice(instance, facts, 0u, 1u);
+
+  size_t num_results = 0u;
+  auto count = [&](uint32_t, uint32_t) {
+    ++num_results;
+    return true;
+  };
+  for (auto _ : state) {
+    switch (query) {
+      case Query::kAssign: instance.db.assign_ff(count); break;
+      case Query::kVarPointsTo: instance.db.var_points_to_ff(count); break;
+      case Query::kAlias: instance.db.alias_ff(count); break;
+    }
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(num_results));
+  state.counters["results"] = static_cast<double>(
+      num_results / std::max<size_t>(1u, state.iterations()));
+}
+BENCHMARK_CAPTURE(BM_Query, assign, Query::kAssign)
+    ->ArgNames({"fraction", "copies"})
+    ->Args({8, 1})
+    ->Args({8, 4})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_Query, var_points_to, Query::kVarPointsTo)
+    ->ArgNames({"fraction", "copies"})
+    ->Args({8, 1})
+    ->Args({8, 4})
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_Query, alias, Query::kAlias)
+    ->ArgNames({"fraction", "copies"})
+    ->Args({8, 1})
+    ->Args({8, 4})
+    ->Unit(benchmark::kMicrosecond);
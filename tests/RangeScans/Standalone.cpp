@@ -0,0 +1,168 @@
+// Copyright 2021, Trail of Bits. All rights reserved.
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <drlojekyll/Runtime/StdRuntime.h>
+#include "range_scans.db.h"  // Auto-generated.
+
+using DatabaseStorage = hyde::rt::StdStorage;
+using DatabaseFunctors = range_scans::DatabaseFunctors<DatabaseStorage>;
+using DatabaseLog = range_scans::DatabaseLog<DatabaseStorage>;
+using Database = range_scans::Database<DatabaseStorage, DatabaseLog, DatabaseFunctors>;
+
+template <typename... Args>
+using Vector = hyde::rt::Vector<DatabaseStorage, Args...>;
+
+// The tuples of the nested-loop product of `lhs` and `rhs` that satisfy `cmp`.
+template <typename T, typename Cmp>
+static std::set<std::pair<T, T>> NestedLoopProduct(
+    const std::vector<T> &lhs, const std::vector<T> &rhs, Cmp cmp) {
+  std::set<std::pair<T, T>> tuples;
+  for (auto x : lhs) {
+    for (auto y : rhs) {
+      if (cmp(x, y)) {
+        tuples.emplace(x, y);
+      }
+    }
+  }
+  return tuples;
+}
+
+// Publish the values in several rounds, alternating sides, so that the ordered
+// views of the tables have to merge in records added after they were sorted,
+// and so that each side is the inner table of a scan at some point.
+TEST(RangeScans, IntegerProductsMatchNestedLoops) {
+
+  DatabaseFunctors functors;
+  DatabaseLog log;
+  DatabaseStorage storage;
+  Database db(storage, log, functors);
+
+  std::vector<uint64_t> less_lhs;
+  std::vector<uint64_t> less_rhs;
+  std::vector<int32_t> greater_lhs;
+  std::vector<int32_t> greater_rhs;
+
+  const auto check = [&] (void) {
+    std::set<std::pair<uint64_t, uint64_t>> less_than;
+    db.less_than_ff([&less_than] (uint64_t x, uint64_t y) {
+      less_than.emplace(x, y);
+      return true;
+    });
+    ASSERT_EQ(less_than, NestedLoopProduct(
+        less_lhs, less_rhs, [] (uint64_t x, uint64_t y) { return x < y; }));
+
+    std::set<std::pair<int32_t, int32_t>> greater_than;
+    db.greater_than_ff([&greater_than] (int32_t x, int32_t y) {
+      greater_than.emplace(x, y);
+      return true;
+    });
+    ASSERT_EQ(greater_than, NestedLoopProduct(
+        greater_lhs, greater_rhs, [] (int32_t x, int32_t y) { return x > y; }));
+  };
+
+  uint64_t seed = 1u;
+  for (auto round = 0u; round < 8u; ++round) {
+    Vector<uint64_t> lhs(storage, 0);
+    Vector<uint64_t> rhs(storage, 1);
+    Vector<int32_t> glhs(storage, 2);
+    Vector<int32_t> grhs(storage, 3);
+
+    // Values repeat within and across rounds. The first round also adds the
+    // extremes of each type.
+    for (auto i = 0u; i < 16u; ++i) {
+      seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+      const auto val = (seed >> 33) % 64u;
+      if (round % 2u) {
+        lhs.Add(val);
+        less_lhs.push_back(val);
+        grhs.Add(static_cast<int32_t>(val) - 32);
+        greater_rhs.push_back(static_cast<int32_t>(val) - 32);
+      } else {
+        rhs.Add(val);
+        less_rhs.push_back(val);
+        glhs.Add(static_cast<int32_t>(val) - 32);
+        greater_lhs.push_back(static_cast<int32_t>(val) - 32);
+      }
+    }
+
+    if (!round) {
+      lhs.Add(uint64_t(0u));
+      less_lhs.push_back(uint64_t(0u));
+      rhs.Add(std::numeric_limits<uint64_t>::max());
+      less_rhs.push_back(std::numeric_limits<uint64_t>::max());
+      glhs.Add(std::numeric_limits<int32_t>::min());
+      greater_lhs.push_back(std::numeric_limits<int32_t>::min());
+      grhs.Add(std::numeric_limits<int32_t>::max());
+      greater_rhs.push_back(std::numeric_limits<int32_t>::max());
+    }
+
+    db.less_lhs_1(std::move(lhs));
+    db.less_rhs_1(std::move(rhs));
+    db.greater_lhs_1(std::move(glhs));
+    db.greater_rhs_1(std::move(grhs));
+    check();
+  }
+}
+
+// Floating-point columns aren't ordered by range scans, as NaNs would make
+// sorting them undefined. The product must still skip NaNs, which never
+// compare less than anything.
+TEST(RangeScans, FloatProductSkipsNaNs) {
+
+  DatabaseFunctors functors;
+  DatabaseLog log;
+  DatabaseStorage storage;
+  Database db(storage, log, functors);
+
+  const auto nan = std::numeric_limits<double>::quiet_NaN();
+  const auto inf = std::numeric_limits<double>::infinity();
+  const std::vector<double> lhs_vals = {1.5, nan, -inf, 0.25, 3.0};
+  const std::vector<double> rhs_vals = {nan, 2.0, inf, -1.0, 0.25};
+
+  Vector<double> lhs(storage, 0);
+  Vector<double> rhs(storage, 1);
+  for (auto val : lhs_vals) {
+    lhs.Add(val);
+  }
+  for (auto val : rhs_vals) {
+    rhs.Add(val);
+  }
+  db.float_lhs_1(std::move(lhs));
+  db.float_rhs_1(std::move(rhs));
+
+  // Check for NaNs before using `std::set`, which needs a strict weak order.
+  std::vector<std::pair<double, double>> tuples;
+  db.float_less_than_ff([&tuples] (double x, double y) {
+    tuples.emplace_back(x, y);
+    return true;
+  });
+  for (auto [x, y] : tuples) {
+    ASSERT_FALSE(std::isnan(x));
+    ASSERT_FALSE(std::isnan(y));
+  }
+
+  const std::set<std::pair<double, double>> found(tuples.begin(),
+                                                  tuples.end());
+  std::vector<double> lhs_nums;
+  std::vector<double> rhs_nums;
+  for (auto val : lhs_vals) {
+    if (!std::isnan(val)) {
+      lhs_nums.push_back(val);
+    }
+  }
+  for (auto val : rhs_vals) {
+    if (!std::isnan(val)) {
+      rhs_nums.push_back(val);
+    }
+  }
+  ASSERT_EQ(found, NestedLoopProduct(
+      lhs_nums, rhs_nums, [] (double x, double y) { return x < y; }));
+}